@@ -0,0 +1,39 @@
+#ifndef __IHISTOGRAM_H__
+#define __IHISTOGRAM_H__
+
+#include <vector>
+
+#include <Resources/ITexture2D.h>
+
+namespace OpenEngine {
+namespace PostProcessing {
+
+using namespace std;
+using namespace OpenEngine::Resources;
+
+/** Interface for Histogram
+ */
+class IHistogram {
+
+  public:
+
+    virtual ~IHistogram() {}
+
+    /* the numBins x 1 texture holding the fraction of the texels in each bin - bind it to passes with BindTexture */
+    virtual ITexture2DPtr GetResult() = 0;
+
+    /* the luminance range of the bins: log2(luminance) from minLog2 to maxLog2 (the bins are equally wide in log2) */
+    virtual void  SetRange(float minLog2, float maxLog2) = 0;
+    virtual float GetMinLog2() = 0;
+    virtual float GetMaxLog2() = 0;
+    virtual int   GetNumBins() = 0;
+
+    /* read the result back to the CPU (a few frames late, without waiting for the GPU) */
+    virtual void EnableReadback(bool enable) = 0;
+    virtual bool GetResultValues(vector<float>& bins) = 0; // <- false if no result has been read back yet
+};
+
+} // NS PostProcessing
+} // NS OpenEngine
+
+#endif
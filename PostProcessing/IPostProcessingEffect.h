@@ -7,6 +7,10 @@
 #include <Resources/ITexture2D.h>
 #include <Resources/IRenderBuffer.h>
 #include <PostProcessing/IPostProcessingPass.h>
+#include <PostProcessing/IReduction.h>
+#include <PostProcessing/IHistogram.h>
+#include <PostProcessing/SeparableKernel.h>
+#include <Resources/ShaderPreprocessor.h>
 #include <Display/Viewport.h>
 
 namespace OpenEngine {
@@ -16,6 +20,9 @@ using namespace OpenEngine::Resources;
 using namespace OpenEngine::Display;
 using namespace OpenEngine::Core;
 
+// how the depth-buffer of a multisampled user-screen is resolved: take the first sample, or the nearest/farthest of all samples
+enum DepthResolve {DEPTH_RESOLVE_SAMPLE0, DEPTH_RESOLVE_MIN, DEPTH_RESOLVE_MAX};
+
 /** interface for PostProcessingEffect
  *  @author Bjarke N. Laustsen
  */
@@ -26,6 +33,17 @@ class IPostProcessingEffect {
     /* assign fragment programs for the various passes */
     virtual IPostProcessingPass* AddPass(string fpFileName) = 0;
     virtual IPostProcessingPass* AddPass(vector<string> fpFileNames) = 0;
+    virtual IPostProcessingPass* AddPass(string fpFileName, ShaderDefines defines) = 0;          // compiles a variant with the given defines
+    virtual IPostProcessingPass* AddPass(vector<string> fpFileNames, ShaderDefines defines) = 0;
+
+    /* add a pass convolving the colorbuffer with a symmetric 1D kernel (weights: the center first) - run one per direction for a 2D blur */
+    virtual IPostProcessingPass* AddSeparableFilterPass(vector<float> weights, FilterDirection direction) = 0;
+    virtual IPostProcessingPass* AddGaussianBlurPass(float sigma, FilterDirection direction) = 0;
+    virtual IPostProcessingPass* AddBoxBlurPass(int radius, FilterDirection direction) = 0;
+
+    /* reduce the colorbuffer output by the passes added so far to one value on the GPU (f.e. the average luminance for auto-exposure) */
+    virtual IReduction* AddReduction(ReductionOp op, const bool readback = false) = 0;
+    virtual IHistogram* AddHistogram(int numBins = 64, float minLog2 = -10.0f, float maxLog2 = 6.0f, const bool readback = false) = 0; // <- of the luminance
 
   public:
 
@@ -65,6 +83,43 @@ class IPostProcessingEffect {
     virtual void Enable(bool enable) = 0;
     virtual bool IsEnabled() = 0;
 
+    /* give the user-screen a stencil buffer (the depth-buffer textures become packed depth-stencil), for stencil-masked passes */
+    virtual void EnableStencilBuffer() = 0;
+    virtual bool IsStencilBufferEnabled() = 0;
+
+    /* render the user-screen with MSAA (resolved before the first pass) - 0 samples disables it */
+    virtual void SetMultisampling(int samples, DepthResolve depthResolve = DEPTH_RESOLVE_SAMPLE0) = 0;
+
+    /* over-allocate the buffers to multiples of bucketSize pixels, so resizing the viewport rarely reallocates them (0 = exact size) */
+    virtual void SetResizeBucket(int bucketSize) = 0;
+    virtual void GetTexCoordScale(float& scaleS, float& scaleT) = 0; // <- the part of the buffers covered by the viewport
+
+    /* render the scene and the passes at a fraction of the viewport size (upscaled to the viewport) - fixed, or adjusted to a GPU time budget */
+    virtual void  SetRenderScale(float scale) = 0;
+    virtual float GetRenderScale() = 0;
+    virtual void  GetRenderSize(int& width, int& height) = 0;
+    virtual void  EnableDynamicResolution(float budgetMilliseconds = 16.6f, float minScale = 0.5f, float maxScale = 1.0f) = 0;
+    virtual void  DisableDynamicResolution() = 0;
+
+    /* switch between the quality tiers of the effect (0 = the best) - by hand, or picked from the GPU time of the passes by a governor */
+    virtual void SetQualityTier(int tier) = 0;
+    virtual int  GetQualityTier() = 0;
+    virtual int  GetNumQualityTiers() = 0;
+    virtual void PrebuildQualityTiers() = 0; // build all tiers now instead of when they are first used (to compile shaders while loading)
+    virtual void EnableQualityGovernor(float budgetMilliseconds) = 0;
+    virtual void DisableQualityGovernor() = 0;
+
+    /* skip the passes whose inputs haven't changed since last frame (call SetSceneUnchanged on frames where the scene is the same) */
+    virtual void EnableResultCaching(bool enable) = 0;
+    virtual void SetSceneUnchanged() = 0;
+
+    /* the GPU time per frame for the time-budgeted passes (see IPostProcessingPass::SetUpdateMode), and the frame counter */
+    virtual void SetUpdateBudget(float milliseconds) = 0;
+    virtual unsigned int GetFrameIndex() = 0;
+
+    /* use a uniform block in all passes of this PPE */
+    virtual void AddUniformBlock(IUniformBlockPtr block) = 0;
+
     /* methods for chaining PPEs */
     virtual void Add(IPostProcessingEffect* ppe) = 0;
     virtual void Remove(IPostProcessingEffect* ppe) = 0;
@@ -73,6 +128,7 @@ class IPostProcessingEffect {
     /* overwritable user-methods */ // PerFrame will be called AFTER each frame where this ppe was active! (also if disabled?)
     virtual void Setup() = 0;
     virtual void PerFrame(const float deltaTime) = 0;
+    virtual void PerFrame(const float deltaTime, const unsigned int frameIndex) = 0; // <- (by default it just calls the above)
 
     /* get viewport */
     virtual Viewport* GetViewport() = 0;
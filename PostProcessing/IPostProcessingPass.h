@@ -8,6 +8,7 @@
 #include <PostProcessing/PostProcessingException.h>
 #include <Resources/ITexture2D.h>
 #include <Resources/IRenderBuffer.h>
+#include <Resources/IUniformBlock.h>
 #include <Display/Viewport.h>
 
 namespace OpenEngine {
@@ -17,6 +18,23 @@ using namespace OpenEngine::Resources;
 using namespace OpenEngine::Display; // for viewport
 using namespace OpenEngine::Resources; // for ITextureResourcePtr
 
+/** how often a pass is updated (see IPostProcessingPass::SetUpdateMode)
+ */
+enum PassUpdateMode {
+    UPDATE_EVERY_FRAME,      // (default)
+    UPDATE_EVERY_NTH_FRAME,  // all pixels, every period'th frame
+    UPDATE_CHECKERBOARD,     // half the pixels each frame (every other pixel, alternating) - so all pixels in 2 frames
+    UPDATE_INTERLEAVED_ROWS, // every period'th row each frame - so all rows in period frames
+    UPDATE_TIME_BUDGET       // all pixels, on the frames where it fits in the update budget of the effect (see SetUpdateBudget)
+};
+
+/** the buffers whose previous frames can be bound to a pass (see IPostProcessingPass::BindHistoryBuffer)
+ */
+enum HistoryBuffer {
+    HISTORY_COLORBUFFER, // the final colorbuffer of the effect
+    HISTORY_DEPTHBUFFER  // the final depthbuffer of the effect
+};
+
 /** Interface for PostProcessingPass
  *  @author Bjarke N. Laustsen
  */
@@ -34,16 +52,29 @@ class IPostProcessingPass {
     virtual void BindMatrix      (string fpParameterName, int n, int m, vector<float> floatmatrix, const bool transpose = false) = 0;
     virtual void BindMatrix      (string fpParameterName, int n, int m, vector<vector<float> > floatmatrices, const bool transpose = false) = 0;
     virtual void BindTexture     (string fpParameterName, ITextureResourcePtr tex) = 0;
+    virtual void BindTexture     (string fpParameterName, ITextureResourcePtr tex, bool allowHandle) = 0; // <- see PostProcessingPass::BindTexture
     virtual void BindColorBuffer (string fpParameterName) = 0;
     virtual void BindDepthBuffer (string fpParameterName) = 0;
     virtual void BindUserBuffer  (string fpParameterName, IPostProcessingPass* outputPass, int outputAttachmentPoint) = 0;
+    virtual void BindUniformBlock(IUniformBlockPtr block) = 0;
+    virtual void BindHistoryBuffer(string fpParameterName, HistoryBuffer buffer, int framesBack = 1) = 0; // <- f.e. for TAA, motion blur
 
     /* assign which buffers the fragmentprogram of a pass outputs to. (must enable for all buffers it writes to) */
     virtual void EnableColorBufferOutput() = 0;
     virtual void EnableDepthBufferOutput() = 0;
 
+    /* only execute the pass on the pixels where the stencil of the user-screen matches (stencil & mask == ref & mask) */
+    virtual void EnableStencilMask(int ref, unsigned int mask = 0xFF) = 0;
+    virtual void DisableStencilMask() = 0;
+
+    /* update this pass less often than every frame (expensive passes, f.e. SSAO) - its output is kept in its userbuffers in between */
+    virtual void SetUpdateMode(PassUpdateMode mode, int period = 2) = 0;
+    virtual PassUpdateMode GetUpdateMode() = 0;
+    virtual int  GetUpdatePhase(unsigned int frameIndex) = 0; // <- the part updated on the given frame (see PerFrame)
+
     /* attach userbuffer at the attachmentPoint */
     virtual void AttachUserBuffer(int attachmentPoint, const bool createFloatTexture = false) = 0;
+    virtual void AttachUserBuffer(int attachmentPoint, TexelFormat format) = 0; // f.e. TEX_R16F, TEX_RG16F, TEX_R11G11B10F
 
     /* return a COPY of the texture from the userbuffer at the attachmentPoint */
     virtual ITexture2DPtr GetUserBuffer(int attachmentPoint) = 0;
@@ -0,0 +1,41 @@
+#ifndef __IREDUCTION_H__
+#define __IREDUCTION_H__
+
+#include <Resources/ITexture2D.h>
+
+namespace OpenEngine {
+namespace PostProcessing {
+
+using namespace OpenEngine::Resources;
+
+/** how the texels of the colorbuffer are reduced to one value (see IPostProcessingEffect::AddReduction)
+ */
+enum ReductionOp {
+    REDUCE_MIN,
+    REDUCE_MAX,
+    REDUCE_AVERAGE,
+    REDUCE_LOG_AVERAGE // exp(average(log(x))) - the geometric mean, f.e. the scene luminance for auto-exposure
+};
+
+/** Interface for Reduction
+ */
+class IReduction {
+
+  public:
+
+    virtual ~IReduction() {}
+
+    /* the 1x1 texture holding the result (rgb: per component, a: the luminance) - bind it to passes with BindTexture */
+    virtual ITexture2DPtr GetResult() = 0;
+
+    /* read the result back to the CPU (a few frames late, without waiting for the GPU) */
+    virtual void EnableReadback(bool enable) = 0;
+    virtual bool GetResultValues(float values[4]) = 0; // <- false if no result has been read back yet
+
+    virtual ReductionOp GetOp() = 0;
+};
+
+} // NS PostProcessing
+} // NS OpenEngine
+
+#endif
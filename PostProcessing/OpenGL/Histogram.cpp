@@ -0,0 +1,138 @@
+#include "Histogram.h"
+#include "PostProcessingPass.h"
+
+namespace OpenEngine {
+namespace PostProcessing {
+
+/* Create a histogram (see PostProcessingEffect::AddHistogram) */
+Histogram::Histogram(int numBins, float minLog2, float maxLog2, unsigned int position) {
+    if (numBins < 1) throw PostProcessingException("a histogram must have at least one bin");
+    if (minLog2 >= maxLog2) throw PostProcessingException("illegal histogram range (minLog2 must be less than maxLog2)");
+    this->numBins  = numBins;
+    this->minLog2  = minLog2;
+    this->maxLog2  = maxLog2;
+    this->position = position;
+
+    vector<string> fileNames;
+    fileNames.push_back("histogram.vert");
+    fileNames.push_back("histogram.frag");
+    fp  = new FragmentProgram(fileNames);
+    fbo = new FramebufferObject();
+
+    // (32 bit float, as up to a few million points are added to each bin)
+    result = ITexture2DPtr(new Texture2D(numBins, 1, TEX_R32F, TEX_CLAMP_TO_EDGE, TEX_CLAMP_TO_EDGE, TEX_NEAREST, TEX_NEAREST));
+    fbo->AttachColorTexture(result, 0);
+    fbo->SelectDrawBuffers();
+
+    readback = NULL;
+    pointBufferID   = 0; // (generated on the first Execute)
+    pointBufferSize = 0;
+}
+
+Histogram::~Histogram() {
+    delete readback;
+    delete fbo;
+    delete fp;
+    if (pointBufferID != 0) glDeleteBuffers(1, &pointBufferID);
+}
+
+/* Count the lower left width x height texels of input into the bins of the result texture (and start reading it back, if enabled).
+   Called by PostProcessingEffect when the schedule is executed, where the gl state has been backed up */
+void Histogram::Execute(ITexture2DPtr input, int width, int height) {
+    vector<float> size;
+    size.push_back((float)width);
+    size.push_back((float)height);
+    fp->BindTexture("src", input, true);
+    fp->BindFloat("srcSize", size);
+    fp->BindFloat("minLog2", vector<float>(1, minLog2));
+    fp->BindFloat("maxLog2", vector<float>(1, maxLog2));
+    fp->BindFloat("numBins", vector<float>(1, (float)numBins));
+    fp->BindFloat("weight",  vector<float>(1, 1.0f / ((float)width * height))); // <- (so the bins hold fractions of the texels)
+    fp->Bind();
+
+    fbo->Bind();
+    PostProcessingPass::SetProperViewport(numBins, 1);
+    glClearColor(0, 0, 0, 0);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    // one point per texel (the vertex shader gets the texel from gl_VertexID). The vertex data isn't used, but the compatibility
+    // profile only draws vertices when attribute 0 is an enabled array - so a buffer of one byte per point is bound to it
+    int numPoints = width * height;
+    if (pointBufferID == 0) glGenBuffers(1, &pointBufferID);
+    glBindBuffer(GL_ARRAY_BUFFER, pointBufferID);
+    if (numPoints > pointBufferSize) {
+	glBufferData(GL_ARRAY_BUFFER, numPoints, NULL, GL_STATIC_DRAW); // <- (only grows - f.e. with dynamic resolution)
+	pointBufferSize = numPoints;
+    }
+    glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 1, GL_UNSIGNED_BYTE, GL_FALSE, 0, NULL);
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glPointSize(1.0f);
+    glDrawArrays(GL_POINTS, 0, numPoints);
+    glDisable(GL_BLEND);
+
+    glPopClientAttrib();
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    fp->Unbind();
+
+    result->IncrementVersion();
+    if (readback != NULL) readback->Read();
+}
+
+/** Get the numBins x 1 texture holding the fraction of the texels in each bin (the same texture object for the lifetime of
+ *  the histogram, so it can be bound to passes). Bin i covers log2(luminance) from minLog2 + i*(maxLog2-minLog2)/numBins - the
+ *  texels outside the range are counted in the first and last bin.
+ */
+ITexture2DPtr Histogram::GetResult() {
+    return result;
+}
+
+/** Set the luminance range of the bins (see GetResult)
+ *  @param[in] minLog2 log2 of the lowest luminance (f.e. -10)
+ *  @param[in] maxLog2 log2 of the highest luminance (f.e. 6)
+ */
+void Histogram::SetRange(float minLog2, float maxLog2) {
+    if (minLog2 >= maxLog2) throw PostProcessingException("illegal histogram range (minLog2 must be less than maxLog2)");
+    if (minLog2 == this->minLog2 && maxLog2 == this->maxLog2) return;
+    this->minLog2 = minLog2;
+    this->maxLog2 = maxLog2;
+    result->IncrementVersion(); // <- (the result is out of date - so it is counted again, also with result caching)
+}
+
+float Histogram::GetMinLog2() {
+    return minLog2;
+}
+
+float Histogram::GetMaxLog2() {
+    return maxLog2;
+}
+
+int Histogram::GetNumBins() {
+    return numBins;
+}
+
+/** Read the result back to the CPU each time the histogram is executed (see GetResultValues)
+ */
+void Histogram::EnableReadback(bool enable) {
+    if (enable && readback == NULL) readback = new TextureReadback(result);
+    if (!enable) {
+	delete readback;
+	readback = NULL;
+    }
+}
+
+/** Get the result read back to the CPU - the histogram of 2 executions ago (see TextureReadback).
+ *  @param[out] bins the fraction of the texels in each bin (numBins values)
+ *  @return false if no result has been read back yet (see EnableReadback)
+ */
+bool Histogram::GetResultValues(vector<float>& bins) {
+    if (readback == NULL) return false;
+    bins.resize(numBins);
+    return readback->GetData(&bins[0]);
+}
+
+} // NS PostProcessing
+} // NS OpenEngine
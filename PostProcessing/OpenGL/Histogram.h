@@ -0,0 +1,69 @@
+#ifndef __HISTOGRAM_H__
+#define __HISTOGRAM_H__
+
+#include <vector>
+
+#include <PostProcessing/IHistogram.h>
+#include <PostProcessing/PostProcessingException.h>
+#include <Resources/OpenGL/FragmentProgram.h>
+#include <Resources/OpenGL/FramebufferObject.h>
+#include <Resources/OpenGL/Texture2D.h>
+#include <Resources/OpenGL/TextureReadback.h>
+#include <Logging/Logger.h>
+#include <Meta/OpenGL.h>
+
+namespace OpenEngine {
+namespace PostProcessing {
+
+using namespace std;
+using namespace OpenEngine::Resources;
+
+class PostProcessingEffect;
+
+/** A histogram of the luminance of the colorbuffer, computed on the GPU: each texel is drawn as a point at the bin of its
+ *  luminance (the vertex shader reads the texel), and the points are added up by additive blending into a float target
+ *  with one texel per bin. Like Reduction, the result stays on the GPU for passes, and can be read back without stalling.
+ *  @note OpenGL 3.0 (gl_VertexID, texelFetch, float blending) or above only
+ */
+class Histogram : public IHistogram {
+
+  private:
+
+    unsigned int position; // the number of passes of the effect before it (it counts the colorbuffer they output)
+    int   numBins;
+    float minLog2;
+    float maxLog2;
+
+    FragmentProgram*   fp;
+    FramebufferObject* fbo;
+    ITexture2DPtr      result;
+
+    TextureReadback* readback; // NULL if the result isn't read back
+
+    // the array bound to attribute 0 while drawing the points (see Execute) - one unused byte per point
+    GLuint pointBufferID;
+    int    pointBufferSize;
+
+    friend class PostProcessingEffect;
+    Histogram(int numBins, float minLog2, float maxLog2, unsigned int position);
+    ~Histogram();
+
+    void Execute(ITexture2DPtr input, int width, int height);
+
+  public:
+
+    ITexture2DPtr GetResult();
+
+    void  SetRange(float minLog2, float maxLog2);
+    float GetMinLog2();
+    float GetMaxLog2();
+    int   GetNumBins();
+
+    void EnableReadback(bool enable);
+    bool GetResultValues(vector<float>& bins);
+};
+
+} // NS PostProcessing
+} // NS OpenEngine
+
+#endif
@@ -1,12 +1,19 @@
 #include "PostProcessingEffect.h"
+#include <Resources/DirectoryManager.h>
 
 #include <Meta/OpenGL.h>
+#include <string.h>
+#include <algorithm>
 
 /* @author Bjarke N. Laustsen
  */
 namespace OpenEngine {
 namespace PostProcessing {
 
+vector<IUniformBlockPtr> PostProcessingEffect::globalUniformBlocks;
+int PostProcessingEffect::currentChainGeneration = 0;
+int PostProcessingEffect::currentScheduleGeneration = 0;
+
 /** Creates a new PostProcessingEffect object.
  *  Since the size of its FBO-buffers must match the size of the viewport, the viewport must be passed along as arguments.
  *  (if the size of the viewport changes the FBO-buffers are automatically resized)
@@ -14,18 +21,71 @@ namespace PostProcessing {
  *  @param[in] useFloatTextures whether the colorbuffer textures should be floating-point
  */
     PostProcessingEffect::PostProcessingEffect(Viewport* viewport, IEngine& engine, const bool useFloatTextures) : engine(engine) {
+    ConstructorSetup(viewport, useFloatTextures ? TEX_RGBA_FLOAT : TEX_RGBA);
+}
+
+/** Creates a new PostProcessingEffect object, with the colorbuffer textures in the given format.
+ *  The packed formats saves bandwidth in HDR effects: TEX_R11G11B10F is 32 bit per texel (no alpha) against the 64 bit of TEX_RGBA16F,
+ *  and TEX_RGB10A2 gives 10 bit per color component in 32 bit.
+ *  @param[in] viewport the viewport this effects should be applied to
+ *  @param[in] colorBufferFormat the texel format of the colorbuffer textures (must be color-renderable with 3 or 4 components)
+ *  @exception PostProcessingException thrown if the format can't be used for the colorbuffer
+ */
+PostProcessingEffect::PostProcessingEffect(Viewport* viewport, IEngine& engine, TexelFormat colorBufferFormat) : engine(engine) {
+    if (colorBufferFormat!=TEX_RGB  && colorBufferFormat!=TEX_RGBA && colorBufferFormat!=TEX_RGB_FLOAT && colorBufferFormat!=TEX_RGBA_FLOAT &&
+	colorBufferFormat!=TEX_R11G11B10F && colorBufferFormat!=TEX_RGB10A2)
+	throw PostProcessingException("illegal colorbuffer format (must be a RGB or RGBA format)");
+    ConstructorSetup(viewport, colorBufferFormat);
+}
+
+void PostProcessingEffect::ConstructorSetup(Viewport* viewport, TexelFormat colorBufferFormat) {
+    // the fragment programs of the effects themselves (separable.frag, reduce.frag, histogram.vert, ...) are loaded by name
+    static bool pathAppended = false;
+    if (!pathAppended) {
+	DirectoryManager::AppendPath("extensions/PostProcessing/OpenGL/"); // (as the merge nodes do - only once, so the path isn't added per effect)
+	pathAppended = true;
+    }
+
     this->viewport         = viewport;
     this->currScreenWidth  = viewport->GetDimension()[2];
     this->currScreenHeight = viewport->GetDimension()[3];
+    this->bufferWidth      = 0; // (set in SetupFBO)
+    this->bufferHeight     = 0;
+    this->resizeBucket     = 0;
+    this->renderScale      = 1.0f;
+    this->renderWidth      = currScreenWidth;
+    this->renderHeight     = currScreenHeight;
+
+    this->dynamicResolution = false;
+    this->frameBudget       = 16.6f;
+    this->minRenderScale    = 0.5f;
+    this->maxRenderScale    = 1.0f;
+    this->sceneTimer        = NULL;
+    this->framesSinceScaleChange = 0;
+
+    this->numTiers        = 0;
+    this->currentTier     = 0;
+    this->qualityGovernor = false;
+    this->qualityBudget   = 0;
+    this->framesSinceTierChange = 0;
 
     this->fbo       = NULL;
     this->depthTex1.reset();
     this->depthTex2.reset();
     this->colorTex1.reset();
     this->colorTex2.reset();
-    //this->stencilTex.reset();
-
-    this->infLoopDetectionBit = 0;
+    this->colorTex3.reset();
+    this->depthTex3.reset();
+    this->stencilTex.reset();
+    this->stencilFbo     = NULL;
+    this->stencilReadFbo = NULL;
+    this->stencilEnabled = false;
+    this->resultCaching  = false;
+    this->sceneUnchanged = false;
+
+    this->chainGeneration     = -1; // (collected on the first frame)
+    this->scheduleGeneration  = -1; // (compiled on the first frame)
+    this->executedVersion     = -1;
 
     this->finalColorTex.reset();
     this->finalDepthTex.reset();
@@ -33,12 +93,19 @@ namespace PostProcessing {
     this->screenOutput = true;
     this->enabled = true;
 
-    this->useFloatTextures = useFloatTextures;
+    this->colorBufferFormat = colorBufferFormat;
+
+    this->msaaSamples    = 0;
+    this->depthResolve   = DEPTH_RESOLVE_SAMPLE0;
+    this->msaaFbo        = NULL;
+    this->msaaDepthTexID = 0;
 
     this->savedFboID = 0;
 
     this->satup = false;
     this->callPerFrame = false;
+    this->frameIndex   = 0;
+    this->updateBudget = 1.0f;
 
     this->maxColorAttachments = -1; // can't be queried yet, as OpenGL might not been initialized at this point
     this->maxTextureUnits = -1; // can't be queried yet, as OpenGL might not been initialized at this point
@@ -58,10 +125,21 @@ namespace PostProcessing {
 PostProcessingEffect::~PostProcessingEffect() {
     // delete fbo, fbo-textures, fbo-renderbuffer
     delete fbo;
+    delete stencilFbo;
+    delete stencilReadFbo;
+    delete sceneTimer;
+    DeleteMultisampling();
 
     // delete all passes (fragment programs, userbuffers, etc)
     for (unsigned int i=0; i<passes.size(); i++)
         delete passes.at(i);
+    for (unsigned int t=0; t<tierPasses.size(); t++)
+	for (unsigned int i=0; i<tierPasses.at(t).size(); i++)
+	    delete tierPasses.at(t).at(i);
+    for (unsigned int i=0; i<reductions.size(); i++)
+	delete reductions.at(i);
+    for (unsigned int i=0; i<histograms.size(); i++)
+	delete histograms.at(i);
 
     // unregister this object as a module
     engine.ProcessEvent().Detach(*this);
@@ -73,99 +151,354 @@ void PostProcessingEffect::SetupFBO() {
     CHECK_FOR_GL_ERROR();
 
     glGetIntegerv(GL_MAX_DRAW_BUFFERS, &(this->maxColorAttachments));
-    glGetIntegerv(GL_MAX_TEXTURE_UNITS, &(this->maxTextureUnits));
+    glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &(this->maxTextureUnits)); // <- (GL_MAX_TEXTURE_UNITS is the fixed-function limit)
     CHECK_FOR_GL_ERROR();
 
+    bufferWidth  = GetBufferSize(currScreenWidth, 0);
+    bufferHeight = GetBufferSize(currScreenHeight, 0);
+
     fbo       = new FramebufferObject(); // <- the fbo used for "render user-screen" (not for the passes)
     depthTex1 = CreateDepthTex();
     depthTex2 = CreateDepthTex();
     colorTex1 = CreateColorTex();
     colorTex2 = CreateColorTex();
+    if (resultCaching) {
+	colorTex3 = CreateColorTex();
+	depthTex3 = CreateDepthTex();
+    }
     CHECK_FOR_GL_ERROR();
 
     fbo->AttachColorTexture(colorTex1, 0);
-    fbo->AttachDepthTexture(depthTex1);
+    if (stencilEnabled) fbo->AttachDepthStencilTexture(depthTex1);
+    else                fbo->AttachDepthTexture(depthTex1);
     CHECK_FOR_GL_ERROR();
 
     fbo->SelectDrawBuffers();
     CHECK_FOR_GL_ERROR();
+
+    if (stencilEnabled) SetupStencil();
+    CHECK_FOR_GL_ERROR();
+
+    SetupMultisampling();
+    CHECK_FOR_GL_ERROR();
+}
+
+/** Render the user-screen with multisample anti-aliasing.
+ *  The user-screen is then rendered to multisampled renderbuffers, which are resolved into the color/depth-buffer textures
+ *  (with glBlitFramebufferEXT) before the first pass - so the passes (and chained effects) see an ordinary anti-aliased screen.
+ *  The depth-buffer can't be averaged, so depthResolve selects which depth each pixel gets:
+ *   - DEPTH_RESOLVE_SAMPLE0: the depth of one sample (the blit picks it). This is the fastest.
+ *   - DEPTH_RESOLVE_MIN/MAX: the nearest/farthest depth of the samples of the pixel (f.e. MAX for depth-of-field, so edges
+ *     against the background don't get the depth of the foreground). Requires GL_ARB_texture_multisample - otherwise
+ *     DEPTH_RESOLVE_SAMPLE0 is used.
+ *  @param[in] samples the number of samples per pixel (0 disables multisampling). Clamped to what the gfx-card supports.
+ *  @param[in] depthResolve how the depth-buffer is resolved
+ *  @note must not be called between PreRender and PostRender
+ */
+void PostProcessingEffect::SetMultisampling(int samples, DepthResolve depthResolve) {
+    this->msaaSamples  = samples;
+    this->depthResolve = depthResolve;
+    if (satup) SetupMultisampling(); // (otherwise done in SetupFBO)
+}
+
+// create (or recreate, or delete) the multisampled fbo for "render user-screen"
+void PostProcessingEffect::SetupMultisampling() {
+    DeleteMultisampling();
+    if (msaaSamples <= 0) return;
+    if (RenderBuffer::GetMaxSamples() == 0) {
+	logger.warning << "multisampling is not supported by this gfx-card (GL_EXT_framebuffer_multisample) - rendering without" << logger.end;
+	return;
+    }
+
+    // (the FramebufferObject methods restore the bound fbo, but the multisampled depth texture is attached directly)
+    GLint savedFboID;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING_EXT, &savedFboID);
+
+    msaaFbo     = new FramebufferObject();
+    msaaColorRB = IRenderBufferPtr(new RenderBuffer(bufferWidth, bufferHeight, GetRenderBufferFormat(colorBufferFormat), msaaSamples));
+    msaaFbo->AttachColorRenderBuffer(msaaColorRB, 0);
+
+    // (the stencil can't be resolved in the shader, so with a stencil buffer depth is always resolved by the blit)
+    bool resolveInShader = depthResolve != DEPTH_RESOLVE_SAMPLE0 && HasMultisampleTextures() && !stencilEnabled;
+    if (depthResolve != DEPTH_RESOLVE_SAMPLE0 && !resolveInShader)
+	logger.warning << "min/max depth resolve requires GL_ARB_texture_multisample and no stencil buffer - the depth of the first sample is used instead" << logger.end;
+
+    if (!resolveInShader && stencilEnabled) {
+	msaaDepthRB = IRenderBufferPtr(new RenderBuffer(bufferWidth, bufferHeight, RB_DEPTH_STENCIL, msaaSamples));
+	msaaFbo->AttachDepthStencilRenderBuffer(msaaDepthRB);
+    } else if (!resolveInShader) {
+	msaaDepthRB = IRenderBufferPtr(new RenderBuffer(bufferWidth, bufferHeight, RB_DEPTH, msaaSamples));
+	msaaFbo->AttachDepthRenderBuffer(msaaDepthRB);
+    }
+#ifdef GL_ARB_texture_multisample
+    else {
+	glGenTextures(1, &msaaDepthTexID);
+	glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, msaaDepthTexID);
+	glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, msaaColorRB->GetSamples(), GL_DEPTH_COMPONENT24, bufferWidth, bufferHeight, GL_TRUE);
+	glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, 0);
+
+	msaaFbo->Bind();
+	glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT, GL_DEPTH_ATTACHMENT_EXT, GL_TEXTURE_2D_MULTISAMPLE, msaaDepthTexID, 0);
+
+	char samplesStr[16];
+	sprintf(samplesStr, "%d", msaaColorRB->GetSamples());
+	ShaderDefines defines;
+	defines["SAMPLES"] = samplesStr;
+	defines[depthResolve == DEPTH_RESOLVE_MAX ? "DEPTH_RESOLVE_MAX" : "DEPTH_RESOLVE_MIN"] = "1";
+	depthResolveProgram = FragmentProgramRegistry::GetProgram(vector<string>(1, "depthresolve.frag"), defines);
+    }
+#endif
+
+    msaaFbo->SelectDrawBuffers();
+    glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, (GLuint)savedFboID);
+    CHECK_FOR_GL_ERROR();
+}
+
+void PostProcessingEffect::DeleteMultisampling() {
+    delete msaaFbo;
+    msaaFbo = NULL;
+    msaaColorRB.reset();
+    msaaDepthRB.reset();
+    if (msaaDepthTexID != 0) glDeleteTextures(1, &msaaDepthTexID);
+    msaaDepthTexID = 0;
+    depthResolveProgram.reset();
+}
+
+/* resolve the multisampled user-screen into colorTex1/depthTex1 (the "render user-screen" fbo).
+   called from PostRender, where the gl state has been backed up and depth-test set to GL_ALWAYS */
+void PostProcessingEffect::ResolveMultisampling() {
+    GLbitfield mask = GL_COLOR_BUFFER_BIT;
+    if (msaaDepthTexID == 0) mask |= GL_DEPTH_BUFFER_BIT; // <- sample-0 resolve (the samples can't be averaged for depth, so the blit picks one)
+    if (stencilEnabled)      mask |= GL_STENCIL_BUFFER_BIT;
+
+    glBindFramebufferEXT(GL_READ_FRAMEBUFFER_EXT, (GLuint)msaaFbo->GetID());
+    glBindFramebufferEXT(GL_DRAW_FRAMEBUFFER_EXT, (GLuint)fbo->GetID());
+    glBlitFramebufferEXT(0, 0, renderWidth, renderHeight, 0, 0, renderWidth, renderHeight, mask, GL_NEAREST);
+    glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, (GLuint)fbo->GetID());
+    CHECK_FOR_GL_ERROR();
+
+#ifdef GL_ARB_texture_multisample
+    if (msaaDepthTexID != 0) {
+	// min/max resolve: draw a quad that only writes depth, taken from all the samples of each pixel
+	depthResolveProgram->Resolve();
+	glUseProgram(depthResolveProgram->GetID());
+	int unit = depthResolveProgram->GetSamplerUnit("msDepthBuf");
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, msaaDepthTexID);
+
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	glDepthMask(GL_TRUE);
+	PostProcessingPass::SetProperViewport(renderWidth, renderHeight);
+	PostProcessingPass::PerformGpuComputation(renderWidth, renderHeight); // (the program reads the samples with gl_FragCoord - no texture coordinates)
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+	glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glUseProgram(0);
+	CHECK_FOR_GL_ERROR();
+    }
+#endif
+}
+
+// whether multisampled textures (GL_ARB_texture_multisample) are supported - needed for the min/max depth resolve
+bool PostProcessingEffect::HasMultisampleTextures() {
+    static int supported = -1;
+    if (supported == -1) {
+#ifdef GL_ARB_texture_multisample
+	const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+	supported = (extensions != NULL && strstr(extensions, "GL_ARB_texture_multisample") != NULL) ? 1 : 0;
+#else
+	supported = 0;
+#endif
+    }
+    return supported == 1;
+}
+
+// the renderbuffer format matching the colorbuffer format (they must match for the blit)
+PixelFormat PostProcessingEffect::GetRenderBufferFormat(TexelFormat format) {
+    switch (format) {
+	case TEX_RGB:	     return RB_RGB;
+	case TEX_RGBA:	     return RB_RGBA;
+	case TEX_RGB_FLOAT:  return RB_RGB16F;
+	case TEX_RGBA_FLOAT: return RB_RGBA16F;
+	case TEX_R11G11B10F: return RB_R11G11B10F;
+	case TEX_RGB10A2:    return RB_RGB10A2;
+	default:             throw PostProcessingException("no multisampled renderbuffer format for the colorbuffer format");
+    }
 }
 
 
 ITexture2DPtr PostProcessingEffect::CreateColorTex() {
-    ITexture2DPtr tex;
-    if (useFloatTextures)
-	tex = ITexture2DPtr(new Texture2D(currScreenWidth, currScreenHeight, TEX_RGBA_FLOAT, TEX_CLAMP_TO_EDGE, TEX_CLAMP_TO_EDGE, TEX_LINEAR, TEX_LINEAR));
-    else
-	tex = ITexture2DPtr(new Texture2D(currScreenWidth, currScreenHeight, TEX_RGBA      , TEX_CLAMP_TO_EDGE, TEX_CLAMP_TO_EDGE, TEX_LINEAR, TEX_LINEAR));
-    return tex;
+    return ITexture2DPtr(new Texture2D(bufferWidth, bufferHeight, colorBufferFormat, TEX_CLAMP_TO_EDGE, TEX_CLAMP_TO_EDGE, TEX_LINEAR, TEX_LINEAR));
 }
 
 ITexture2DPtr PostProcessingEffect::CreateDepthTex() {
-    return ITexture2DPtr(new Texture2D(currScreenWidth, currScreenHeight, TEX_DEPTH, TEX_CLAMP_TO_EDGE, TEX_CLAMP_TO_EDGE, TEX_NEAREST, TEX_NEAREST));
+    TexelFormat format = stencilEnabled ? TEX_DEPTH_STENCIL : TEX_DEPTH;
+    return ITexture2DPtr(new Texture2D(bufferWidth, bufferHeight, format, TEX_CLAMP_TO_EDGE, TEX_CLAMP_TO_EDGE, TEX_NEAREST, TEX_NEAREST));
 }
 
-/*
-ITexture2DPtr PostProcessingEffect::CreateDepthStencilTex() {
-    return ITexture2DPtr(new Texture2D(currScreenWidth, currScreenHeight, TEX_DEPTH_STENCIL, TEX_REPEAT, TEX_REPEAT, TEX_NEAREST, TEX_NEAREST));
+/** Give the user-screen a stencil buffer.
+ *  The depth-buffer textures become packed depth-stencil textures (TEX_DEPTH_STENCIL), so the scene can write stencil values
+ *  (f.e. tag water or characters), which passes can be masked with (see PostProcessingPass::EnableStencilMask). It is cleared
+ *  to 0 in PreRender. A chained effect sees the stencil of the effect it is chained to, if that effect has a stencil buffer too.
+ *  Can be called before or after setup (f.e. in Setup), but not between PreRender and PostRender.
+ */
+void PostProcessingEffect::EnableStencilBuffer() {
+    if (stencilEnabled) return;
+    stencilEnabled = true;
+    InvalidateSchedules();
+    if (!satup) return; // (done in SetupFBO)
+
+    depthTex1->Resize(bufferWidth, bufferHeight, TEX_DEPTH_STENCIL);
+    depthTex2->Resize(bufferWidth, bufferHeight, TEX_DEPTH_STENCIL);
+    if (depthTex3.get() != NULL) depthTex3->Resize(bufferWidth, bufferHeight, TEX_DEPTH_STENCIL);
+    fbo->AttachDepthStencilTexture(depthTex1);
+    SetupStencil();
+    SetupMultisampling();
+    CHECK_FOR_GL_ERROR();
+}
+
+/** whether the user-screen has a stencil buffer
+ */
+bool PostProcessingEffect::IsStencilBufferEnabled() {
+    return stencilEnabled;
+}
+
+// create the texture the stencil of the user-screen is copied to for stencil-masked passes, and the fbos used for copying
+void PostProcessingEffect::SetupStencil() {
+    delete stencilFbo;
+    delete stencilReadFbo;
+    stencilTex     = CreateDepthTex();
+    stencilFbo     = new FramebufferObject();
+    stencilReadFbo = new FramebufferObject();
+    stencilFbo->AttachDepthStencilTexture(stencilTex);
+}
+
+/* copy the stencil of the user-screen (or of the effect this is chained to) to stencilTex.
+   (the passes can't have the stencil of the depth-buffer attached, as they may sample the depth-buffer, and the passes writing
+   depth ping-pong between the depth-buffers - so the stencil is only kept in stencilTex) */
+void PostProcessingEffect::CopyStencil(ITexture2DPtr depthStencilTex) {
+    if (depthStencilTex->GetFormat() != TEX_DEPTH_STENCIL) throw PostProcessingException("stencil-masked passes in a chained effect need a stencil buffer in the effect it is chained to as well");
+
+    stencilReadFbo->AttachDepthStencilTexture(depthStencilTex);
+    glBindFramebufferEXT(GL_READ_FRAMEBUFFER_EXT, (GLuint)stencilReadFbo->GetID());
+    glReadBuffer(GL_NONE);
+    glBindFramebufferEXT(GL_DRAW_FRAMEBUFFER_EXT, (GLuint)stencilFbo->GetID());
+    glDrawBuffer(GL_NONE);
+    glBlitFramebufferEXT(0, 0, renderWidth, renderHeight, 0, 0, renderWidth, renderHeight, GL_STENCIL_BUFFER_BIT, GL_NEAREST);
+    glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);
+    CHECK_FOR_GL_ERROR();
+}
+
+bool PostProcessingEffect::HasStencilMaskedPasses() {
+    for (unsigned int i=0; i<passes.size(); i++)
+	if (passes.at(i)->IsStencilMasked()) return true;
+    return false;
 }
-*/
 
 /** Call before rendering the screen (to bind FBO, resize if viewport has been resized and setup everything on the first frame)
  *
  *  Its main purpose is to bind the FBO which the user-screen rendering is 'recorded' to, but is also does other setup stuff.
- *  It calls Resize if the viewport has been resized, and calls PreRender on all chained effects (their FBOs are not bound, however),
- *  to setup them, and a few other settings.
+ *  It calls Resize if the viewport has been resized (on all chained effects as well), and sets up the chained effects.
  *  On the first frame it calls the setup method. (this is done here instead of in the constructor, as OpenEngine doesn't setup
  *  OpenGL before very late in the startup process)
- *
- *  @exception PostProcessingException thrown if this PostProcessingEffect has been chained as child of itself (see the Add method)
+ *  The chained effects are only traversed when the chains have changed (see Add) - otherwise they are just resized with this one.
  */
 void PostProcessingEffect::PreRender() {
-    PreRender(true);
-}
-
-void PostProcessingEffect::PreRender(bool bindFbo) {
 
     CHECK_FOR_GL_ERROR();
-    // check for chain inf-loop
-    if (infLoopDetectionBit == 1) throw PostProcessingException("chain inf-loop detected");
 
-    // setup on first frame on this PPE and all chained PPEs (also new PPEs which might have been added since last frame)
+    // setup on first frame on this PPE
     CallSetup();
     CHECK_FOR_GL_ERROR();
 
+    // swap in hot-reloaded fragment programs (if enabled) - done here, as no passes are being executed
+    FragmentProgramRegistry::Update();
+    CHECK_FOR_GL_ERROR();
 
      // check if viewport has been resized. If so, resize all buffers (incl. chained)
-    if (viewport->GetDimension()[2] != currScreenWidth || viewport->GetDimension()[3] != currScreenHeight)
-        Resize(viewport->GetDimension()[2], viewport->GetDimension()[3]);
+    bool resized = CheckResize();
     CHECK_FOR_GL_ERROR();
 
+    // adjust the render scale to the GPU times measured (if dynamic resolution is enabled) - the scene must be rendered again if it changed
+    int oldRenderWidth  = renderWidth;
+    int oldRenderHeight = renderHeight;
+    UpdateDynamicResolution();
+    if (renderWidth != oldRenderWidth || renderHeight != oldRenderHeight) resized = true;
+
+    // the engine may have bound or deleted textures since the passes were executed last frame
+    FragmentProgram::InvalidateTextureUnitCache();
+
+    // the user-screen is changed by rendering the scene - unless SetSceneUnchanged has been called, then it is kept (not even cleared)
+    // (it can only be kept with result caching, as the passes write to colorTex1/depthTex1 otherwise, and it is lost when resized)
+    if (resized || !resultCaching) sceneUnchanged = false;
+    if (!sceneUnchanged) {
+	colorTex1->IncrementVersion();
+	depthTex1->IncrementVersion();
+    }
+
     // don't need to clear normal framebuffer buffers, since they will completely be overwritten (faster!)
 
-    // if any PPEs are chained to this one, call PerFrame on them as well (but don't bind their fbo) (must be done after CallSetup())
+    // if the chains have changed, collect the PPEs chained to this one again, and setup the new ones (must be done after CallSetup())
+    // (repeated, as their Setup may chain more PPEs)
+    while (chainGeneration != currentChainGeneration) {
+	chainGeneration = currentChainGeneration;
+	allChainedEffects.clear();
+	ownViewportEffects.clear();
+	CollectChainedEffects(this);
+	for (unsigned int i=0; i<allChainedEffects.size(); i++) {
+	    PostProcessingEffect* ppe = allChainedEffects.at(i);
+	    ppe->SetResizeBucket(resizeBucket); // <- (they are given the buffers of this PPE as input, so the buffer sizes must match)
+	    ppe->SetRenderScale(renderScale);   // <- (and so must the part of them rendered to)
+	    ppe->CallSetup();
+	}
+	resized = true; // <- (check them all)
+    }
     CHECK_FOR_GL_ERROR();
-    for (unsigned int i=0; i<chainedEffects.size(); i++) {
-        PostProcessingEffect* ppe = chainedEffects.at(i);
-        ppe->PreRender(false);
+
+    // switch the quality tiers of this PPE and the chained PPEs to the GPU times measured (if their governors are enabled)
+    UpdateQualityTier();
+    for (unsigned int i=0; i<allChainedEffects.size(); i++) allChainedEffects.at(i)->UpdateQualityTier();
+    CHECK_FOR_GL_ERROR();
+
+    // resize the chained PPEs along with this one (only those with their own viewport are checked every frame)
+    vector<PostProcessingEffect*>& check = resized ? allChainedEffects : ownViewportEffects;
+    for (unsigned int i=0; i<check.size(); i++) {
+	check.at(i)->SetRenderScale(renderScale);
+	check.at(i)->CheckResize();
     }
     CHECK_FOR_GL_ERROR();
 
     // bind the fbo the userscreen should be rendered to
-    if (bindFbo) {
 
-	// remember the currently bound fbo, so we can restore it again after postRender (can't be done with pushAttrib())
+    // remember the currently bound fbo, so we can restore it again after postRender (can't be done with pushAttrib())
     if (savedFboID != 0) throw PostProcessingException("internal error");
-	glGetIntegerv(GL_FRAMEBUFFER_BINDING_EXT, &savedFboID);
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING_EXT, &savedFboID);
     CHECK_FOR_GL_ERROR();
 
-	// bind fbo for "render user-screen"
-	fbo->Bind();
+    // (the buffers may have moved to new texture-handles since they were attached, f.e. when their settings are changed)
+    fbo->RefreshAttachments();
+    if (stencilFbo != NULL) stencilFbo->RefreshAttachments();
+
+    // bind fbo for "render user-screen" (the multisampled one, if multisampling)
+    if (msaaFbo != NULL) msaaFbo->Bind();
+    else                 fbo->Bind();
     CHECK_FOR_GL_ERROR();
 
-	// clear done here since its not done in rendering view, and has to be done _after_ the fbo is bound.
+    // clear done here since its not done in rendering view, and has to be done _after_ the fbo is bound.
+    if (sceneUnchanged) ; // <- (kept)
+    else if (stencilEnabled) {
+	glPushAttrib(GL_STENCIL_BUFFER_BIT);
+	glStencilMask(~0); // <- (the stencil writemask also applies to glClear)
+	glClearStencil(0);
+	glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT );
+	glPopAttrib();
+    } else
 	glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
-    }
+
+    // the scene is rendered to the lower left renderWidth x renderHeight part of the buffers (see GetRenderSize)
+    glViewport(0, 0, renderWidth, renderHeight);
+    if (sceneTimer != NULL) sceneTimer->Begin();
 
     // check if all went well
     CHECK_FOR_GL_ERROR();
@@ -186,6 +519,8 @@ void PostProcessingEffect::PostRender() {
 
     /*** backup user OpenGL-state etc ***/
 
+    if (sceneTimer != NULL) sceneTimer->End();
+
     // disable fbo again - we have now rendered the screen
     fbo->Unbind();
 
@@ -200,6 +535,9 @@ void PostProcessingEffect::PostRender() {
     // unbind any textures that may have been bound
     glBindTexture(GL_TEXTURE_2D, 0);
 
+    // the scene may have bound textures to any texture unit since the passes were executed last frame
+    FragmentProgram::InvalidateTextureUnitCache();
+
     glEnable(GL_TEXTURE_2D);   // <- vores final quad skal have texture p (de andre klares af fragment programmerne)
     glDisable(GL_LIGHTING);    // <- eventuelle lyskilder skal ikke ndre farverne af vores quad
     glEnable(GL_DEPTH_TEST);   // <- vi skal sl depth test fra, ellers kan vi ikke tegne quaden samme sted uden at cleare frst (langsomt i forhold til ikke at gre det)
@@ -210,8 +548,13 @@ void PostProcessingEffect::PostRender() {
     glDisable(GL_TEXTURE_3D);
     glDisable(GL_TEXTURE_RECTANGLE_EXT);
 
+    // resolve the multisampled user-screen into colorTex1/depthTex1
+    if (msaaFbo != NULL && !sceneUnchanged) ResolveMultisampling();
+
     /*** do the postprocessing! ***/
-    PostRender(colorTex1, depthTex1, screenOutput);
+    // (the passes of this PPE and the chained PPEs are compiled into one schedule, which is only compiled again when something changes)
+    if (scheduleGeneration != currentScheduleGeneration) CompileSchedule();
+    ExecuteSchedule();
 
     /*** restore user OpenGL-state ***/
 
@@ -223,44 +566,179 @@ void PostProcessingEffect::PostRender() {
     glPopMatrix();
     glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, (GLuint)savedFboID);
     savedFboID = 0;
+    sceneUnchanged = false; // <- (only for one frame)
 }
 
-// postRender er i 2 funktioner for at kunne sende depth-info med fra ppe til chained-ppe
-void PostProcessingEffect::PostRender(ITexture2DPtr colorTex1Param, ITexture2DPtr depthTex1Param, bool output2screen) {
-    infLoopDetectionBit = 1;
+/* Compile the passes of this PPE and all PPEs chained to it into one flat schedule (see Schedule).
+   Done on the first frame, and again whenever something the schedule depends on has changed (see InvalidateSchedules) */
+void PostProcessingEffect::CompileSchedule() {
+    schedule.clear();
+    scheduledEffects.clear();
+    ITexture2DPtr colorTex = colorTex1;
+    ITexture2DPtr depthTex = depthTex1;
+    Schedule(this, colorTex, depthTex);
+    scheduleGeneration = currentScheduleGeneration;
+    executedVersion    = -1;
+}
+
+// schedule er rekursiv for at kunne sende depth-info med fra ppe til chained-ppe
+/* Append the passes of this PPE (and of the PPEs chained to it) to the schedule of root (the PPE being compiled), with the textures
+   each pass reads and writes assigned. The textures never change after setup (resizing keeps the objects), so when the schedule
+   has been compiled, executing a frame is just running through it.
+   @param[in,out] colorTex in: the input colorbuffer texture. out: the final colorbuffer texture of this PPE (after the chained ones)
+   @param[in,out] depthTex as above, for the depthbuffer */
+void PostProcessingEffect::Schedule(PostProcessingEffect* root, ITexture2DPtr& colorTex, ITexture2DPtr& depthTex) {
+    // (the chains can't have loops - see Add)
 
     // bugfix since project hand-in: make sure colorTex1Param, depthTex1Param has same wrap/filter settings as colorTex1, depthTex1
     // (otherwise wrap/filter-settings won't work for chained effects. This fix won't be needed in V2.)
-    SetSameFilterWrap(colorTex1, colorTex1Param);
-    SetSameFilterWrap(depthTex1, depthTex1Param);
-
-    // execute each pass (swap textures roles as input/output`- the "ping pong" technique)
-    ITexture2DPtr inputColorTex  = colorTex1Param;
+    // (done once here instead of every frame - changing the settings recompiles the schedule)
+    SetSameFilterWrap(colorTex1, colorTex);
+    SetSameFilterWrap(depthTex1, depthTex);
+
+    // assign the textures of each pass (swap textures roles as input/output`- the "ping pong" technique)
+    // (with result caching, passes reading the user-screen ping-pong between the 2nd texture and the 3rd texture of root instead, so
+    //  the user-screen isn't overwritten - not only in root: if root has no passes, the first chained effect gets the user-screen)
+    bool protectColor = root->resultCaching && colorTex == root->colorTex1;
+    bool protectDepth = root->resultCaching && depthTex == root->depthTex1;
+    ITexture2DPtr inputColorTex  = colorTex;
     ITexture2DPtr outputColorTex = colorTex2;
-    ITexture2DPtr inputDepthTex  = depthTex1Param;
+    ITexture2DPtr otherColorTex  = protectColor ? root->colorTex3 : colorTex;
+    ITexture2DPtr inputDepthTex  = depthTex;
     ITexture2DPtr outputDepthTex = depthTex2;
+    ITexture2DPtr otherDepthTex  = protectDepth ? root->depthTex3 : depthTex;
+
+    // the stencil of the user-screen for stencil-masked passes (copied, as the depth-buffers are swapped by the passes)
+    ITexture2DPtr passStencilTex;
+    if (enabled && stencilEnabled && HasStencilMaskedPasses()) {
+	ScheduledPass copy;
+	copy.pass      = NULL; // <- copy the stencil of depthIn
+	copy.reduction = NULL;
+	copy.histogram = NULL;
+	copy.effect  = this;
+	copy.depthIn = depthTex;
+	copy.outputs.push_back(stencilTex);
+	copy.inputVersion  = -1;
+	copy.outputVersion = -1;
+	root->schedule.push_back(copy);
+	passStencilTex = stencilTex;
+    }
 
     if (enabled) for (unsigned int i=0; i<passes.size(); i++) {
 	PostProcessingPass* pass = passes.at(i);
-
-	// execute the pass
-	pass->Execute(inputColorTex, outputColorTex, inputDepthTex, outputDepthTex, viewport); //currScreenWidth, currScreenHeight);
+	ScheduleReductions(root, i, inputColorTex);
+
+	ScheduledPass step;
+	step.pass      = pass;
+	step.reduction = NULL;
+	step.histogram = NULL;
+	step.effect   = this;
+	step.colorIn  = inputColorTex;
+	step.colorOut = outputColorTex;
+	step.depthIn  = inputDepthTex;
+	step.depthOut = outputDepthTex;
+	step.stencil  = passStencilTex;
+	if (pass->IsColorBufferOutput()) step.outputs.push_back(outputColorTex);
+	if (pass->IsDepthBufferOutput()) step.outputs.push_back(outputDepthTex);
+	for (unsigned int j=0; j<pass->userBufferTextures.size(); j++)
+	    if (pass->userBufferTextures.at(j).get() != NULL) step.outputs.push_back(pass->userBufferTextures.at(j));
+	step.inputVersion  = -1;
+	step.outputVersion = -1;
+	root->schedule.push_back(step);
 
 	// if the fp of this pass is writing to the color-buffer, swap input/output textures AFTER executing it. Same for depth-buffer. (must be done AFTER!! see old bug in main.cpp)
-	if (pass->IsColorBufferOutput()) Swap(&inputColorTex, &outputColorTex);
-	if (pass->IsDepthBufferOutput()) Swap(&inputDepthTex, &outputDepthTex);
+	if (pass->IsColorBufferOutput()) {
+	    inputColorTex  = outputColorTex;
+	    outputColorTex = (outputColorTex == colorTex2) ? otherColorTex : colorTex2;
+	}
+	if (pass->IsDepthBufferOutput()) {
+	    inputDepthTex  = outputDepthTex;
+	    outputDepthTex = (outputDepthTex == depthTex2) ? otherDepthTex : depthTex2;
+	}
     }
+    if (enabled) ScheduleReductions(root, passes.size(), inputColorTex); // <- (and those added after more passes than there are)
 
-    // swap a final time to get correct final output textures
-    Swap(&inputColorTex, &outputColorTex);
-    Swap(&inputDepthTex, &outputDepthTex);
-
-    // if any PPEs are chained to this one, execute them, and get the final color and depth texture of the last PPE
+    // if any PPEs are chained to this one, schedule them, and get the final color and depth texture of the last PPE
+    // (the output of the last pass is the input of the next)
     for (unsigned int i=0; i<chainedEffects.size(); i++) {
 	PostProcessingEffect* ppe = chainedEffects.at(i);
-	ppe->PostRender(outputColorTex, outputDepthTex, false); // false, so that the chained ppes doesn't output to screen, just to texture
-	outputColorTex = ppe->GetFinalColorBufferRef();
-	outputDepthTex = ppe->GetFinalDepthBufferRef();
+	ppe->Schedule(root, inputColorTex, inputDepthTex);
+    }
+
+    // used by getColorbuffer and getDepthbuffer (set when the schedule is executed, as a PPE may be chained to several PPEs)
+    ScheduledEffect scheduled;
+    scheduled.effect        = this;
+    scheduled.finalColorTex = inputColorTex;
+    scheduled.finalDepthTex = inputDepthTex;
+    root->scheduledEffects.push_back(scheduled);
+
+    colorTex = inputColorTex;
+    depthTex = inputDepthTex;
+}
+
+/* Append the reductions and histograms of this PPE which are added after position passes to the schedule of root, reducing
+   colorTex (position = the number of passes: all the remaining) */
+void PostProcessingEffect::ScheduleReductions(PostProcessingEffect* root, unsigned int position, ITexture2DPtr colorTex) {
+    for (unsigned int i=0; i<reductions.size() + histograms.size(); i++) {
+	Reduction* reduction = (i < reductions.size()) ? reductions.at(i) : NULL;
+	Histogram* histogram = (i < reductions.size()) ? NULL : histograms.at(i - reductions.size());
+	unsigned int added = (reduction != NULL) ? reduction->position : histogram->position;
+	if (added != position && !(position == passes.size() && added > position)) continue;
+	ScheduledPass step;
+	step.pass      = NULL;
+	step.reduction = reduction;
+	step.histogram = histogram;
+	step.effect    = this;
+	step.colorIn   = colorTex;
+	step.outputs.push_back((reduction != NULL) ? reduction->GetResult() : histogram->GetResult());
+	step.inputVersion  = -1;
+	step.outputVersion = -1;
+	root->schedule.push_back(step);
+    }
+}
+
+/* execute the compiled schedule (the passes of this PPE and all PPEs chained to it), and output the result to the screen.
+   With result caching, the steps whose inputs are the same as when they were executed last - and whose outputs haven't been
+   overwritten since - are skipped. If nothing at all has changed since last frame, only the screen output is done. */
+void PostProcessingEffect::ExecuteSchedule() {
+    bool unchanged = resultCaching && GetScheduleVersion() == executedVersion;
+    bool partial   = false; // <- whether a pass updating part of its pixels was executed (then the next frame can't be unchanged)
+
+    for (unsigned int i=0; i<scheduledEffects.size(); i++) scheduledEffects[i].effect->SelectBudgetedPasses();
+
+    if (!unchanged) for (unsigned int i=0; i<schedule.size(); i++) {
+	ScheduledPass& step = schedule[i];
+	if (step.pass != NULL && !step.pass->IsUpdated(step.effect->frameIndex)) continue; // <- amortized (the output is kept)
+	if (step.pass != NULL) step.pass->lastUpdateFrame = step.effect->frameIndex;
+	bool partialStep = (step.pass != NULL && step.pass->IsPartiallyUpdated());
+	int inputVersion = GetInputVersion(step);
+	if (resultCaching && !partialStep && inputVersion == step.inputVersion && GetOutputVersion(step) == step.outputVersion) continue; // <- up to date
+
+	if (step.reduction != NULL) step.reduction->Execute(step.colorIn, step.effect->renderWidth, step.effect->renderHeight);
+	else if (step.histogram != NULL) step.histogram->Execute(step.colorIn, step.effect->renderWidth, step.effect->renderHeight);
+	else if (step.pass == NULL) step.effect->CopyStencil(step.depthIn);
+	else step.pass->Execute(step.colorIn, step.colorOut, step.depthIn, step.depthOut, step.effect->renderWidth, step.effect->renderHeight, step.stencil, step.effect->frameIndex);
+
+	for (unsigned int j=0; j<step.outputs.size(); j++) step.outputs.at(j)->IncrementVersion();
+	step.inputVersion  = inputVersion;
+	step.outputVersion = GetOutputVersion(step);
+	partial = partial || partialStep;
+    }
+    if (resultCaching) executedVersion = partial ? -1 : GetScheduleVersion();
+
+    // used by getColorbuffer and getDepthbuffer, and flag that the PerFrame method of the effects should be called
+    for (unsigned int i=0; i<scheduledEffects.size(); i++) {
+	ScheduledEffect& scheduled = scheduledEffects[i];
+	scheduled.effect->finalColorTex = scheduled.finalColorTex;
+	scheduled.effect->finalDepthTex = scheduled.finalDepthTex;
+	scheduled.effect->callPerFrame  = true;
+    }
+
+    // keep the final buffers of the effects with history buffers (the final buffers of the effects may be replaced by the history)
+    for (unsigned int i=0; i<scheduledEffects.size(); i++) {
+	PostProcessingEffect* ppe = scheduledEffects[i].effect;
+	RotateHistory(ppe->colorHistory, ppe->finalColorTex, true);
+	RotateHistory(ppe->depthHistory, ppe->finalDepthTex, false);
     }
 
     // unbind any fbos
@@ -270,24 +748,173 @@ void PostProcessingEffect::PostRender(ITexture2DPtr colorTex1Param, ITexture2DPt
     glDrawBuffer(GL_BACK);
 
     // render the final output color texture to screen, if output to screen is enabled
-    if (output2screen) {
+    // (upscaled to the viewport with the filter of the texture, if rendered at a smaller size - see SetRenderScale)
+    if (screenOutput) {
 	glColor3f(1,1,1);
 	PostProcessingPass::SetProperViewport(viewport, false);
-	outputColorTex->Bind();
-	PostProcessingPass::PerformGpuComputation(viewport);
-	outputColorTex->Unbind();
+	finalColorTex->Bind();
+	PostProcessingPass::PerformGpuComputation(currScreenWidth, currScreenHeight, renderWidth / (float)bufferWidth, renderHeight / (float)bufferHeight);
+	finalColorTex->Unbind();
     }
 
-    // used by getColorbuffer and getDepthbuffer
-    this->finalColorTex = outputColorTex;
-    this->finalDepthTex = outputDepthTex;
+    CheckGLErrors ("postRender");
+}
+
+/* Get the texture holding the given buffer of the given number of frames back (for PostProcessingPass::BindHistoryBuffer).
+   The ring is extended if it is shorter. */
+ITexture2DPtr PostProcessingEffect::GetHistoryBuffer(HistoryBuffer buffer, int framesBack) {
+    if (!satup) throw PostProcessingException("method BindHistoryBuffer called before setup");
+    vector<ITexture2DPtr>& history = (buffer == HISTORY_COLORBUFFER) ? colorHistory : depthHistory;
+    while ((int)history.size() < framesBack)
+	history.push_back((buffer == HISTORY_COLORBUFFER) ? CreateColorTex() : CreateDepthTex());
+    return history.at(framesBack-1);
+}
 
-    // flag that the PerFrame method of this effect should be called
-    callPerFrame = true;
+/* Shift the history one frame back, and keep finalTex (the final buffer of this frame) as the last frame - without copying:
+   the textures of the ring swap content, so the oldest frame ends up in finalTex, which is written again next frame.
+   (this PPE is the one executing the schedule - its user-screen is copied, not swapped, when it must be kept) */
+void PostProcessingEffect::RotateHistory(vector<ITexture2DPtr>& history, ITexture2DPtr finalTex, bool color) {
+    if (history.empty()) return;
+
+    // the ring follows the size and format of the final buffer (it is only reallocated if they have changed - f.e. on resize)
+    for (unsigned int i=0; i<history.size(); i++)
+	history.at(i)->Resize(finalTex->GetWidth(), finalTex->GetHeight(), finalTex->GetFormat());
+
+    // S1 -> S2 -> ... -> SN, and the oldest to S1
+    for (unsigned int i=history.size()-1; i>0; i--) history.at(i)->SwapContent(history.at(i-1));
+
+    // is finalTex written by a pass of the schedule? (otherwise it is the user-screen, or the history of another PPE)
+    bool written = false;
+    for (unsigned int i=0; i<schedule.size() && !written; i++)
+	for (unsigned int j=0; j<schedule[i].outputs.size() && !written; j++)
+	    written = (schedule[i].outputs.at(j) == finalTex);
+    if (!written) {
+	finalTex->Clone(history.at(0));
+	return;
+    }
 
-    infLoopDetectionBit = 0;
+    SetSameFilterWrap(finalTex, history.at(0)); // <- (the settings are swapped too, and the oldest frame becomes finalTex)
+    finalTex->SwapContent(history.at(0));
 
-    CheckGLErrors ("postRender");
+    // the final buffers now holding this frame are in the history instead
+    for (unsigned int i=0; i<scheduledEffects.size(); i++) {
+	PostProcessingEffect* ppe = scheduledEffects[i].effect;
+	if (color && ppe->finalColorTex == finalTex) ppe->finalColorTex = history.at(0);
+	if (!color && ppe->finalDepthTex == finalTex) ppe->finalDepthTex = history.at(0);
+    }
+
+    // the user-screen was swapped (without result caching the passes ping-pong through it) - attach it again
+    if (finalTex == colorTex1) fbo->AttachColorTexture(colorTex1, 0);
+    if (finalTex == depthTex1) {
+	if (stencilEnabled) fbo->AttachDepthStencilTexture(depthTex1);
+	else                fbo->AttachDepthTexture(depthTex1);
+    }
+}
+
+// the content version of tex (0 if NULL)
+int PostProcessingEffect::GetVersion(ITexture2DPtr tex) {
+    return (tex.get() == NULL) ? 0 : tex->GetVersion();
+}
+
+/* the versions of everything the step reads, summed. (all versions only increase, so the sum is unchanged iff they all are)
+   The inputs of the fragment program include the uniforms and the textures bound to it, f.e. the userbuffers of other passes */
+int PostProcessingEffect::GetInputVersion(ScheduledPass& step) {
+    int version = GetVersion(step.colorIn) + GetVersion(step.depthIn) + GetVersion(step.stencil);
+    if (step.pass != NULL) version += step.pass->fp->GetInputVersion();
+    return version;
+}
+
+// the versions of the textures the step writes to, summed (changed if they have been written to since the step was executed)
+int PostProcessingEffect::GetOutputVersion(ScheduledPass& step) {
+    int version = 0;
+    for (unsigned int i=0; i<step.outputs.size(); i++) version += GetVersion(step.outputs.at(i));
+    return version;
+}
+
+// the versions of everything the schedule reads and writes, summed
+int PostProcessingEffect::GetScheduleVersion() {
+    int version = 0;
+    for (unsigned int i=0; i<schedule.size(); i++)
+	version += GetInputVersion(schedule[i]) + GetOutputVersion(schedule[i]);
+    return version;
+}
+
+/** Skip the passes whose inputs haven't changed since they were executed last (opt-in, as it costs an extra color and depth
+ *  texture - the user-screen must be kept, so the passes of this PPE can't write to it).
+ *  The inputs of a pass are the color/depth-buffers it is given, its uniform values, and the content of its bound textures
+ *  (the 2D textures - f.e. the userbuffers of other passes and textures updated with SetData. Other textures are assumed static).
+ *  Call SetSceneUnchanged on frames where the scene isn't rendered again - if nothing else has changed either, the whole chain
+ *  is skipped and only the final texture is output to the screen.
+ *  Only needed on the PPE PreRender/PostRender is called on (the chained PPEs are executed by it).
+ *  @note a pass is executed again if its output has been overwritten since, which the ping-pong buffers are when more than two
+ *  passes write to the colorbuffer - so mainly passes writing only to userbuffers, or the whole chain, are skipped.
+ *  @param[in] enable whether to enable result caching
+ */
+void PostProcessingEffect::EnableResultCaching(bool enable) {
+    if (resultCaching == enable) return;
+    resultCaching = enable;
+    InvalidateSchedules();
+    if (!satup || !enable || colorTex3.get() != NULL) return; // (created in SetupFBO)
+
+    colorTex3 = CreateColorTex();
+    depthTex3 = CreateDepthTex();
+    SetSameFilterWrap(colorTex1, colorTex3);
+    SetSameFilterWrap(depthTex1, depthTex3);
+}
+
+/** Tell that the scene won't be rendered this frame (call before PreRender): the user-screen keeps its content from last frame
+ *  (it isn't cleared), so passes reading it can be skipped. Only has an effect with result caching (see EnableResultCaching),
+ *  and not on frames where the viewport is resized.
+ */
+void PostProcessingEffect::SetSceneUnchanged() {
+    sceneUnchanged = true;
+}
+
+/** Set the GPU time per frame for the time-budgeted passes of this PPE (see PostProcessingPass::SetUpdateMode).
+ *  Each frame the least recently updated passes are updated, as long as their GPU time (measured the last time they were
+ *  updated) fits in the budget - but at least one of them is updated each frame. Default is 1 ms.
+ *  @param[in] milliseconds the budget
+ */
+void PostProcessingEffect::SetUpdateBudget(float milliseconds) {
+    updateBudget = milliseconds;
+}
+
+/** @return the number of frames this PPE has been executed on (the index of the next frame - see PerFrame)
+ */
+unsigned int PostProcessingEffect::GetFrameIndex() {
+    return frameIndex;
+}
+
+// choose the time-budgeted passes to update this frame (see SetUpdateBudget)
+void PostProcessingEffect::SelectBudgetedPasses() {
+    float used = 0;
+    bool  any  = false;
+    for (;;) {
+	// the least recently updated of those not chosen yet
+	PostProcessingPass* oldest = NULL;
+	for (unsigned int i=0; i<passes.size(); i++) {
+	    PostProcessingPass* pass = passes.at(i);
+	    if (pass->updateMode != UPDATE_TIME_BUDGET) continue;
+	    if (!any) pass->budgetSelected = false;
+	    if (pass->budgetSelected) continue;
+	    if (oldest == NULL || pass->lastUpdateFrame < oldest->lastUpdateFrame) oldest = pass;
+	}
+	if (oldest == NULL) return;
+
+	float time = 0; // <- (0 if it hasn't been measured yet, or timer queries aren't supported)
+	oldest->timer->GetTime(time);
+	if (any && used + time > updateBudget) return;
+	oldest->budgetSelected = true;
+	used += time;
+	any   = true;
+    }
+}
+
+/* Make all PPEs compile their schedule again before the next frame.
+   Called when anything changes which the schedules depend on: the chains, the passes (and their outputs), enabling, stencil and
+   wrap/filter settings. (all schedules, as a PPE doesn't know which PPEs it is chained to) */
+void PostProcessingEffect::InvalidateSchedules() {
+    currentScheduleGeneration++;
 }
 
 /** Add a pass to this PostProcessingEffect. (The passes will be executed in the order they are added)
@@ -309,22 +936,315 @@ IPostProcessingPass* PostProcessingEffect::AddPass(string fpFileName) {
  *  @return the PostProcessingPass-object corresponding to this pass
  */
 IPostProcessingPass* PostProcessingEffect::AddPass(vector<string> fpFileNames) {
+    return AddPass(fpFileNames, ShaderDefines());
+}
+
+/** Add a pass using a variant of a fragment program, compiled with the given defines injected.
+ *  This makes it possible to specialize a program (e.g. the number of taps of a blur, so the compiler can
+ *  unroll the loop) without duplicating the .frag file. Each variant is only compiled once, and shared by
+ *  all passes using it.
+ *
+ *  @param[in] fpFileName the filename of the file containing the fragmentprogram
+ *  @param[in] defines the defines (name -> value)
+ *  @return the PostProcessingPass-object corresponding to this pass
+ */
+IPostProcessingPass* PostProcessingEffect::AddPass(string fpFileName, ShaderDefines defines) {
+    vector<string> fpFileNames;
+    fpFileNames.push_back(fpFileName);
+    return AddPass(fpFileNames, defines);
+}
+
+/** As above, but with the fragment program spread across several files (the defines are injected into each of them)
+ *
+ *  @param[in] fpFileNames the set of the filenames containing the fragmentprogram
+ *  @param[in] defines the defines (name -> value)
+ *  @return the PostProcessingPass-object corresponding to this pass
+ */
+IPostProcessingPass* PostProcessingEffect::AddPass(vector<string> fpFileNames, ShaderDefines defines) {
     if (!satup) throw PostProcessingException("method AddPass called before setup");
 
     glPushAttrib(GL_ALL_ATTRIB_BITS);
 
     int index = passes.size();
-    PostProcessingPass* pass = new PostProcessingPass(fpFileNames, currScreenWidth, currScreenHeight, index, this);
+    PostProcessingPass* pass = new PostProcessingPass(fpFileNames, defines, bufferWidth, bufferHeight, index, this);
     passes.push_back(pass);
+    InvalidateSchedules();
+
+    for (unsigned int i=0; i<globalUniformBlocks.size(); i++) pass->BindUniformBlock(globalUniformBlocks.at(i));
+    for (unsigned int i=0; i<uniformBlocks.size(); i++)       pass->BindUniformBlock(uniformBlocks.at(i));
 
     glPopAttrib();
     return pass;
 }
 
 
+/** Add a pass convolving the colorbuffer with a symmetric 1D kernel in one direction (so a 2D blur with a separable kernel is a
+ *  horizontal and a vertical pass). The kernel is compiled into the program as constants, instead of being bound with BindFloat,
+ *  and each pair of neighbour taps with weights of the same sign is merged into one tap between them, which the linear filtering
+ *  of the colorbuffer (the default - see SetColorBufferFilter) weighs correctly - so a kernel of radius R takes about R+1 fetches
+ *  instead of 2R+1. If src isn't filtered linearly, the unmerged taps are used instead (checked each time the pass is executed).
+ *  The program is compiled once per kernel and direction, and shared by all passes using it.
+ *  The pass reads the colorbuffer through the sampler "src" (which can be bound to f.e. a userbuffer instead) and outputs
+ *  to the colorbuffer. The taps are clamped to the part of src covered by the screen (see SetResizeBucket and SetRenderScale).
+ *
+ *  @param[in] weights the weight of the center texel, then of the texels 1, 2, ... texels away (on both sides)
+ *  @param[in] direction the direction of the filter
+ *  @return the PostProcessingPass-object corresponding to this pass
+ */
+IPostProcessingPass* PostProcessingEffect::AddSeparableFilterPass(vector<float> weights, FilterDirection direction) {
+    if (weights.empty()) throw PostProcessingException("the kernel must have at least one weight");
+
+    // the taps on each side of the center, unmerged (for a src which isn't filtered linearly)
+    string offsets, tapWeights;
+    int numTaps = 0;
+    for (unsigned int i=1; i<weights.size(); i++) {
+	if (weights.at(i) == 0) continue;
+	if (numTaps > 0) {offsets += ", "; tapWeights += ", ";}
+	offsets    += FormatFloat((float)i);
+	tapWeights += FormatFloat(weights.at(i));
+	numTaps++;
+    }
+
+    // and merged in pairs: texel i and i+1 -> one tap at their weighted mean offset
+    string mergedOffsets, mergedWeights;
+    int numMergedTaps = 0;
+    for (unsigned int i=1; i<weights.size(); i+=2) {
+	float w1 = weights.at(i);
+	float w2 = (i+1 < weights.size()) ? weights.at(i+1) : 0.0f;
+	vector<float> tapOffset, tapWeight;
+	if (w1 * w2 >= 0 && w1 + w2 != 0) {
+	    tapOffset.push_back((i * w1 + (i+1) * w2) / (w1 + w2));
+	    tapWeight.push_back(w1 + w2);
+	} else { // <- (different signs can't be merged - the merged tap wouldn't be between the texels)
+	    tapOffset.push_back((float)i);   tapWeight.push_back(w1);
+	    tapOffset.push_back((float)i+1); tapWeight.push_back(w2);
+	}
+	for (unsigned int j=0; j<tapOffset.size(); j++) {
+	    if (tapWeight.at(j) == 0) continue;
+	    if (numMergedTaps > 0) {mergedOffsets += ", "; mergedWeights += ", ";}
+	    mergedOffsets += FormatFloat(tapOffset.at(j));
+	    mergedWeights += FormatFloat(tapWeight.at(j));
+	    numMergedTaps++;
+	}
+    }
+
+    char numTapsStr[16], numMergedTapsStr[16];
+    sprintf(numTapsStr, "%d", numTaps);
+    sprintf(numMergedTapsStr, "%d", numMergedTaps);
+    ShaderDefines defines;
+    defines["TAPS"]           = numTapsStr;
+    defines["OFFSETS"]        = offsets;
+    defines["WEIGHTS"]        = tapWeights;
+    defines["MERGED_TAPS"]    = numMergedTapsStr;
+    defines["MERGED_OFFSETS"] = mergedOffsets;
+    defines["MERGED_WEIGHTS"] = mergedWeights;
+    defines["CENTER_WEIGHT"]  = FormatFloat(weights.at(0));
+    defines["DIRECTION"]      = (direction == FILTER_HORIZONTAL) ? "vec2(1.0, 0.0)" : "vec2(0.0, 1.0)";
+
+    IPostProcessingPass* pass = AddPass("separable.frag", defines);
+    ((PostProcessingPass*)pass)->separable = true; // <- (binds srcMin, srcMax and srcLinear when executed)
+    pass->BindColorBuffer("src");
+    pass->EnableColorBufferOutput();
+    return pass;
+}
+
+/** Add a pass blurring the colorbuffer with a gaussian kernel in one direction (see AddSeparableFilterPass).
+ *  The kernel is cut off at 3 sigma, and normalized (see SeparableKernel::Gaussian).
+ *  @param[in] sigma the standard deviation in texels
+ *  @param[in] direction the direction of the filter
+ *  @return the PostProcessingPass-object corresponding to this pass
+ */
+IPostProcessingPass* PostProcessingEffect::AddGaussianBlurPass(float sigma, FilterDirection direction) {
+    return AddSeparableFilterPass(SeparableKernel::Gaussian(sigma), direction);
+}
+
+/** Add a pass averaging the 2*radius+1 texels around each texel in one direction (see AddSeparableFilterPass)
+ *  @param[in] radius the radius in texels
+ *  @param[in] direction the direction of the filter
+ *  @return the PostProcessingPass-object corresponding to this pass
+ */
+IPostProcessingPass* PostProcessingEffect::AddBoxBlurPass(int radius, FilterDirection direction) {
+    return AddSeparableFilterPass(SeparableKernel::Box(radius), direction);
+}
+
+/* a float as a GLSL float literal (always with a decimal point, and the same text for the same value - see ShaderPreprocessor::MakeKey) */
+string PostProcessingEffect::FormatFloat(float value) {
+    char str[32];
+    sprintf(str, "%.8g", value);
+    string literal = str;
+    if (literal.find_first_of(".e") == string::npos) literal += ".0";
+    return literal;
+}
+
+/** Reduce the colorbuffer to one value on the GPU - the min, max, average or log-average of each color component and of the
+ *  luminance (f.e. the average luminance of the scene for auto-exposure), without reading the colorbuffer back to the CPU.
+ *  The colorbuffer reduced is the one output by the passes added before this call (so call it before adding any passes to reduce
+ *  the input of the effect). The result is a 1x1 texture, which later passes can bind with BindTexture, and which can be read back
+ *  to the CPU a couple of frames late (see IReduction::GetResultValues - f.e. in PerFrame) without stalling the pipeline.
+ *  With quality tiers (see SetNumQualityTiers), the position counts the passes of the current tier.
+ *
+ *  @param[in] op the reduction
+ *  @param[in] readback whether to read the result back to the CPU
+ *  @return the reduction
+ *  @exception PostProcessingException thrown if called before setup
+ */
+IReduction* PostProcessingEffect::AddReduction(ReductionOp op, const bool readback) {
+    if (!satup) throw PostProcessingException("method AddReduction called before setup");
+    Reduction* reduction = new Reduction(op, passes.size());
+    reduction->EnableReadback(readback);
+    reductions.push_back(reduction);
+    InvalidateSchedules();
+    return reduction;
+}
+
+/** Compute a histogram of the luminance of the colorbuffer on the GPU (f.e. for exposure which ignores the darkest and
+ *  brightest part of the screen, or for grading), without reading the colorbuffer back to the CPU.
+ *  As with AddReduction, the colorbuffer counted is the one output by the passes added before this call, and the result is a
+ *  texture (numBins x 1, the fraction of the texels in each bin) which later passes can bind, and which can be read back to
+ *  the CPU a couple of frames late (see IHistogram::GetResultValues).
+ *
+ *  @param[in] numBins the number of bins
+ *  @param[in] minLog2 log2 of the lowest luminance of the bins (see IHistogram::SetRange)
+ *  @param[in] maxLog2 log2 of the highest luminance of the bins
+ *  @param[in] readback whether to read the result back to the CPU
+ *  @return the histogram
+ *  @exception PostProcessingException thrown if called before setup
+ */
+IHistogram* PostProcessingEffect::AddHistogram(int numBins, float minLog2, float maxLog2, const bool readback) {
+    if (!satup) throw PostProcessingException("method AddHistogram called before setup");
+    Histogram* histogram = new Histogram(numBins, minLog2, maxLog2, passes.size());
+    histogram->EnableReadback(readback);
+    histograms.push_back(histogram);
+    InvalidateSchedules();
+    return histogram;
+}
+
+/** Declare that the effect has several quality tiers - alternative sets of passes, f.e. a blur with fewer taps, or without
+ *  the bloom pass. The passes of each tier are added in SetupTier (instead of Setup, which then only does what is common
+ *  to all tiers), which is called the first time the tier is used. Afterwards, switching to the tier again (see SetQualityTier)
+ *  only switches the passes executed - their programs and userbuffers are kept.
+ *  The passes of a tier may only refer to the passes of the same tier (f.e. with AttachUserBuffer).
+ *  @param[in] numTiers the number of tiers (tier 0 is the best quality, the last tier the cheapest)
+ *  @exception PostProcessingException thrown if called after setup
+ */
+void PostProcessingEffect::SetNumQualityTiers(int numTiers) {
+    if (satup) throw PostProcessingException("method SetNumQualityTiers called after setup");
+    if (numTiers < 1) throw PostProcessingException("an effect must have at least one quality tier");
+    this->numTiers = numTiers;
+    tierPasses.resize(numTiers);
+    tierBuilt.resize(numTiers, false);
+    tierCost.resize(numTiers, -1.0f);
+    tierCostFrame.resize(numTiers, 0);
+    if (currentTier >= numTiers) currentTier = 0;
+}
+
+/** Switch to a quality tier (see SetNumQualityTiers). The tier is built (SetupTier is called) if it hasn't been used before,
+ *  and setup has been done - so the first switch to a tier may compile shaders (see PrebuildQualityTiers).
+ *  @param[in] tier the tier (0 = the best quality)
+ *  @exception PostProcessingException thrown if the effect doesn't have the tier
+ */
+void PostProcessingEffect::SetQualityTier(int tier) {
+    if (tier < 0 || tier >= numTiers) throw PostProcessingException("the effect doesn't have the given quality tier");
+    if (tier == currentTier) return;
+    tierPasses.at(currentTier) = passes;
+    passes = tierPasses.at(tier);
+    tierPasses.at(tier).clear();
+    currentTier = tier;
+    if (satup && !tierBuilt.at(tier)) BuildTier(tier);
+    InvalidateSchedules();
+}
+
+int PostProcessingEffect::GetQualityTier() {
+    return currentTier;
+}
+
+int PostProcessingEffect::GetNumQualityTiers() {
+    return numTiers;
+}
+
+/** Build all quality tiers now, instead of the first time they are used - so switching tier never stalls on compiling.
+ *  (the shader compiles of all tiers are submitted before any of them is waited for, like the passes added in Setup)
+ */
+void PostProcessingEffect::PrebuildQualityTiers() {
+    CallSetup();
+    if (numTiers == 0) return;
+    int tier = currentTier;
+    for (int i=0; i<numTiers; i++)
+	if (!tierBuilt.at(i)) SetQualityTier(i);
+    SetQualityTier(tier);
+}
+
+// add the passes of the current tier (which must be tier)
+void PostProcessingEffect::BuildTier(int tier) {
+    tierBuilt.at(tier) = true;
+    SetupTier(tier);
+    for (unsigned int i=0; i<passes.size(); i++)
+	passes.at(i)->fp->Resolve(false);
+}
+
+/** Pick the quality tier (see SetNumQualityTiers) each frame from the GPU time of the passes of this effect (the chained effects
+ *  have their own tiers and budgets). When the passes exceed the budget, the next cheaper tier is used. A better tier is tried
+ *  again when it was measured below the budget, or - as the scene changes - when it hasn't been measured for a while and the
+ *  current tier takes less than half the budget.
+ *  All the tiers are built when the governor is enabled (or at setup, if it is enabled before), as building a tier in the middle
+ *  of a frame would stall it on compiling the shaders - and the stall would be measured as the cost of the tier.
+ *  @param[in] budgetMilliseconds the GPU time budget per frame for the passes of this effect
+ *  @note GL_EXT_timer_query only - without it the tier isn't changed
+ *  @note must not be called between PreRender and PostRender
+ */
+void PostProcessingEffect::EnableQualityGovernor(float budgetMilliseconds) {
+    qualityGovernor = true;
+    qualityBudget   = budgetMilliseconds;
+    framesSinceTierChange = 0;
+    if (satup) PrebuildQualityTiers(); // (otherwise done in CallSetup)
+    if (!GpuTimer::IsSupported()) logger.warning << "GL_EXT_timer_query not supported - the quality governor is disabled" << logger.end;
+}
+
+/** Stop switching the quality tier (the current tier is kept)
+ */
+void PostProcessingEffect::DisableQualityGovernor() {
+    qualityGovernor = false;
+}
+
+/* switch to a cheaper or better quality tier from the GPU time of the current one (see EnableQualityGovernor) */
+void PostProcessingEffect::UpdateQualityTier() {
+    if (!qualityGovernor || numTiers < 2 || !GpuTimer::IsSupported()) return;
+
+    // the GPU time of the passes of the current tier (those not executed yet aren't counted)
+    float cost = 0;
+    for (unsigned int i=0; i<passes.size(); i++) {
+	PostProcessingPass* pass = passes.at(i);
+	pass->EnableTiming();
+	float time = 0;
+	if (pass->timer->GetTime(time)) cost += time;
+    }
+
+    // wait until the measurements are of the current tier (they lag a few frames behind, and its shaders may still be compiling)
+    if (++framesSinceTierChange < 8) return;
+    tierCost.at(currentTier)      = cost;
+    tierCostFrame.at(currentTier) = frameIndex;
+
+    int tier = currentTier;
+    if (cost > qualityBudget) {
+	if (currentTier < numTiers - 1) tier = currentTier + 1;
+    } else if (currentTier > 0) {
+	const unsigned int maxAge = 600; // <- (frames until the measurement of a better tier is considered out of date)
+	float better = tierCost.at(currentTier - 1);
+	bool outdated = better < 0 || frameIndex - tierCostFrame.at(currentTier - 1) > maxAge;
+	if (( outdated && cost   < 0.5f * qualityBudget) ||
+	    (!outdated && better < 0.8f * qualityBudget)) tier = currentTier - 1;
+    }
+    if (tier == currentTier) return;
+
+    SetQualityTier(tier);
+    framesSinceTierChange = 0;
+}
+
 /** Resizes the FBO virtual screens.
  *  When the viewport is resize, this method is called, as all FBO virtual screens must be resized as well, to match
  *  the current size of the viewport.
+ *  With a resize bucket (see SetResizeBucket), they are only reallocated if the viewport no longer fits in them (or only
+ *  fills a small part of them) - otherwise the screen is just rendered into a smaller part of them.
  *
  *  @param[in] currScreenWidth the new width of the screen
  *  @param[in] currScreenHeight the new height of the screen
@@ -332,32 +1252,184 @@ IPostProcessingPass* PostProcessingEffect::AddPass(vector<string> fpFileNames) {
 void PostProcessingEffect::Resize(int currScreenWidth, int currScreenHeight) {
     if (!satup) throw PostProcessingException("method Resize called before setup");
 
-    glPushAttrib(GL_ALL_ATTRIB_BITS);
-
     this->currScreenWidth  = currScreenWidth;
     this->currScreenHeight = currScreenHeight;
+    UpdateRenderSize();
 
-    // resize vores color/depth textures and stencil renderbuffer.
-    depthTex1->Resize(currScreenWidth, currScreenHeight);
-    depthTex2->Resize(currScreenWidth, currScreenHeight);
-    colorTex1->Resize(currScreenWidth, currScreenHeight);
-    colorTex2->Resize(currScreenWidth, currScreenHeight);
-    //stencilTex->Resize(currScreenWidth, currScreenHeight);
+    int newBufferWidth  = GetBufferSize(currScreenWidth,  bufferWidth);
+    int newBufferHeight = GetBufferSize(currScreenHeight, bufferHeight);
+    if (newBufferWidth == bufferWidth && newBufferHeight == bufferHeight) return; // <- the screen still fits
+    bufferWidth  = newBufferWidth;
+    bufferHeight = newBufferHeight;
+
+    glPushAttrib(GL_ALL_ATTRIB_BITS);
+
+    // resize vores color/depth textures and stencil texture.
+    // (attached again, as a texture with immutable storage gets a new texture-handle when resized)
+    depthTex1->Resize(bufferWidth, bufferHeight);
+    depthTex2->Resize(bufferWidth, bufferHeight);
+    colorTex1->Resize(bufferWidth, bufferHeight);
+    colorTex2->Resize(bufferWidth, bufferHeight);
+    if (colorTex3.get() != NULL) {
+	colorTex3->Resize(bufferWidth, bufferHeight);
+	depthTex3->Resize(bufferWidth, bufferHeight);
+    }
+    fbo->AttachColorTexture(colorTex1, 0);
+    if (stencilEnabled) fbo->AttachDepthStencilTexture(depthTex1);
+    else                fbo->AttachDepthTexture(depthTex1);
+    if (stencilTex.get() != NULL) {
+	stencilTex->Resize(bufferWidth, bufferHeight);
+	stencilFbo->AttachDepthStencilTexture(stencilTex);
+    }
+    if (msaaFbo != NULL) SetupMultisampling(); // (recreated, as the multisampled depth texture can't be resized)
 
     // resize alle userbuffers
     for (unsigned int i=0; i<passes.size(); i++) {
 	PostProcessingPass* pass = passes.at(i);
-	pass->Resize(currScreenWidth, currScreenHeight);
+	pass->Resize(bufferWidth, bufferHeight);
     }
+    for (unsigned int t=0; t<tierPasses.size(); t++)
+	for (unsigned int i=0; i<tierPasses.at(t).size(); i++)
+	    tierPasses.at(t).at(i)->Resize(bufferWidth, bufferHeight);
 
     glPopAttrib();
 }
 
-// swap values of a and b (just to make some code a bit prettier)
-void PostProcessingEffect::Swap(ITexture2DPtr* a, ITexture2DPtr* b) {
-    ITexture2DPtr tmp = *a;
-    *a = *b;
-    *b = tmp;
+/* the size of the buffers for the given screen size (width or height): the current size, if the screen fits and fills
+   more than half of it - otherwise the screen size rounded up to a multiple of the resize bucket.
+   (so the buffers grow in steps of the bucket, and are only shrunk when they have become much too large) */
+int PostProcessingEffect::GetBufferSize(int screenSize, int bufferSize) {
+    if (resizeBucket <= 0) return screenSize;
+    if (screenSize <= bufferSize && screenSize > bufferSize / 2) return bufferSize;
+    return ((screenSize + resizeBucket - 1) / resizeBucket) * resizeBucket;
+}
+
+/** Over-allocate the buffers (the color/depth-buffers and the userbuffers) to multiples of bucketSize pixels.
+ *  When the viewport is resized (f.e. while the window is dragged), the buffers are then only reallocated when the viewport
+ *  outgrows them - otherwise the screen is rendered into the lower left part of them, and the passes get texture coordinates
+ *  scaled to that part. So gl_TexCoord[0] still covers the screen, but:
+ *   - a fragment program computing texture coordinates itself (f.e. from gl_FragCoord) must scale them with GetTexCoordScale,
+ *     and one texel is 1/bufferwidth (not 1/screenwidth) in texture coordinates.
+ *   - filters sampling outside the screen (f.e. a blur at the edge) read undefined texels instead of clamped ones.
+ *   - the textures returned by GetFinalColorBuffer, GetUserBuffer, etc. may be larger than the screen.
+ *  Chained effects get the resize bucket of the effect they are chained to.
+ *  @param[in] bucketSize the granularity of the buffer sizes in pixels (f.e. 128) - 0 gives buffers of the exact size of the viewport (default)
+ */
+void PostProcessingEffect::SetResizeBucket(int bucketSize) {
+    if (bucketSize < 0) bucketSize = 0;
+    if (bucketSize == resizeBucket) return;
+    resizeBucket = bucketSize;
+    for (unsigned int i=0; i<allChainedEffects.size(); i++) allChainedEffects.at(i)->SetResizeBucket(bucketSize);
+    if (!satup) return; // (done in SetupFBO)
+
+    // compute the buffer sizes again from scratch
+    bufferWidth  = 0;
+    bufferHeight = 0;
+    Resize(currScreenWidth, currScreenHeight);
+}
+
+/** Get the part of the buffers covered by the screen, in texture coordinates (1,1 if no resize bucket or render scale is set)
+ *  @param[out] scaleS the render width of the screen / the width of the buffers
+ *  @param[out] scaleT the render height of the screen / the height of the buffers
+ */
+void PostProcessingEffect::GetTexCoordScale(float& scaleS, float& scaleT) {
+    if (!satup) {scaleS = renderScale; scaleT = renderScale; return;}
+    scaleS = renderWidth  / (float)bufferWidth;
+    scaleT = renderHeight / (float)bufferHeight;
+}
+
+/** Render the scene and the passes at a fraction of the size of the viewport - the final output is upscaled to the viewport.
+ *  The buffers aren't reallocated: the screen is rendered to the lower left part of them, as with a resize bucket (see
+ *  SetResizeBucket - the same notes apply). The scene must be rendered with the viewport set to GetRenderSize, which PreRender
+ *  does (a renderer setting the viewport itself after PreRender must use GetRenderSize too).
+ *  Chained effects get the render scale of the effect they are chained to.
+ *  @param[in] scale the fraction of the viewport width and height (clamped to ]0;1])
+ */
+void PostProcessingEffect::SetRenderScale(float scale) {
+    if (scale > 1.0f) scale = 1.0f;
+    if (scale < 0.01f) scale = 0.01f;
+    if (scale == renderScale) return;
+    renderScale = scale;
+    UpdateRenderSize();
+    for (unsigned int i=0; i<allChainedEffects.size(); i++) allChainedEffects.at(i)->SetRenderScale(scale);
+}
+
+float PostProcessingEffect::GetRenderScale() {
+    return renderScale;
+}
+
+/** Get the size the scene and the passes are rendered at (the viewport size times the render scale)
+ */
+void PostProcessingEffect::GetRenderSize(int& width, int& height) {
+    width  = renderWidth;
+    height = renderHeight;
+}
+
+/** Adjust the render scale (see SetRenderScale) each frame, so the GPU time of rendering the scene and executing the passes
+ *  stays within the budget. The times are measured with timer queries, which are read a few frames later, so the scale is only
+ *  changed when the times of the current scale are known. It is lowered when the budget is exceeded, and raised again - in small
+ *  steps - when the time is well below it (between the two it is kept, so it doesn't flicker between two sizes).
+ *  @param[in] budgetMilliseconds the GPU time budget per frame (f.e. 16.6 for 60 fps - minus the time of what is rendered after the effect)
+ *  @param[in] minScale the lowest render scale allowed
+ *  @param[in] maxScale the highest render scale allowed
+ *  @note GL_EXT_timer_query only - without it the render scale isn't changed
+ */
+void PostProcessingEffect::EnableDynamicResolution(float budgetMilliseconds, float minScale, float maxScale) {
+    if (minScale <= 0 || minScale > maxScale || maxScale > 1.0f) throw PostProcessingException("illegal render scale bounds (must be 0 < minScale <= maxScale <= 1)");
+    dynamicResolution = true;
+    frameBudget       = budgetMilliseconds;
+    minRenderScale    = minScale;
+    maxRenderScale    = maxScale;
+    if (!GpuTimer::IsSupported()) logger.warning << "GL_EXT_timer_query not supported - dynamic resolution disabled" << logger.end;
+}
+
+/** Stop adjusting the render scale (it keeps its current value - see SetRenderScale)
+ */
+void PostProcessingEffect::DisableDynamicResolution() {
+    dynamicResolution = false;
+}
+
+// the render size from the screen size and the render scale
+void PostProcessingEffect::UpdateRenderSize() {
+    renderWidth  = (int)(currScreenWidth  * renderScale + 0.5f);
+    renderHeight = (int)(currScreenHeight * renderScale + 0.5f);
+    if (renderWidth  < 1) renderWidth  = 1;
+    if (renderHeight < 1) renderHeight = 1;
+}
+
+/* adjust the render scale to the GPU time of the last measured frame (see EnableDynamicResolution) */
+void PostProcessingEffect::UpdateDynamicResolution() {
+    if (!dynamicResolution || !GpuTimer::IsSupported()) return;
+    if (sceneTimer == NULL) sceneTimer = new GpuTimer();
+
+    // the GPU time of the scene and of all passes (incl. the chained PPEs)
+    float total = 0;
+    if (!sceneTimer->GetTime(total)) return;
+    for (unsigned int i=0; i<=allChainedEffects.size(); i++) {
+	PostProcessingEffect* ppe = (i == 0) ? this : allChainedEffects.at(i-1);
+	for (unsigned int j=0; j<ppe->passes.size(); j++) {
+	    PostProcessingPass* pass = ppe->passes.at(j);
+	    pass->EnableTiming();
+	    float time = 0;
+	    if (pass->timer->GetTime(time)) total += time;
+	}
+    }
+
+    // wait until the measurements are of the current scale (they lag a few frames behind)
+    if (++framesSinceScaleChange < 4) return;
+
+    // the time is roughly proportional to the number of pixels (the scale squared), so aim for 90% of the budget
+    // - lowered right away if over budget, raised by at most 10% if below 75% of it (and kept in between)
+    float scale = renderScale;
+    float target = sqrt(0.9f * frameBudget / total);
+    if      (total > frameBudget)         scale = renderScale * target;
+    else if (total < 0.75f * frameBudget) scale = renderScale * ((target < 1.1f) ? target : 1.1f);
+    if (scale < minRenderScale) scale = minRenderScale;
+    if (scale > maxRenderScale) scale = maxRenderScale;
+    if (fabs(scale - renderScale) < 0.01f) return; // <- (not worth changing)
+
+    SetRenderScale(scale);
+    framesSinceScaleChange = 0;
 }
 
 /** Returns a COPY of the final color buffer texture (user supplies output-texture id).
@@ -418,7 +1490,8 @@ ITexture2DPtr PostProcessingEffect::GetFinalDepthBuffer() {
  *  Consider using GetFinalColorBuffer instead (a bit slower due to the texture copying).
  *
  *  Warnings:
- *   - The content of the texture will change each frame (because the pass writes to it each frame)!! (so you can't save prev frames)
+ *   - The content of the texture will change each frame (because the pass writes to it each frame)!! (so you can't save prev frames
+ *     this way - bind them with PostProcessingPass::BindHistoryBuffer instead)
  *   - Don't modify it
  *   - (You should call it each frame you need it as it's not guaranteed that it's the same texture every time)
  *
@@ -436,7 +1509,8 @@ ITexture2DPtr PostProcessingEffect::GetFinalColorBufferRef() {
  *  Consider using GetFinalDepthBuffer instead (a bit slower due to the texture copying).
  *
  *  Warnings:
- *   - The content of the texture will change each frame (because the pass writes to it each frame)!! (so you can't save prev frames)
+ *   - The content of the texture will change each frame (because the pass writes to it each frame)!! (so you can't save prev frames
+ *     this way - bind them with PostProcessingPass::BindHistoryBuffer instead)
  *   - Don't modify it
  *   - (You should call it each frame you need it as it's not guaranteed that it's the same texture every time)
  *
@@ -482,7 +1556,9 @@ int PostProcessingEffect::GetMaxTextureBindings() {
  *  @param[in] enable wether to enable or disable this PostProcessingEffect
  */
 void PostProcessingEffect::Enable(bool enable) {
+    if (enable == enabled) return;
     this->enabled = enable;
+    InvalidateSchedules();
 }
 
 /** Return wether this effect is enabled
@@ -492,6 +1568,30 @@ bool PostProcessingEffect::IsEnabled() {
     return enabled;
 }
 
+/** Use a uniform block in all passes of this effect (passes already added as well as passes added later).
+ *  Values which are the same for all passes (screen size, time, ...) are then only uploaded once per change,
+ *  instead of once per pass.
+ *
+ *  @param[in] block the uniform block (the fragment programs must declare it, see UniformBlock)
+ */
+void PostProcessingEffect::AddUniformBlock(IUniformBlockPtr block) {
+    uniformBlocks.push_back(block);
+    for (unsigned int i=0; i<passes.size(); i++)
+	passes.at(i)->BindUniformBlock(block);
+    for (unsigned int t=0; t<tierPasses.size(); t++)
+	for (unsigned int i=0; i<tierPasses.at(t).size(); i++)
+	    tierPasses.at(t).at(i)->BindUniformBlock(block);
+}
+
+/** Use a uniform block in all passes of all effects (e.g. for the camera near/far planes).
+ *  Only passes added after this call will use the block, so call it before the effects are set up.
+ *
+ *  @param[in] block the uniform block
+ */
+void PostProcessingEffect::AddGlobalUniformBlock(IUniformBlockPtr block) {
+    globalUniformBlocks.push_back(block);
+}
+
 /** Add a PostProcessingEffect to be executed after this PostProcessingEffect.
  *  (The added PostProcessingEffects will be executed after this PostProcessingEffect and in the order they are added)
  *
@@ -502,15 +1602,19 @@ bool PostProcessingEffect::IsEnabled() {
  *
  *  If any of the effects you add, also have added effects, they will also be executed. This means that you can setup your effects in a
  *  tree structure.
- *  Note: you shouldn't add a effect to itself or to one of its children. This would correspond to an infinite loop in the tree.
- *        If you do so, the preRender or resize method will cast an exception the next time it is called.
+ *  Note: you can't add a effect to itself or to one of its children. This would correspond to an infinite loop in the tree.
  *
  *  (note: at the time of writing, having several effects will take more vram (because of the textures) than having just one big effect)
  *
  *  @param[in] ppe the effect to be added to this one
+ *  @exception PostProcessingException thrown if ppe is this effect, or this effect is chained to ppe (directly or indirectly)
  */
 void PostProcessingEffect::Add(IPostProcessingEffect* ppe) {
-    chainedEffects.push_back((PostProcessingEffect*)ppe);
+    PostProcessingEffect* effect = (PostProcessingEffect*)ppe;
+    if (effect->IsChained(this)) throw PostProcessingException("chain inf-loop: the effect is this effect, or this effect is chained to it");
+    chainedEffects.push_back(effect);
+    currentChainGeneration++;
+    InvalidateSchedules();
 }
 
 /** Remove all occurances of the given PostProcessingEffect from this PostProcessingEffect
@@ -523,12 +1627,42 @@ void PostProcessingEffect::Remove(IPostProcessingEffect* ppe) {
 	if (ppe == ppe2) it = chainedEffects.erase(it);
 	else             it++;
     }
+    currentChainGeneration++;
+    InvalidateSchedules();
 }
 
 /** Remove all added PostProcessingEffects from this PostProcessingEffect
  */
 void PostProcessingEffect::RemoveAll() {
     chainedEffects.clear();
+    currentChainGeneration++;
+    InvalidateSchedules();
+}
+
+/* whether ppe is this PPE or chained to it (directly or indirectly) */
+bool PostProcessingEffect::IsChained(PostProcessingEffect* ppe) {
+    if (ppe == this) return true;
+    for (unsigned int i=0; i<chainedEffects.size(); i++)
+	if (chainedEffects.at(i)->IsChained(ppe)) return true;
+    return false;
+}
+
+/* add the PPEs chained to ppe (directly or indirectly) to allChainedEffects (and ownViewportEffects), each only once */
+void PostProcessingEffect::CollectChainedEffects(PostProcessingEffect* ppe) {
+    for (unsigned int i=0; i<ppe->chainedEffects.size(); i++) {
+	PostProcessingEffect* chained = ppe->chainedEffects.at(i);
+	if (find(allChainedEffects.begin(), allChainedEffects.end(), chained) != allChainedEffects.end()) continue;
+	allChainedEffects.push_back(chained);
+	if (chained->viewport != viewport) ownViewportEffects.push_back(chained);
+	CollectChainedEffects(chained);
+    }
+}
+
+/* resize the buffers if the viewport has been resized - returns whether it had */
+bool PostProcessingEffect::CheckResize() {
+    if (viewport->GetDimension()[2] == currScreenWidth && viewport->GetDimension()[3] == currScreenHeight) return false;
+    Resize(viewport->GetDimension()[2], viewport->GetDimension()[3]);
+    return true;
 }
 
 /**
@@ -573,6 +1707,14 @@ void PostProcessingEffect::CallSetup() {
     CHECK_FOR_GL_ERROR();
 	Setup();
     CHECK_FOR_GL_ERROR();
+	if (numTiers > 0) BuildTier(currentTier);
+	if (qualityGovernor) PrebuildQualityTiers(); // <- (so the governor never builds a tier in the middle of a frame)
+    CHECK_FOR_GL_ERROR();
+
+	// AddPass only submits the shader compiles, so they run in parallel (if the driver supports it).
+	// Pick up the ones that are already done - the rest are waited for when their pass is first executed.
+	for (unsigned int i=0; i<passes.size(); i++)
+	    passes.at(i)->fp->Resolve(false);
     }
 }
 
@@ -589,6 +1731,8 @@ void PostProcessingEffect::SetColorBufferWrap(TextureWrap wrapS, TextureWrap wra
     colorTex1->SetWrapT(wrapT);
     colorTex2->SetWrapS(wrapS);
     colorTex2->SetWrapT(wrapT);
+    if (colorTex3.get() != NULL) SetSameFilterWrap(colorTex1, colorTex3);
+    InvalidateSchedules(); // <- (the settings are given to the input textures of chained effects when compiling)
 }
 
 /** Set wrap setting for the depth-buffer of this effect
@@ -603,6 +1747,8 @@ void PostProcessingEffect::SetDepthBufferWrap(TextureWrap wrapS, TextureWrap wra
     depthTex1->SetWrapT(wrapT);
     depthTex2->SetWrapS(wrapS);
     depthTex2->SetWrapT(wrapT);
+    if (depthTex3.get() != NULL) SetSameFilterWrap(depthTex1, depthTex3);
+    InvalidateSchedules();
 }
 
 /** Set filter setting for the color-buffer of this effect
@@ -617,6 +1763,8 @@ void PostProcessingEffect::SetColorBufferFilter(TextureFilter filter) {
     colorTex1->SetMinFilter(filter);
     colorTex2->SetMagFilter(filter);
     colorTex2->SetMinFilter(filter);
+    if (colorTex3.get() != NULL) SetSameFilterWrap(colorTex1, colorTex3);
+    InvalidateSchedules();
 }
 
 /** Set filter setting for the color-buffer of this effect
@@ -631,6 +1779,8 @@ void PostProcessingEffect::SetDepthBufferFilter(TextureFilter filter) {
     depthTex1->SetMinFilter(filter);
     depthTex2->SetMagFilter(filter);
     depthTex2->SetMinFilter(filter);
+    if (depthTex3.get() != NULL) SetSameFilterWrap(depthTex1, depthTex3);
+    InvalidateSchedules();
 }
 
 /* used by "bugfix since hand-in": make sure dst has same filter/wrap settings as src */
@@ -645,11 +1795,16 @@ void PostProcessingEffect::SetSameFilterWrap(ITexture2DPtr src, ITexture2DPtr ds
 bool PostProcessingEffect::IsSatup() {
     return satup;
 }
+*/
 
+/** Run setup now instead of on the first frame.
+ *  Setup submits the compiles of all fragment programs without waiting for them, so calling this before
+ *  loading the rest of the assets lets the driver compile the shaders while the assets load.
+ *  (OpenGL must be initialized when this is called)
+ */
 void PostProcessingEffect::ForceSetup() {
     CallSetup();
 }
-*/
 
 /** Get viewport
  */
@@ -661,10 +1816,28 @@ Viewport* PostProcessingEffect::GetViewport() {
 // only call PerFrame AFTER drawing a frame and ONLY on the frames this PostProcessingEffect actually were used on the frame
     void PostProcessingEffect::Handle(ProcessEventArg arg) {
     float deltaTime = arg.approx / 1000.0f;
-    if (callPerFrame) PerFrame(deltaTime);
+    if (callPerFrame) {
+	frameIndex++;
+	PerFrame(deltaTime, frameIndex);
+    }
     callPerFrame = false;
 }
 
+/** Add the passes of a quality tier (see SetNumQualityTiers). Called - after Setup - the first time the tier is used.
+ *  @param[in] tier the tier (0 = the best quality)
+ */
+void PostProcessingEffect::SetupTier(const int /*tier*/) {
+}
+
+/** Called after each frame this PPE was executed on, like PerFrame(deltaTime) - which it calls, unless it is overridden.
+ *  Override it to get the frame index, f.e. to bind the phase of the amortized passes (see PostProcessingPass::GetUpdatePhase).
+ *  @param[in] deltaTime the time since last frame
+ *  @param[in] frameIndex the index of the next frame (the one the parameters bound now are used on)
+ */
+void PostProcessingEffect::PerFrame(const float deltaTime, const unsigned int /*frameIndex*/) {
+    PerFrame(deltaTime);
+}
+
 
 
 } // NS PostProcessing
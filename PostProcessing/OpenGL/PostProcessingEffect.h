@@ -7,6 +7,8 @@
 #include <PostProcessing/IPostProcessingEffect.h>
 #include <PostProcessing/PostProcessingException.h>
 #include <PostProcessing/OpenGL/PostProcessingPass.h>
+#include <PostProcessing/OpenGL/Reduction.h>
+#include <PostProcessing/OpenGL/Histogram.h>
 #include <Resources/OpenGL/FragmentProgram.h>
 #include <Resources/OpenGL/FramebufferObject.h>
 #include <Resources/OpenGL/Texture2D.h>
@@ -45,20 +47,71 @@ class PostProcessingEffect : public IListener<ProcessEventArg>
     // the fragment program for each pass (index 0 is the first pass, etc) (vektoren gemmer pointers for at undg kopiering hele tiden)
     vector<PostProcessingPass*> passes;
 
-    // the added PPEs of this PPE
+    // the reductions and histograms of this PPE (see AddReduction, AddHistogram) - each is executed after the passes added before it
+    vector<Reduction*> reductions;
+    vector<Histogram*> histograms;
+
+    // quality tiers (see SetNumQualityTiers): the passes of each tier, built the first time the tier is used
+    int numTiers;    // 0 = no tiers
+    int currentTier;
+    vector<vector<PostProcessingPass*> > tierPasses; // <- (except the current tier - its passes are in passes)
+    vector<bool> tierBuilt;
+    void BuildTier(int tier);
+
+    // the quality governor: the tier is picked from the GPU time of its passes (see EnableQualityGovernor)
+    bool  qualityGovernor;
+    float qualityBudget;                // milliseconds
+    vector<float>        tierCost;      // the GPU time of each tier when it was used last (-1 = not measured)
+    vector<unsigned int> tierCostFrame; // the frame index it was measured on
+    int framesSinceTierChange;
+    void UpdateQualityTier();
+
+    // uniform blocks used by all passes of this PPE (and of all PPEs)
+    vector<IUniformBlockPtr> uniformBlocks;
+    static vector<IUniformBlockPtr> globalUniformBlocks;
+
+    // the added PPEs of this PPE (they can't form loops - en effect m ikke vre dens eget barn - which Add checks)
     vector<PostProcessingEffect*> chainedEffects;
-    int infLoopDetectionBit; // (pas p med uendelige loops - en effect m ikke vre dens eget barn)
+    bool IsChained(PostProcessingEffect* ppe);
 
-    // width, height of the screen and thus of our textures/renderbuffers
+    // all PPEs chained to this one (directly or indirectly) - only collected again when a chain has changed
+    vector<PostProcessingEffect*> allChainedEffects;
+    vector<PostProcessingEffect*> ownViewportEffects; // <- those of them with another viewport than this one
+    int chainGeneration; // the value of currentChainGeneration when they were collected
+    static int currentChainGeneration;
+    void CollectChainedEffects(PostProcessingEffect* ppe);
+
+    // width, height of the screen
     int currScreenWidth;
     int currScreenHeight;
     Viewport* viewport;
 
+    // width, height of our textures/renderbuffers - the screen is rendered into the lower left corner of them (see SetResizeBucket)
+    int bufferWidth;
+    int bufferHeight;
+    int resizeBucket; // 0 = the buffers have the size of the screen
+    int GetBufferSize(int screenSize, int bufferSize);
+
+    // the size the scene and the passes are rendered at: the screen size times the render scale (see SetRenderScale)
+    float renderScale;
+    int   renderWidth;
+    int   renderHeight;
+    void  UpdateRenderSize();
+
+    // dynamic resolution: the render scale is adjusted so the GPU time of the scene and the passes stays within the budget
+    bool      dynamicResolution;
+    float     frameBudget;       // milliseconds
+    float     minRenderScale;
+    float     maxRenderScale;
+    GpuTimer* sceneTimer;        // the GPU time of rendering the scene (from PreRender to PostRender)
+    int       framesSinceScaleChange;
+    void UpdateDynamicResolution();
+
     // whether to output to the screen or not (if you just want to render to texture)
     bool screenOutput;
 
-    // whether the colorbuffer texture-attachments should be float-textures or not (userbuffer textures are specified individually)
-    bool useFloatTextures;
+    // the format of the colorbuffer texture-attachments (userbuffer textures are specified individually)
+    TexelFormat colorBufferFormat;
 
     // whether this effect is completely disabled or not
     bool enabled;
@@ -69,8 +122,19 @@ class PostProcessingEffect : public IListener<ProcessEventArg>
     // ensures PerFrame is only called _after_ the effect has been executed, and only on frames it has been executed
     bool callPerFrame;
 
-    // wether to keep stencil buffer attached when passes are executed
-    //bool keepStencil;
+    // the number of frames the effect has been executed on (the phase of the amortized passes - see PostProcessingPass::SetUpdateMode)
+    unsigned int frameIndex;
+
+    // the GPU time per frame for the time-budgeted passes of this PPE (see SetUpdateBudget)
+    float updateBudget;
+    void SelectBudgetedPasses();
+
+    // whether the user-screen has a stencil buffer (see EnableStencilBuffer)
+    bool stencilEnabled;
+
+    // whether passes with unchanged inputs are skipped (see EnableResultCaching), and whether the scene is unchanged this frame
+    bool resultCaching;
+    bool sceneUnchanged;
 
     // Handles for FBO, FBO-Textures, Renderbuffers
     FramebufferObject* fbo; // <- fbo for "render user-screen" (the FBOs for the passes are in the PPEPass objects)
@@ -78,33 +142,91 @@ class PostProcessingEffect : public IListener<ProcessEventArg>
     ITexture2DPtr      colorTex2;
     ITexture2DPtr      depthTex1;
     ITexture2DPtr      depthTex2;
-    //ITexture2DPtr      stencilTex;
+    ITexture2DPtr      colorTex3;      // <- only with result caching: the passes ping-pong between 2 and 3, so the user-screen is kept
+    ITexture2DPtr      depthTex3;
+    ITexture2DPtr      stencilTex;     // <- copy of the stencil of the user-screen, for stencil-masked passes (only attached, never sampled)
+    FramebufferObject* stencilFbo;     // <- stencilTex attached (blit destination)
+    FramebufferObject* stencilReadFbo; // <- the depth-stencil texture to copy from attached (blit source)
+
+    void SetupStencil();
+    void CopyStencil(ITexture2DPtr depthStencilTex);
+    bool HasStencilMaskedPasses();
+
+    // multisampled user-screen (see SetMultisampling) - it is rendered to instead of fbo, and resolved into colorTex1/depthTex1 in PostRender
+    int                msaaSamples; // 0 = no multisampling
+    DepthResolve       depthResolve;
+    FramebufferObject* msaaFbo;     // NULL if not multisampling
+    IRenderBufferPtr   msaaColorRB;
+    IRenderBufferPtr   msaaDepthRB;    // (sample-0 resolve: blitted)
+    GLuint             msaaDepthTexID; // (min/max resolve: a multisampled depth texture, as the resolve program must read all the samples)
+    LinkedProgramPtr   depthResolveProgram;
+
+    void SetupMultisampling();
+    void DeleteMultisampling();
+    void ResolveMultisampling();
+    static bool HasMultisampleTextures();
+    static PixelFormat GetRenderBufferFormat(TexelFormat format);
 
     // used for restoring the fbo after postRender which was bound before preRender
     GLint savedFboID;
 
+    void ConstructorSetup(Viewport* viewport, TexelFormat colorBufferFormat); // <- (shared by the constructors)
     void SetupFBO();  // create FBO, FBO-textures, renderbuffers
 
-    void Swap(ITexture2DPtr* a, ITexture2DPtr* b); // swap values of a and b (just to make some code a bit prettier)
-
     ITexture2DPtr finalColorTex; // used by getFinalColorBufferTexture (if any effects are chained, it will be the result after those)
     ITexture2DPtr finalDepthTex; // used by getFinalDepthBufferTexture (if any effects are chained, it will be the result after those)
 
 
     ITexture2DPtr CreateColorTex();
     ITexture2DPtr CreateDepthTex();
-    //ITexture2DPtr CreateDepthStencilTex();
 
-    // private method used when chaining effects (remember private in C++ is only private to objects of other classes)
-    void PreRender(bool bindFbo);
-    void PostRender(ITexture2DPtr colorTex1, ITexture2DPtr depthTex1, bool output2screen);
+    // the final color/depth-buffers of the previous frames (index 0 is the last frame) - see PostProcessingPass::BindHistoryBuffer
+    vector<ITexture2DPtr> colorHistory;
+    vector<ITexture2DPtr> depthHistory;
+    ITexture2DPtr GetHistoryBuffer(HistoryBuffer buffer, int framesBack);
+    void RotateHistory(vector<ITexture2DPtr>& history, ITexture2DPtr finalTex, bool color);
+
+    bool CheckResize();
+
+    // the passes of this PPE and the PPEs chained to it, flattened into the order they are executed, with their textures assigned
+    struct ScheduledPass {
+	PostProcessingPass*   pass;   // NULL = copy the stencil of depthIn (for the stencil-masked passes of effect), or reduce colorIn:
+	Reduction*            reduction;
+	Histogram*            histogram;
+	PostProcessingEffect* effect;
+	ITexture2DPtr colorIn, colorOut, depthIn, depthOut, stencil;
+	vector<ITexture2DPtr> outputs; // the textures the step writes to
+	int inputVersion;  // GetInputVersion/GetOutputVersion when the step was executed last (-1 = never)
+	int outputVersion;
+    };
+    struct ScheduledEffect {
+	PostProcessingEffect* effect;
+	ITexture2DPtr finalColorTex, finalDepthTex;
+    };
+    vector<ScheduledPass>   schedule;
+    vector<ScheduledEffect> scheduledEffects;
+    int scheduleGeneration; // the value of currentScheduleGeneration when the schedule was compiled
+    static int currentScheduleGeneration;
+    int executedVersion;    // GetScheduleVersion when the schedule was executed last (-1 = never)
+
+    void CompileSchedule();
+    void Schedule(PostProcessingEffect* root, ITexture2DPtr& colorTex, ITexture2DPtr& depthTex);
+    void ScheduleReductions(PostProcessingEffect* root, unsigned int position, ITexture2DPtr colorTex);
+    void ExecuteSchedule();
+    static int GetVersion(ITexture2DPtr tex);
+    static int GetInputVersion(ScheduledPass& step);
+    static int GetOutputVersion(ScheduledPass& step);
+    int GetScheduleVersion();
+    friend class PostProcessingPass;
+    static void InvalidateSchedules();
 
     // misc
     void CheckGLErrors (const char *label);
     void CallSetup();
     void SetSameFilterWrap(ITexture2DPtr src, ITexture2DPtr dst);
+    static string FormatFloat(float value);
 
-    /* change size of FBO virtual screens (when resizing the viewport!) */
+    /* change size of FBO virtual screens (when resizing the viewport!) - only reallocates them if the screen doesn't fit in them */
     void Resize(int currScreenWidth, int currScreenHeight);
 
   protected:
@@ -112,10 +234,25 @@ class PostProcessingEffect : public IListener<ProcessEventArg>
     /* assign fragment programs for the various passes */
     IPostProcessingPass* AddPass(string fpFileName); // returns an object used when assigning input/output-parameters
     IPostProcessingPass* AddPass(vector<string> fpFileNames);
+    IPostProcessingPass* AddPass(string fpFileName, ShaderDefines defines); // with defines injected (e.g. TAPS -> 9), each set of defines is compiled once
+    IPostProcessingPass* AddPass(vector<string> fpFileNames, ShaderDefines defines);
+
+    /* add a pass convolving the colorbuffer with a symmetric 1D kernel (weights: the center first) - run one per direction for a 2D blur */
+    IPostProcessingPass* AddSeparableFilterPass(vector<float> weights, FilterDirection direction);
+    IPostProcessingPass* AddGaussianBlurPass(float sigma, FilterDirection direction);
+    IPostProcessingPass* AddBoxBlurPass(int radius, FilterDirection direction);
+
+    /* reduce the colorbuffer output by the passes added so far to one value on the GPU (f.e. the average luminance for auto-exposure) */
+    IReduction* AddReduction(ReductionOp op, const bool readback = false);
+    IHistogram* AddHistogram(int numBins = 64, float minLog2 = -10.0f, float maxLog2 = 6.0f, const bool readback = false);
+
+    /* declare the number of quality tiers of the effect (call in the constructor) - the passes of each tier are added in SetupTier */
+    void SetNumQualityTiers(int numTiers);
 
   public:
 
     PostProcessingEffect(Viewport* viewport, IEngine& engine, const bool useFloatTextures = false);
+    PostProcessingEffect(Viewport* viewport, IEngine& engine, TexelFormat colorBufferFormat); // f.e. TEX_R11G11B10F for HDR at half the bandwidth of TEX_RGBA16F
     virtual ~PostProcessingEffect();
 
     void PreRender();  // call before rendering the screen (to setup FBO)
@@ -149,8 +286,46 @@ class PostProcessingEffect : public IListener<ProcessEventArg>
     void Enable(bool enable);
     bool IsEnabled();
 
-    /* attach stencil */
-    //void EnableStencilBuffer();
+    /* render the user-screen with MSAA (resolved before the first pass) - 0 samples disables it */
+    void SetMultisampling(int samples, DepthResolve depthResolve = DEPTH_RESOLVE_SAMPLE0);
+
+    /* over-allocate the buffers to multiples of bucketSize pixels, so resizing the viewport rarely reallocates them (0 = exact size) */
+    void SetResizeBucket(int bucketSize);
+    void GetTexCoordScale(float& scaleS, float& scaleT);
+
+    /* render the scene and the passes at a fraction of the viewport size (upscaled to the viewport) - fixed, or adjusted to a GPU time budget */
+    void  SetRenderScale(float scale);
+    float GetRenderScale();
+    void  GetRenderSize(int& width, int& height);
+    void  EnableDynamicResolution(float budgetMilliseconds = 16.6f, float minScale = 0.5f, float maxScale = 1.0f);
+    void  DisableDynamicResolution();
+
+    /* switch between the quality tiers of the effect (0 = the best) - by hand, or picked from the GPU time of the passes by a governor */
+    void SetQualityTier(int tier);
+    int  GetQualityTier();
+    int  GetNumQualityTiers();
+    void PrebuildQualityTiers();
+    void EnableQualityGovernor(float budgetMilliseconds);
+    void DisableQualityGovernor();
+
+    /* skip the passes whose inputs haven't changed since they were executed (only the screen output, if nothing has changed) */
+    void EnableResultCaching(bool enable);
+    void SetSceneUnchanged(); // call before PreRender, if the scene isn't rendered again this frame
+
+    /* the GPU time per frame for the time-budgeted passes (see PostProcessingPass::SetUpdateMode) */
+    void SetUpdateBudget(float milliseconds);
+    unsigned int GetFrameIndex();
+
+    /* run setup now instead of on the first frame (to compile shaders while loading) */
+    void ForceSetup();
+
+    /* give the user-screen a stencil buffer, for stencil-masked passes */
+    void EnableStencilBuffer();
+    bool IsStencilBufferEnabled();
+
+    /* use a uniform block in all passes of this PPE (or of all PPEs) */
+    void AddUniformBlock(IUniformBlockPtr block);
+    static void AddGlobalUniformBlock(IUniformBlockPtr block);
 
     /* methods for chaining PPEs */
     void Add(IPostProcessingEffect* ppe);
@@ -159,7 +334,9 @@ class PostProcessingEffect : public IListener<ProcessEventArg>
 
     /* overwritable user-methods */
     virtual void Setup() = 0;
+    virtual void SetupTier(const int tier); // add the passes of a quality tier (see SetNumQualityTiers)
     virtual void PerFrame(const float deltaTime) = 0;
+    virtual void PerFrame(const float deltaTime, const unsigned int frameIndex);
 
     Viewport* GetViewport();
 
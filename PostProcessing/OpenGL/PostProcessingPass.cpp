@@ -1,20 +1,21 @@
 #include "PostProcessingPass.h"
+#include "PostProcessingEffect.h"
 
 /*  @author Bjarke N. Laustsen
  */
 namespace OpenEngine {
 namespace PostProcessing {
 
-PostProcessingPass::PostProcessingPass(vector<string> fpFileNames, int currScreenWidth, int currScreenHeight, int passID, IPostProcessingEffect* ppe) {
-    this->currScreenWidth = currScreenWidth;
-    this->currScreenHeight = currScreenHeight;
+PostProcessingPass::PostProcessingPass(vector<string> fpFileNames, ShaderDefines defines, int bufferWidth, int bufferHeight, int passID, IPostProcessingEffect* ppe) {
+    this->bufferWidth  = bufferWidth;
+    this->bufferHeight = bufferHeight;
 
     this->passID = passID;
     this->ppe    = ppe;
     glGetIntegerv(GL_MAX_DRAW_BUFFERS, &(this->maxColorAttachments));
 
     // create the fragmentprogram for this pass
-    fp = new FragmentProgram(fpFileNames);
+    fp = new FragmentProgram(fpFileNames, defines);
 
     // create the fbo for this pass
     fbo = new FramebufferObject();
@@ -23,6 +24,17 @@ PostProcessingPass::PostProcessingPass(vector<string> fpFileNames, int currScree
     inputDepthBufferParameterName = "";
     outputsToColorBuffer = false;
     outputsToDepthBuffer = false;
+    stencilMasked = false;
+    stencilRef    = 0;
+    stencilMask   = 0xFF;
+    updateMode      = UPDATE_EVERY_FRAME;
+    updatePeriod    = 1;
+    lastUpdateFrame = 0;
+    budgetSelected  = false;
+    timer           = NULL;
+    separable       = false;
+    separableMax[0] = separableMax[1] = -1;
+    separableLinear = -1;
     for (int i=0; i<maxColorAttachments; i++) userBufferTextures.push_back(ITexture2DPtr());
 }
 
@@ -32,6 +44,12 @@ PostProcessingPass::~PostProcessingPass() {
 
     // delete framebuffer-object for this pass
     delete fbo;
+    delete timer;
+
+    // give the userbuffers back to the pool (after the fbo, so they aren't attached anymore)
+    // - unless the user still has a reference to one (see GetUserBufferRef)
+    for (unsigned int i=0; i<userBufferTextures.size(); i++)
+	if (userBufferTextures.at(i).unique()) Texture2DPool::Release(userBufferTextures.at(i));
 }
 
 
@@ -134,6 +152,29 @@ void PostProcessingPass::BindTexture(string fpParameterName, ITextureResourcePtr
     fp->BindTexture(fpParameterName, inputTexture);
 }
 
+/** As above, but a texture which won't be changed (resized, reloaded or written by glTexImage) while it is bound may be given
+ *  to a program enabling GL_ARB_bindless_texture as a bindless handle instead of a texture unit (a resident handle makes the
+ *  texture immutable). Such textures don't count against GL_MAX_TEXTURE_IMAGE_UNITS, so a bindless program can sample many more.
+ *  Without bindless textures, the texture is bound to a unit as usual.
+ *
+ *  @param[in] fpParameterName the name of the input-parameter in the fragment program
+ *  @param[in] inputTexture the texture to bind
+ *  @param[in] allowHandle whether the texture may be given a bindless handle
+ *  @exception if the smart-pointer inputTexture contains NULL
+ */
+void PostProcessingPass::BindTexture(string fpParameterName, ITextureResourcePtr inputTexture, bool allowHandle) {
+    fp->BindTexture(fpParameterName, inputTexture, allowHandle);
+}
+
+/** Use a uniform block (shared values, e.g. screen size and time) in the fragmentprogram of this pass.
+ *  (to use a block in all passes of an effect, see PostProcessingEffect::AddUniformBlock)
+ *
+ *  @param[in] block the uniform block (the fragment program must declare it, see UniformBlock)
+ */
+void PostProcessingPass::BindUniformBlock(IUniformBlockPtr block) {
+    fp->BindUniformBlock(block);
+}
+
 /** Bind the color buffer to a uniform sampler2D input-parameter of the fragmentprogram of this pass.
  *  (it's the color buffer from the last pass that wrote to it, or the color buffer of the
  *  rendered screen, if no previous passes has written to it)
@@ -179,7 +220,24 @@ void PostProcessingPass::BindUserBuffer(string fpParameterName, IPostProcessingP
 
     // bind the output texture to the input-parameter
     ITexture2DPtr outputTex = outputPass->GetUserBufferRef(outputAttachmentPoint);//outputPass->userBufferTextures[outputAttachmentPoint];
-    this->BindTexture(fpParameterName, outputTex);
+    fp->BindTexture(fpParameterName, outputTex, true); // <- (owned by the effect, so it may be given a bindless handle)
+}
+
+/** Bind the final color- or depthbuffer of an earlier frame of the effect of this pass (the result after the effects chained
+ *  to it), f.e. for temporal anti-aliasing, motion blur or eye adaptation.
+ *  The effect keeps a ring of as many frames as are bound, which is rotated each frame by swapping the textures - so it costs
+ *  no copying (unless the buffer is the user-screen itself, i.e. no pass writes to it - then it is copied to the ring).
+ *  The content is undefined until that many frames have been executed.
+ *
+ *  @param[in] fpParameterName the name of the input-parameter in the fragment program
+ *  @param[in] buffer the color- or depthbuffer
+ *  @param[in] framesBack how many frames back (1 = the last frame)
+ *  @exception PostProcessingException thrown if framesBack is less than 1
+ */
+void PostProcessingPass::BindHistoryBuffer(string fpParameterName, HistoryBuffer buffer, int framesBack) {
+    if (framesBack < 1) throw PostProcessingException("framesBack must be at least 1");
+    ITexture2DPtr historyTex = ((PostProcessingEffect*)ppe)->GetHistoryBuffer(buffer, framesBack);
+    fp->BindTexture(fpParameterName, historyTex, true);
 }
 
 
@@ -195,7 +253,9 @@ void PostProcessingPass::EnableColorBufferOutput() {
     // NOTE: the buffer is not attached here to the fbo for the pass, it's done in executePass(), since we don't know here which of
     //       the two ping-pong textures for the buffer that will be the one that must be attached.
     if (userBufferTextures[0].get() != NULL) throw PostProcessingException("can't attach both colorbuffer and userbuffer at attachment-point 0");
+    if (updateMode != UPDATE_EVERY_FRAME) throw PostProcessingException("a pass which isn't updated every frame can only output to userbuffers");
     outputsToColorBuffer = true;
+    PostProcessingEffect::InvalidateSchedules(); // <- (the ping-pong textures are assigned when the schedule is compiled)
 }
 
 /** Specifies that the fragmentprogram of this pass writes output to the depthbuffer.
@@ -204,7 +264,148 @@ void PostProcessingPass::EnableColorBufferOutput() {
 void PostProcessingPass::EnableDepthBufferOutput() {
     // NOTE: the buffer is not attached here to the fbo for the pass, it's done in executePass(), since we don't know here which of
     //       the two ping-pong textures for the buffer that will be the one that must be attached.
+    if (stencilMasked) throw PostProcessingException("a stencil-masked pass can't output to the depthbuffer");
+    if (updateMode != UPDATE_EVERY_FRAME) throw PostProcessingException("a pass which isn't updated every frame can only output to userbuffers");
     outputsToDepthBuffer = true;
+    PostProcessingEffect::InvalidateSchedules();
+}
+
+/** Only execute this pass on the pixels where the stencil value of the user-screen matches, i.e. where
+ *  (stencil & mask) == (ref & mask). The scene tags the pixels (f.e. water or characters) by writing stencil values while it is
+ *  rendered, so an effect which only touches a small part of the screen only shades those pixels.
+ *  On the other pixels the colorbuffer output is the colorbuffer input (it is copied first), and userbuffers are left unchanged.
+ *
+ *  The effect must have a stencil buffer (see PostProcessingEffect::EnableStencilBuffer).
+ *
+ *  @param[in] ref the stencil reference value
+ *  @param[in] mask the bits of the stencil value to compare
+ *  @exception PostProcessingException thrown if the pass outputs to the depthbuffer (the stencil and the depth output can't be attached together)
+ */
+void PostProcessingPass::EnableStencilMask(int ref, unsigned int mask) {
+    if (outputsToDepthBuffer) throw PostProcessingException("a pass outputting to the depthbuffer can't be stencil-masked");
+    stencilMasked = true;
+    stencilRef    = ref;
+    stencilMask   = mask;
+    PostProcessingEffect::InvalidateSchedules();
+}
+
+/** Execute this pass on all pixels again (see EnableStencilMask)
+ */
+void PostProcessingPass::DisableStencilMask() {
+    if (!stencilMasked) return;
+    stencilMasked = false;
+    fbo->DetachStencilAttachment();
+    PostProcessingEffect::InvalidateSchedules();
+}
+
+/** Update this pass less often than every frame, to amortize an expensive pass (f.e. SSAO or a large blur) over several frames.
+ *  Its output is kept in its userbuffers between the updates, so it can only output to userbuffers (the color/depth-buffers
+ *  are ping-ponged between the passes).
+ *  - UPDATE_EVERY_NTH_FRAME: the whole pass is executed on every period'th frame
+ *  - UPDATE_CHECKERBOARD: the pass is executed every frame, but only on every other pixel - alternating between the two halves
+ *  - UPDATE_INTERLEAVED_ROWS: the pass is executed every frame, but only on every period'th row (period must divide 32)
+ *  - UPDATE_TIME_BUDGET: the whole pass is executed on the frames where its GPU time fits in the budget of the effect
+ *    (see PostProcessingEffect::SetUpdateBudget) - the least recently updated passes are updated first
+ *  The fragment program can use the phase of the frame (see GetUpdatePhase), f.e. to jitter its samples, so the updates
+ *  add up to the full result. Bind it in PerFrame, which is given the frame index.
+ *
+ *  @param[in] mode how often to update the pass
+ *  @param[in] period the number of frames to update all pixels in (UPDATE_EVERY_NTH_FRAME and UPDATE_INTERLEAVED_ROWS only)
+ *  @exception PostProcessingException thrown if the pass outputs to the color- or depthbuffer, or the period is illegal
+ */
+void PostProcessingPass::SetUpdateMode(PassUpdateMode mode, int period) {
+    if (mode != UPDATE_EVERY_FRAME && (outputsToColorBuffer || outputsToDepthBuffer))
+	throw PostProcessingException("a pass which isn't updated every frame can only output to userbuffers");
+    if (period < 1) throw PostProcessingException("the update period must be at least 1");
+    if (mode == UPDATE_INTERLEAVED_ROWS && 32 % period != 0) throw PostProcessingException("the update period of interleaved rows must divide 32");
+
+    updateMode = mode;
+    if      (mode == UPDATE_EVERY_NTH_FRAME || mode == UPDATE_INTERLEAVED_ROWS) updatePeriod = period;
+    else if (mode == UPDATE_CHECKERBOARD) updatePeriod = 2;
+    else                                  updatePeriod = 1;
+    if (mode == UPDATE_TIME_BUDGET) EnableTiming();
+    if (mode == UPDATE_TIME_BUDGET && !GpuTimer::IsSupported())
+	logger.warning << "GL_EXT_timer_query not supported - time-budgeted passes are updated every frame" << logger.end;
+}
+
+/** @return how often this pass is updated
+ */
+PassUpdateMode PostProcessingPass::GetUpdateMode() {
+    return updateMode;
+}
+
+/** Get the phase of the given frame, i.e. which part of the pass is updated on it: the row offset (UPDATE_INTERLEAVED_ROWS),
+ *  the half of the checkerboard (UPDATE_CHECKERBOARD), or the frames since the last update (UPDATE_EVERY_NTH_FRAME, 0 = updated).
+ *  Always 0 for the other modes.
+ *  @param[in] frameIndex the frame index of the effect (see PostProcessingEffect::PerFrame)
+ *  @return the phase (0 to period-1)
+ */
+int PostProcessingPass::GetUpdatePhase(unsigned int frameIndex) {
+    return frameIndex % updatePeriod;
+}
+
+// measure the GPU time of the pass each time it is executed (for time-budgeted passes and dynamic resolution)
+void PostProcessingPass::EnableTiming() {
+    if (timer == NULL) timer = new GpuTimer();
+}
+
+// whether the pass is executed on the given frame
+bool PostProcessingPass::IsUpdated(unsigned int frameIndex) {
+    switch (updateMode) {
+	case UPDATE_EVERY_NTH_FRAME: return GetUpdatePhase(frameIndex) == 0;
+	case UPDATE_TIME_BUDGET:     return budgetSelected;
+	default:                     return true;
+    }
+}
+
+// whether only part of the pixels are updated each time the pass is executed
+bool PostProcessingPass::IsPartiallyUpdated() {
+    return updateMode == UPDATE_CHECKERBOARD || updateMode == UPDATE_INTERLEAVED_ROWS;
+}
+
+/* restrict the quad to the pixels updated in the given phase, with a polygon stipple (a 32x32 bit pattern repeated over the
+   screen - so no extra buffers are needed). The stipple is window-aligned, and the passes render to (0,0) of their fbo. */
+void PostProcessingPass::SetStipple(int phase) {
+    GLubyte pattern[32*4];
+    for (int y=0; y<32; y++) {
+	for (int b=0; b<4; b++) {
+	    GLubyte bits = 0;
+	    for (int x=b*8; x<b*8+8; x++) {
+		bool updated = (updateMode == UPDATE_CHECKERBOARD) ? ((x + y) % 2 == phase) : (y % updatePeriod == phase);
+		bits = (bits << 1) | (updated ? 1 : 0); // <- (most significant bit first)
+	    }
+	    pattern[y*4 + b] = bits;
+	}
+    }
+    glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT); // <- (the pattern is unpacked like a texture)
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+    glPixelStorei(GL_UNPACK_LSB_FIRST, GL_FALSE);
+    glPolygonStipple(pattern);
+    glPopClientAttrib();
+    glEnable(GL_POLYGON_STIPPLE);
+}
+
+/** @return whether this pass is stencil-masked
+ */
+bool PostProcessingPass::IsStencilMasked() {
+    return stencilMasked;
+}
+
+/* copy (the screen part of) src to the colorbuffer output of this pass (which is attached at attachment 0) */
+void PostProcessingPass::CopyColorBuffer(ITexture2DPtr src, int width, int height) {
+    static FramebufferObject* readFbo = NULL; // <- (shared by all passes)
+    if (readFbo == NULL) readFbo = new FramebufferObject();
+    readFbo->AttachColorTexture(src, 0);
+
+    glBindFramebufferEXT(GL_READ_FRAMEBUFFER_EXT, (GLuint)readFbo->GetID());
+    glReadBuffer(GL_COLOR_ATTACHMENT0_EXT);
+    glBindFramebufferEXT(GL_DRAW_FRAMEBUFFER_EXT, (GLuint)fbo->GetID());
+    glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT); // <- (the draw buffers of the fbo are selected again by Execute)
+    glBlitFramebufferEXT(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);
 }
 
 
@@ -228,20 +429,35 @@ void PostProcessingPass::EnableDepthBufferOutput() {
  *  @exception PostProcessingException thrown if there were already attached a userbuffer at the given attachmentPoint.
  */
 void PostProcessingPass::AttachUserBuffer(int attachmentPoint, const bool createFloatTexture) {
+    AttachUserBuffer(attachmentPoint, createFloatTexture ? TEX_RGBA_FLOAT : TEX_RGBA);
+}
+
+/** As above, but the texture of the userbuffer gets the given texel format.
+ *  Use the smallest format that holds what the pass outputs - f.e. TEX_R8 or TEX_R16F for a single value (like AO, CoC or luminance),
+ *  TEX_RG16F for two (like velocity), and TEX_R11G11B10F for HDR color without alpha. The fragment program writes the
+ *  components it has in gl_FragData[attachmentPoint].r (and .g), and GetUserBuffer returns a texture of the same format.
+ *  The texture is taken from the Texture2DPool, and given back to it when the pass is deleted (if not referenced elsewhere).
+ *
+ *  @param[in] attachmentPoint the attachmentpoint to attach a userbuffer
+ *  @param[in] format the texel format of the texture (must be color-renderable, so not depth or luminance)
+ *  @exception PostProcessingException thrown if the format isn't color-renderable
+ */
+void PostProcessingPass::AttachUserBuffer(int attachmentPoint, TexelFormat format) {
+    if (format==TEX_DEPTH || format==TEX_DEPTH_STENCIL || format==TEX_LUMINANCE || format==TEX_LUMINANCE_FLOAT)
+	throw PostProcessingException("illegal userbuffer format (must be color-renderable)");
     if (attachmentPoint >= maxColorAttachments) throw PostProcessingException("attachmentpoint too large (for this gfx card)");
     if (attachmentPoint==0 && outputsToColorBuffer) throw PostProcessingException("can't attach both colorbuffer and userbuffer at attachment-point 0");
     if (userBufferTextures[attachmentPoint].get() != NULL) throw PostProcessingException("there were already a output-userbuffer for this pass at this attachmentpoint");
 
     // create a new color-texture (since we're using rextures, not renderbuffers)
-    ITexture2DPtr tex;
-    if (createFloatTexture) tex = ITexture2DPtr(new Texture2D(currScreenWidth, currScreenHeight, TEX_RGBA_FLOAT, TEX_CLAMP_TO_EDGE, TEX_CLAMP_TO_EDGE, TEX_LINEAR, TEX_LINEAR));
-    else                    tex = ITexture2DPtr(new Texture2D(currScreenWidth, currScreenHeight, TEX_RGBA      , TEX_CLAMP_TO_EDGE, TEX_CLAMP_TO_EDGE, TEX_LINEAR, TEX_LINEAR));
+    ITexture2DPtr tex = Texture2DPool::Acquire(bufferWidth, bufferHeight, format, TEX_CLAMP_TO_EDGE, TEX_CLAMP_TO_EDGE, TEX_LINEAR, TEX_LINEAR);
 
     // store in at the pass under the correct attachment point
     userBufferTextures[attachmentPoint] = tex;
 
     // attach it to the fbo for the pass
     fbo->AttachColorTexture(tex, attachmentPoint);
+    PostProcessingEffect::InvalidateSchedules(); // <- (the outputs of each pass are collected when the schedule is compiled)
 }
 
 
@@ -299,23 +515,38 @@ ITexture2DPtr PostProcessingPass::GetUserBufferRef(int attachmentPoint) {
 }
 
 /* execute this pass */
-void PostProcessingPass::Execute(ITexture2DPtr texColorInput, ITexture2DPtr texColorOutput, ITexture2DPtr texDepthInput, ITexture2DPtr texDepthOutput, Viewport* viewport) { //int texSizeX, int texSizeY) {
+void PostProcessingPass::Execute(ITexture2DPtr texColorInput, ITexture2DPtr texColorOutput, ITexture2DPtr texDepthInput, ITexture2DPtr texDepthOutput, int width, int height, ITexture2DPtr texStencil, unsigned int frameIndex) { //int texSizeX, int texSizeY) {
 
     // attach the color- and depth-output textures to the fbo (color is attached at attachmentpoint 0)
     // (ONLY attach if the fp outputs to them, otherwise it'll be filled with crap! E.g. if fragprog doesn't write to depth, it will be the interpolated vertex-depths => constant values due to quad!!)
     // (another reason: if we attach the color-buffer while the user have his own userbuffer at attachment 0, hell will break loose)
     if (outputsToColorBuffer) fbo->AttachColorTexture(texColorOutput, 0);
-    if (outputsToDepthBuffer) fbo->AttachDepthTexture(texDepthOutput);
+    if (outputsToDepthBuffer) {
+	if (texDepthOutput->GetFormat() == TEX_DEPTH_STENCIL) fbo->AttachDepthStencilTexture(texDepthOutput); // <- (depth and stencil must be the same image)
+	else                                                  fbo->AttachDepthTexture(texDepthOutput);
+    }
+
+    // stencil-masked: attach the stencil of the user-screen, and let the unmasked pixels keep the input color
+    if (stencilMasked) {
+	if (texStencil.get() == NULL) throw PostProcessingException("stencil-masked pass in an effect without a stencil buffer (see PostProcessingEffect::EnableStencilBuffer)");
+	fbo->AttachStencilTexture(texStencil);
+	if (outputsToColorBuffer) CopyColorBuffer(texColorInput, width, height);
+    }
+
+    // (the userbuffers may have moved to new texture-handles since they were attached)
+    fbo->RefreshAttachments();
 
     // enable MRT (always in the order 0,1,2,...,15 - otherwise it would be damn confusing)
     fbo->SelectDrawBuffers();
 
     // bind buffer-textures to input parameters
     if (inputColorBufferParameterName != "")
-	fp->BindTexture(inputColorBufferParameterName, texColorInput);
+	fp->BindTexture(inputColorBufferParameterName, texColorInput, true);
 
     if (inputDepthBufferParameterName != "")
-        fp->BindTexture(inputDepthBufferParameterName, texDepthInput);
+        fp->BindTexture(inputDepthBufferParameterName, texDepthInput, true);
+
+    if (separable) SetupSeparableInput(width, height);
 
     // bind fragment program for this pass
     fp->Bind();
@@ -323,13 +554,24 @@ void PostProcessingPass::Execute(ITexture2DPtr texColorInput, ITexture2DPtr texC
     // bind fbo for this pass
     fbo->Bind();
 
-    // set proper viewport and draw quad (which fills the entire fbo-screen)
-    PostProcessingPass::SetProperViewport(viewport, true);
-    PostProcessingPass::PerformGpuComputation(viewport);
+    // set proper viewport and draw quad (which fills the screen part of the fbo-screen - the buffers may be larger than the screen,
+    // and the screen is rendered at width x height, which is smaller than the viewport with dynamic resolution)
+    PostProcessingPass::SetProperViewport(width, height);
+    if (stencilMasked) {
+	glEnable(GL_STENCIL_TEST);
+	glStencilFunc(GL_EQUAL, stencilRef, stencilMask);
+	glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+    }
+    if (IsPartiallyUpdated()) SetStipple(GetUpdatePhase(frameIndex)); // <- only the pixels of this phase
+    if (timer != NULL) timer->Begin();
+    PostProcessingPass::PerformGpuComputation(width, height, width / (float)bufferWidth, height / (float)bufferHeight);
+    if (timer != NULL) timer->End();
+    if (stencilMasked) glDisable(GL_STENCIL_TEST);
+    if (IsPartiallyUpdated()) glDisable(GL_POLYGON_STIPPLE);
 
     // unbind FBO again (no, no need to do it, and it is faster not to)
     //fbo->Unbind();
-    glBindTexture(GL_TEXTURE_2D, 0);
+    // (the textures are left bound too - FragmentProgram only rebinds the texture units that change between passes)
 
     // check if something went completely wrong
     CheckGLErrors ("myCheck1!");
@@ -339,6 +581,37 @@ void PostProcessingPass::Execute(ITexture2DPtr texColorInput, ITexture2DPtr texC
 }
 
 
+/* bind the inputs of separable.frag which depend on what src is: the texture coordinates of the texels of src covered by the
+ * screen (the buffers may be larger than the screen, and the texels outside it are stale), and whether src is filtered linearly
+ * (otherwise the merged taps would just fetch the nearest texel - see PostProcessingEffect::AddSeparableFilterPass).
+ * Only rebound when they change (src may be rebound to a userbuffer, or its filter changed, at any time)
+ */
+void PostProcessingPass::SetupSeparableInput(int width, int height) {
+    float maxS = (width  - 0.5f) / bufferWidth;
+    float maxT = (height - 0.5f) / bufferHeight;
+    if (maxS != separableMax[0] || maxT != separableMax[1]) {
+	vector<float> srcMin, srcMax;
+	srcMin.push_back(0.5f / bufferWidth);
+	srcMin.push_back(0.5f / bufferHeight);
+	srcMax.push_back(maxS);
+	srcMax.push_back(maxT);
+	fp->BindFloat("srcMin", srcMin);
+	fp->BindFloat("srcMax", srcMax);
+	separableMax[0] = maxS;
+	separableMax[1] = maxT;
+    }
+
+    ITexture2DPtr src = boost::dynamic_pointer_cast<ITexture2D>(fp->GetTexture("src"));
+    float linear = (src.get() != NULL && src->GetMinFilter() == TEX_LINEAR && src->GetMagFilter() == TEX_LINEAR) ? 1.0f : 0.0f;
+    if (linear != separableLinear) {
+	vector<float> srcLinear;
+	srcLinear.push_back(linear);
+	fp->BindFloat("srcLinear", srcLinear);
+	separableLinear = linear;
+    }
+}
+
+
 /** @return wether this pass has been enabled to output to the color buffer
  */
 bool PostProcessingPass::IsColorBufferOutput() {
@@ -359,15 +632,17 @@ bool PostProcessingPass::IsUserBufferOutput(int attachmentPoint) {
 
 
 /* change size of FBO virtual screens (called by PostProcessingEffect when its resize-method is called) */
-void PostProcessingPass::Resize(int currScreenWidth, int currScreenHeight) {
-    this->currScreenWidth  = currScreenWidth;
-    this->currScreenHeight = currScreenHeight;
+void PostProcessingPass::Resize(int bufferWidth, int bufferHeight) {
+    this->bufferWidth  = bufferWidth;
+    this->bufferHeight = bufferHeight;
+    separableMax[0] = separableMax[1] = -1; // <- (srcMin and srcMax are in texture coordinates of the buffers)
 
-    // resize alle userbuffers i dette pass
+    // resize alle userbuffers i dette pass (and attach them again, as a texture with immutable storage gets a new texture-handle)
     for (int j=0; j<maxColorAttachments; j++) {
 	ITexture2DPtr tex = userBufferTextures[j];
-	//if (tex != NULL) tex->Resize(currScreenWidth, currScreenHeight);
-	if (tex.get() != NULL) tex->Resize(currScreenWidth, currScreenHeight);
+	if (tex.get() == NULL) continue;
+	tex->Resize(bufferWidth, bufferHeight);
+	fbo->AttachColorTexture(tex, j);
     }
 }
 
@@ -427,17 +702,27 @@ void PostProcessingPass::SetProperViewport(Viewport* viewport, bool fbo) {
                viewport->GetDimension()[3]);
 }
 
-/* Perform the computation */
-void PostProcessingPass::PerformGpuComputation(Viewport* viewport) {
+/* As above for an fbo, where the screen is rendered to the lower left width x height part of the buffers */
+void PostProcessingPass::SetProperViewport(int width, int height) {
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    gluOrtho2D(0, width, 0, height);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    glViewport(0, 0, width, height);
+}
+
+/* Perform the computation: draw a width x height quad (texScaleS/T: the part of the input textures covered by the screen, if they are larger than it) */
+void PostProcessingPass::PerformGpuComputation(int width, int height, float texScaleS, float texScaleT) {
 
     // make quad filled, not wireframe, to hit every pixel/texel (should be default but we never know)
     glPolygonMode(GL_FRONT,GL_FILL);
     // and render quad
     glBegin(GL_QUADS);
-    glTexCoord2f(0.0, 0.0); glVertex2f(0.0                        , 0.0);
-    glTexCoord2f(1.0, 0.0); glVertex2f(viewport->GetDimension()[2], 0.0);
-    glTexCoord2f(1.0, 1.0); glVertex2f(viewport->GetDimension()[2], viewport->GetDimension()[3]);
-    glTexCoord2f(0.0, 1.0); glVertex2f(0.0                        , viewport->GetDimension()[3]);
+    glTexCoord2f(0.0      , 0.0      ); glVertex2f(0.0  , 0.0);
+    glTexCoord2f(texScaleS, 0.0      ); glVertex2f(width, 0.0);
+    glTexCoord2f(texScaleS, texScaleT); glVertex2f(width, height);
+    glTexCoord2f(0.0      , texScaleT); glVertex2f(0.0  , height);
     glEnd();
 }
 
@@ -10,9 +10,12 @@
 #include <Resources/ITextureResource.h>
 #include <PostProcessing/PostProcessingException.h>
 #include <Resources/OpenGL/FragmentProgram.h>
+#include <Resources/OpenGL/UniformBlock.h>
 #include <Resources/OpenGL/FramebufferObject.h>
 #include <Resources/OpenGL/Texture2D.h>
+#include <Resources/OpenGL/Texture2DPool.h>
 #include <Resources/OpenGL/RenderBuffer.h>
+#include <Resources/OpenGL/GpuTimer.h>
 #include <Display/Viewport.h>
 #include <Logging/Logger.h>
 
@@ -25,6 +28,8 @@ using namespace OpenEngine::Resources; // for ITextureResourcePtr
 
 class IPostProcessingEffect;
 class PostProcessingEffect;
+class Reduction;
+class Histogram;
 
 /** Objects of this class represents a pass.
  *  @author Bjarke N. Laustsen
@@ -37,8 +42,8 @@ class PostProcessingPass : public IPostProcessingPass {
     IPostProcessingEffect* ppe;   // used for error-checking in bindUserBuffer()
 
     GLint maxColorAttachments;
-    int currScreenWidth;
-    int currScreenHeight;
+    int bufferWidth;  // the size of the userbuffers (may be larger than the screen - see PostProcessingEffect::SetResizeBucket)
+    int bufferHeight;
 
     FragmentProgram* fp; // the fragment program assigned to this pass
 
@@ -52,23 +57,50 @@ class PostProcessingPass : public IPostProcessingPass {
 
     vector<ITexture2DPtr> userBufferTextures; // textures for each attachment point
 
+    // stencil-masked execution (see EnableStencilMask)
+    bool   stencilMasked;
+    GLint  stencilRef;
+    GLuint stencilMask;
+    bool   IsStencilMasked();
+    void   CopyColorBuffer(ITexture2DPtr src, int width, int height); // <- to the colorbuffer output (attachment 0)
+
+    // temporal amortization (see SetUpdateMode)
+    PassUpdateMode updateMode;
+    int            updatePeriod;
+    unsigned int   lastUpdateFrame; // the frame index of the effect when the pass was updated last
+    bool           budgetSelected;  // whether a time-budgeted pass is updated this frame (chosen by the effect)
+    GpuTimer*      timer;           // the GPU time of the pass (NULL if not measured - see EnableTiming)
+    void EnableTiming();
+    bool IsUpdated(unsigned int frameIndex);
+    bool IsPartiallyUpdated();
+    void SetStipple(int phase);
+
+    // separable filter passes (see PostProcessingEffect::AddSeparableFilterPass)
+    bool  separable;
+    float separableMax[2]; // the last values bound to srcMax and srcLinear (-1 before the first execution)
+    float separableLinear;
+    void  SetupSeparableInput(int width, int height);
+
     /** private methods which are only accessible from PostProcessingEffect (*not* accessible to the user) */
 
     friend class PostProcessingEffect;
-    PostProcessingPass(vector<string> fpFileNames, int currScreenWidth, int currScreenHeight, int passID, IPostProcessingEffect* ppe);
+    friend class Reduction; // <- (SetProperViewport, PerformGpuComputation)
+    friend class Histogram;
+    PostProcessingPass(vector<string> fpFileNames, ShaderDefines defines, int bufferWidth, int bufferHeight, int passID, IPostProcessingEffect* ppe);
     virtual ~PostProcessingPass();
     PostProcessingPass() {}
 
     /* resize all userbuffers for this pass (must not be called by user) */
-    void Resize(int currScreenWidth, int currScreenHeight);
+    void Resize(int bufferWidth, int bufferHeight);
 
     /* execute this pass (must not be called by user) */
-    void Execute(ITexture2DPtr texColorInput, ITexture2DPtr texColorOutput, ITexture2DPtr texDepthInput, ITexture2DPtr texDepthOutputID, Viewport* viewport);//, int texSizeX, int texSizeY); // execute a pass
+    void Execute(ITexture2DPtr texColorInput, ITexture2DPtr texColorOutput, ITexture2DPtr texDepthInput, ITexture2DPtr texDepthOutputID, int width, int height, ITexture2DPtr texStencil, unsigned int frameIndex);//, int texSizeX, int texSizeY); // execute a pass
 
     void CheckGLErrors (const char *label);
 
     static void SetProperViewport(Viewport* viewport, bool fbo);
-    static void PerformGpuComputation(Viewport* viewport);
+    static void SetProperViewport(int width, int height); // <- (fbo - the lower left part of the buffers)
+    static void PerformGpuComputation(int width, int height, float texScaleS = 1.0, float texScaleT = 1.0);
 
   public:
 
@@ -80,16 +112,29 @@ class PostProcessingPass : public IPostProcessingPass {
     void BindMatrix      (string fpParameterName, int n, int m, vector<float> floatmatrix, const bool transpose = false);
     void BindMatrix      (string fpParameterName, int n, int m, vector<vector<float> > floatmatrices, const bool transpose = false);
     void BindTexture     (string fpParameterName, ITextureResourcePtr tex);
+    void BindTexture     (string fpParameterName, ITextureResourcePtr tex, bool allowHandle);
     void BindColorBuffer (string fpParameterName);
     void BindDepthBuffer (string fpParameterName);
     void BindUserBuffer  (string fpParameterName, IPostProcessingPass* outputPass, int outputAttachmentPoint);
+    void BindUniformBlock(IUniformBlockPtr block);
+    void BindHistoryBuffer(string fpParameterName, HistoryBuffer buffer, int framesBack = 1);
 
     /* assign which buffers the fragmentprogram of a pass outputs to. (must enable for all buffers it writes to) */
     void EnableColorBufferOutput();
     void EnableDepthBufferOutput();
 
+    /* only execute the pass on the pixels where the stencil of the user-screen matches */
+    void EnableStencilMask(int ref, unsigned int mask = 0xFF);
+    void DisableStencilMask();
+
+    /* update this pass less often than every frame - its output is kept in its userbuffers in between */
+    void SetUpdateMode(PassUpdateMode mode, int period = 2);
+    PassUpdateMode GetUpdateMode();
+    int  GetUpdatePhase(unsigned int frameIndex);
+
     /* attach userbuffer at the attachmentPoint */
     void AttachUserBuffer(int attachmentPoint, const bool createFloatTexture = false);
+    void AttachUserBuffer(int attachmentPoint, TexelFormat format);
 
     /* return a COPY of the texture from the userbuffer at the attachmentPoint */
     ITexture2DPtr GetUserBuffer(int attachmentPoint);
@@ -0,0 +1,136 @@
+#include "Reduction.h"
+#include "PostProcessingPass.h"
+
+namespace OpenEngine {
+namespace PostProcessing {
+
+// the texels of a level reduced to one texel of the next (must match BLOCK in reduce.frag)
+static const int BLOCK = 4;
+
+/* Create a reduction (see PostProcessingEffect::AddReduction) */
+Reduction::Reduction(ReductionOp op, unsigned int position) {
+    this->op       = op;
+    this->position = position;
+
+    ShaderDefines defines;
+    switch (op) {
+	case REDUCE_MIN:         defines["REDUCE_MIN"]         = "1"; break;
+	case REDUCE_MAX:         defines["REDUCE_MAX"]         = "1"; break;
+	case REDUCE_AVERAGE:     defines["REDUCE_AVERAGE"]     = "1"; break;
+	case REDUCE_LOG_AVERAGE: defines["REDUCE_LOG_AVERAGE"] = "1"; break;
+	default: throw PostProcessingException("illegal reduction");
+    }
+    fp  = new FragmentProgram("reduce.frag", defines);
+    fbo = new FramebufferObject();
+
+    // (32 bit float, as the average is summed up level by level)
+    result = ITexture2DPtr(new Texture2D(1, 1, TEX_RGBA32F, TEX_CLAMP_TO_EDGE, TEX_CLAMP_TO_EDGE, TEX_NEAREST, TEX_NEAREST));
+    width  = 0;
+    height = 0;
+
+    readback = NULL;
+}
+
+Reduction::~Reduction() {
+    ReleaseLevels();
+    delete readback;
+    delete fbo;
+    delete fp;
+}
+
+/* Reduce the lower left width x height texels of input to the result texture (and start reading it back, if enabled).
+   Called by PostProcessingEffect when the schedule is executed, where the gl state has been backed up */
+void Reduction::Execute(ITexture2DPtr input, int width, int height) {
+    if (width != this->width || height != this->height) Allocate(width, height);
+
+    // first level: the input (with its texel size, as the screen may only fill part of it). The last level: the result
+    ITexture2DPtr src = input;
+    int srcWidth  = width;
+    int srcHeight = height;
+    for (unsigned int i=0; i<=levels.size(); i++) {
+	ITexture2DPtr dst = (i == levels.size()) ? result : levels.at(i);
+	int dstWidth  = (srcWidth  + BLOCK - 1) / BLOCK;
+	int dstHeight = (srcHeight + BLOCK - 1) / BLOCK;
+
+	vector<float> texelSize;
+	texelSize.push_back(1.0f / src->GetWidth());
+	texelSize.push_back(1.0f / src->GetHeight());
+	vector<float> size;
+	size.push_back((float)srcWidth);
+	size.push_back((float)srcHeight);
+	fp->BindTexture("src", src, true);
+	fp->BindFloat("srcTexelSize", texelSize);
+	fp->BindFloat("srcSize", size);
+	fp->BindFloat("first",  vector<float>(1, (i == 0) ? 1.0f : 0.0f));
+	fp->BindFloat("last",   vector<float>(1, (i == levels.size()) ? 1.0f : 0.0f));
+	fp->BindFloat("weight", vector<float>(1, 1.0f / ((float)width * height)));
+	fp->Bind();
+
+	fbo->AttachColorTexture(dst, 0);
+	fbo->SelectDrawBuffers();
+	fbo->Bind();
+	PostProcessingPass::SetProperViewport(dstWidth, dstHeight);
+	PostProcessingPass::PerformGpuComputation(dstWidth, dstHeight); // (the program reads the texels with gl_FragCoord - no texture coordinates)
+	fp->Unbind();
+
+	src       = dst;
+	srcWidth  = dstWidth;
+	srcHeight = dstHeight;
+    }
+    result->IncrementVersion();
+
+    if (readback != NULL) readback->Read();
+}
+
+/* get the intermediate levels for reducing a width x height part of a colorbuffer (each BLOCK times smaller, down to 1x1) */
+void Reduction::Allocate(int width, int height) {
+    ReleaseLevels();
+    this->width  = width;
+    this->height = height;
+    int levelWidth  = (width  + BLOCK - 1) / BLOCK;
+    int levelHeight = (height + BLOCK - 1) / BLOCK;
+    while (levelWidth > 1 || levelHeight > 1) {
+	levels.push_back(Texture2DPool::Acquire(levelWidth, levelHeight, TEX_RGBA32F, TEX_CLAMP_TO_EDGE, TEX_CLAMP_TO_EDGE, TEX_NEAREST, TEX_NEAREST));
+	levelWidth  = (levelWidth  + BLOCK - 1) / BLOCK;
+	levelHeight = (levelHeight + BLOCK - 1) / BLOCK;
+    }
+}
+
+void Reduction::ReleaseLevels() {
+    for (unsigned int i=0; i<levels.size(); i++) Texture2DPool::Release(levels.at(i));
+    levels.clear();
+}
+
+/** Get the 1x1 texture holding the result (the same texture object for the lifetime of the reduction, so it can be bound to passes).
+ *  rgb is the reduction of each color component, alpha the reduction of the luminance of the colors.
+ */
+ITexture2DPtr Reduction::GetResult() {
+    return result;
+}
+
+/** Read the result back to the CPU each time the reduction is executed (see GetResultValues)
+ */
+void Reduction::EnableReadback(bool enable) {
+    if (enable && readback == NULL) readback = new TextureReadback(result);
+    if (!enable) {
+	delete readback;
+	readback = NULL;
+    }
+}
+
+/** Get the result read back to the CPU. The values are those of 2 executions ago - so in PerFrame, the result of 2 frames
+ *  ago - as the reading isn't waited for (see TextureReadback).
+ *  @param[out] values rgba (see GetResult)
+ *  @return false if no result has been read back yet (see EnableReadback)
+ */
+bool Reduction::GetResultValues(float values[4]) {
+    if (readback == NULL) return false;
+    return readback->GetData(values);
+}
+
+ReductionOp Reduction::GetOp() {
+    return op;
+}
+
+} // NS PostProcessing
+} // NS OpenEngine
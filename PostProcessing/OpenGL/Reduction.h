@@ -0,0 +1,68 @@
+#ifndef __REDUCTION_H__
+#define __REDUCTION_H__
+
+#include <vector>
+
+#include <PostProcessing/IReduction.h>
+#include <PostProcessing/PostProcessingException.h>
+#include <Resources/OpenGL/FragmentProgram.h>
+#include <Resources/OpenGL/FramebufferObject.h>
+#include <Resources/OpenGL/Texture2D.h>
+#include <Resources/OpenGL/Texture2DPool.h>
+#include <Resources/OpenGL/TextureReadback.h>
+#include <Logging/Logger.h>
+#include <Meta/OpenGL.h>
+
+namespace OpenEngine {
+namespace PostProcessing {
+
+using namespace std;
+using namespace OpenEngine::Resources;
+
+class PostProcessingEffect;
+
+/** Reduces the colorbuffer to a single value (min, max, average or log-average) on the GPU, by rendering it to smaller and
+ *  smaller textures (each texel reducing a block of the level before) until 1x1. The result stays on the GPU, where passes can
+ *  read it, and can be read back to the CPU without stalling (see TextureReadback) - so the values are a couple of frames late.
+ *  @note OpenGL 2.1 (pixel buffer objects) or above only
+ */
+class Reduction : public IReduction {
+
+  private:
+
+    ReductionOp op;
+    unsigned int position; // the number of passes of the effect before it (it reduces the colorbuffer they output)
+
+    FragmentProgram*   fp;
+    FramebufferObject* fbo;
+
+    vector<ITexture2DPtr> levels; // the intermediate levels (from the texture pool)
+    ITexture2DPtr result;         // the last level (1x1)
+    int width;                    // the size of the part of the colorbuffer the levels are allocated for
+    int height;
+
+    TextureReadback* readback;    // NULL if the result isn't read back
+
+    void Allocate(int width, int height);
+    void ReleaseLevels();
+
+    friend class PostProcessingEffect;
+    Reduction(ReductionOp op, unsigned int position);
+    ~Reduction();
+
+    void Execute(ITexture2DPtr input, int width, int height);
+
+  public:
+
+    ITexture2DPtr GetResult();
+
+    void EnableReadback(bool enable);
+    bool GetResultValues(float values[4]);
+
+    ReductionOp GetOp();
+};
+
+} // NS PostProcessing
+} // NS OpenEngine
+
+#endif
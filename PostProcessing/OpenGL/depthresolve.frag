@@ -0,0 +1,20 @@
+#version 130
+#extension GL_ARB_texture_multisample : require
+
+// resolves a multisampled depth-buffer to the nearest (DEPTH_RESOLVE_MIN) or farthest (DEPTH_RESOLVE_MAX) depth of the samples
+// of each pixel (used by PostProcessingEffect::SetMultisampling - SAMPLES and DEPTH_RESOLVE_* are injected)
+
+uniform sampler2DMS msDepthBuf;
+
+void main() {
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(msDepthBuf, texel, 0).r;
+    for (int i=1; i<SAMPLES; i++) {
+#ifdef DEPTH_RESOLVE_MAX
+        depth = max(depth, texelFetch(msDepthBuf, texel, i).r);
+#else
+        depth = min(depth, texelFetch(msDepthBuf, texel, i).r);
+#endif
+    }
+    gl_FragDepth = depth;
+}
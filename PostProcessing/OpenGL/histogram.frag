@@ -0,0 +1,9 @@
+#version 130
+
+// adds one texel to a bin of the histogram (used by Histogram - see histogram.vert)
+
+uniform float weight; // 1 / the number of texels counted
+
+void main() {
+    gl_FragColor = vec4(weight);
+}
@@ -0,0 +1,20 @@
+#version 130
+
+// scatters each texel of src to the bin of its luminance (used by Histogram): one point per texel (gl_VertexID), drawn
+// into the numBins x 1 target, where they are added up by additive blending
+
+uniform sampler2D src;
+uniform vec2  srcSize; // the part of src which is counted (in texels)
+uniform float minLog2; // the range of the bins (log2 of the luminance)
+uniform float maxLog2;
+uniform float numBins;
+
+void main() {
+    int width = int(srcSize.x);
+    ivec2 texel = ivec2(gl_VertexID % width, gl_VertexID / width);
+    vec3 color = texelFetch(src, texel, 0).rgb;
+    float luminance = dot(color, vec3(0.2126, 0.7152, 0.0722));
+    float t = clamp((log2(max(luminance, 1.0e-10)) - minLog2) / (maxLog2 - minLog2), 0.0, 1.0);
+    float bin = min(floor(t * numBins), numBins - 1.0);
+    gl_Position = vec4((bin + 0.5) / numBins * 2.0 - 1.0, 0.0, 0.0, 1.0);
+}
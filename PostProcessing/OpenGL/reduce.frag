@@ -0,0 +1,53 @@
+#version 120
+
+// reduces a BLOCK x BLOCK block of texels of src to one texel (used by Reduction - REDUCE_MIN, REDUCE_MAX, REDUCE_AVERAGE or
+// REDUCE_LOG_AVERAGE is injected). Each level is BLOCK times smaller than the one before, down to 1x1.
+// The averages are sums, weighted by 1/(the number of texels reduced) on the first level - so the 1x1 sum is the exact average,
+// also when the size isn't a power of BLOCK. On the first level the luminance is put in alpha.
+
+#define BLOCK 4
+
+uniform sampler2D src;
+uniform vec2  srcTexelSize; // 1 / the size of the src texture
+uniform vec2  srcSize;      // the part of src which is reduced (in texels)
+uniform float first;        // 1 on the first level, otherwise 0
+uniform float last;         // 1 on the last level, otherwise 0
+uniform float weight;       // 1 / the number of texels reduced
+
+vec4 Load(vec2 texel) {
+    vec4 value = texture2D(src, (texel + 0.5) * srcTexelSize);
+    if (first > 0.5) {
+        value.a = dot(value.rgb, vec3(0.2126, 0.7152, 0.0722));
+#ifdef REDUCE_LOG_AVERAGE
+        value = log(max(value, vec4(0.0001))) * weight;
+#endif
+#ifdef REDUCE_AVERAGE
+        value = value * weight;
+#endif
+    }
+    return value;
+}
+
+void main() {
+    vec2 origin = floor(gl_FragCoord.xy) * float(BLOCK);
+    vec4 result = Load(origin); // <- (always inside - the level is only as large as needed)
+    for (int y=0; y<BLOCK; y++) {
+        for (int x=0; x<BLOCK; x++) {
+            vec2 texel = origin + vec2(float(x), float(y));
+            if ((x == 0 && y == 0) || texel.x >= srcSize.x || texel.y >= srcSize.y) continue;
+#ifdef REDUCE_MIN
+            result = min(result, Load(texel));
+#endif
+#ifdef REDUCE_MAX
+            result = max(result, Load(texel));
+#endif
+#if defined(REDUCE_AVERAGE) || defined(REDUCE_LOG_AVERAGE)
+            result += Load(texel);
+#endif
+        }
+    }
+#ifdef REDUCE_LOG_AVERAGE
+    if (last > 0.5) result = exp(result);
+#endif
+    gl_FragColor = result;
+}
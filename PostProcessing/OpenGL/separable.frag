@@ -0,0 +1,42 @@
+#version 130
+
+// convolves src with a symmetric 1D kernel in one direction (generated by PostProcessingEffect::AddSeparableFilterPass).
+// The kernel is injected as constants: CENTER_WEIGHT, TAPS (the number of taps on each side of the center), and OFFSETS and
+// WEIGHTS of the taps (in texels). MERGED_TAPS, MERGED_OFFSETS and MERGED_WEIGHTS are the same kernel with the neighbour taps
+// merged (between two texels, and weighed by the linear filtering of src - only used if src is filtered linearly).
+// DIRECTION is vec2(1.0, 0.0) or vec2(0.0, 1.0)
+
+uniform sampler2D src;
+uniform vec2  srcMin;    // the texture coordinates of the first and last texel of src covered by the screen
+uniform vec2  srcMax;    // (the buffers may be larger than the screen - see PostProcessingEffect::SetResizeBucket)
+uniform float srcLinear; // 1 if src is filtered linearly, otherwise 0
+
+vec4 Tap(vec2 texcoord) {
+    return texture2D(src, clamp(texcoord, srcMin, srcMax));
+}
+
+void main() {
+    vec2 texcoord = gl_TexCoord[0].st;
+    vec2 texel    = DIRECTION / vec2(textureSize(src, 0));
+    vec4 color    = Tap(texcoord) * CENTER_WEIGHT;
+    if (srcLinear > 0.5) {
+#if MERGED_TAPS > 0
+        const float offsets[MERGED_TAPS] = float[MERGED_TAPS](MERGED_OFFSETS);
+        const float weights[MERGED_TAPS] = float[MERGED_TAPS](MERGED_WEIGHTS);
+        for (int i=0; i<MERGED_TAPS; i++) {
+            color += Tap(texcoord + offsets[i] * texel) * weights[i];
+            color += Tap(texcoord - offsets[i] * texel) * weights[i];
+        }
+#endif
+    } else {
+#if TAPS > 0
+        const float offsets[TAPS] = float[TAPS](OFFSETS);
+        const float weights[TAPS] = float[TAPS](WEIGHTS);
+        for (int i=0; i<TAPS; i++) {
+            color += Tap(texcoord + offsets[i] * texel) * weights[i];
+            color += Tap(texcoord - offsets[i] * texel) * weights[i];
+        }
+#endif
+    }
+    gl_FragColor = color;
+}
@@ -0,0 +1,38 @@
+#include "SeparableKernel.h"
+
+#include <math.h>
+
+namespace OpenEngine {
+namespace PostProcessing {
+
+/** Get the weights of a gaussian kernel, cut off at 3 sigma and normalized (so they sum to 1 on both sides)
+ *  @param[in] sigma the standard deviation in texels
+ *  @return the weights (the center first)
+ *  @exception PostProcessingException thrown if sigma isn't positive
+ */
+vector<float> SeparableKernel::Gaussian(float sigma) {
+    if (sigma <= 0) throw PostProcessingException("sigma must be positive");
+    int radius = (int)ceil(3.0f * sigma);
+    vector<float> weights;
+    float sum = 0;
+    for (int i=0; i<=radius; i++) {
+	float weight = exp(-(i*i) / (2.0f * sigma * sigma));
+	weights.push_back(weight);
+	sum += (i == 0) ? weight : 2 * weight;
+    }
+    for (unsigned int i=0; i<weights.size(); i++) weights.at(i) /= sum;
+    return weights;
+}
+
+/** Get the weights of a box kernel (the average of the 2*radius+1 texels)
+ *  @param[in] radius the radius in texels
+ *  @return the weights (the center first)
+ *  @exception PostProcessingException thrown if the radius is negative
+ */
+vector<float> SeparableKernel::Box(int radius) {
+    if (radius < 0) throw PostProcessingException("the radius must not be negative");
+    return vector<float>(radius + 1, 1.0f / (2 * radius + 1));
+}
+
+} // NS PostProcessing
+} // NS OpenEngine
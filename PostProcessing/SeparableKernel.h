@@ -0,0 +1,30 @@
+#ifndef __SEPARABLEKERNEL_H__
+#define __SEPARABLEKERNEL_H__
+
+#include <vector>
+
+#include <PostProcessing/PostProcessingException.h>
+
+namespace OpenEngine {
+namespace PostProcessing {
+
+using namespace std;
+
+// the direction of a separable filter pass (see PostProcessingEffect::AddSeparableFilterPass)
+enum FilterDirection {FILTER_HORIZONTAL, FILTER_VERTICAL};
+
+/** The weights of symmetric 1D kernels (the center first, then the texels 1, 2, ... texels away on both sides), for the
+ *  separable filter passes of PostProcessingEffect and SoftwareEffect - so both backends filter with the same kernels.
+ */
+class SeparableKernel {
+
+  public:
+
+    static vector<float> Gaussian(float sigma); // cut off at 3 sigma, normalized
+    static vector<float> Box(int radius);       // 2*radius+1 equal weights
+};
+
+} // NS PostProcessing
+} // NS OpenEngine
+
+#endif
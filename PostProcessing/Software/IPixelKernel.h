@@ -0,0 +1,35 @@
+#ifndef __IPIXELKERNEL_H__
+#define __IPIXELKERNEL_H__
+
+#include <boost/shared_ptr.hpp>
+
+namespace OpenEngine {
+namespace PostProcessing {
+
+class SoftwarePass;
+
+/** A per-pixel kernel executed by a SoftwarePass - the software counterpart of a fragment program.
+ *  Run is called for spans of a row (the rows are split between threads, so it must only write the pixels it is given,
+ *  and not change state shared between calls). It gets its inputs from the pass by name (GetInput, GetFloat, ... - look
+ *  them up once per call, not per pixel), and writes its outputs to the rows of GetOutputRow (gl_FragData[i]) and
+ *  GetDepthOutputRow (gl_FragDepth). Processing a span at a time, over contiguous floats, lets the compiler vectorize it.
+ */
+class IPixelKernel {
+
+  public:
+
+    virtual ~IPixelKernel() {}
+
+    /* compute the pixels x0 to x1-1 of row y */
+    virtual void Run(SoftwarePass& pass, int y, int x0, int x1) = 0;
+};
+
+/**
+ * IPixelKernel smart pointer.
+ */
+typedef boost::shared_ptr<IPixelKernel> IPixelKernelPtr;
+
+} // NS PostProcessing
+} // NS OpenEngine
+
+#endif
@@ -0,0 +1,69 @@
+#include "SeparableFilterKernel.h"
+#include "SoftwarePass.h"
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+namespace OpenEngine {
+namespace PostProcessing {
+
+SeparableFilterKernel::SeparableFilterKernel(vector<float> weights, FilterDirection direction) {
+    if (weights.empty()) throw PostProcessingException("the kernel must have at least one weight");
+    this->weights   = weights;
+    this->direction = direction;
+}
+
+void SeparableFilterKernel::Run(SoftwarePass& pass, int y, int x0, int x1) {
+    SoftwareImagePtr src = pass.GetInput("src");
+    int n   = src->GetNumComponents();
+    int r   = weights.size() - 1;
+    int w   = src->GetWidth();
+    float* out = pass.GetOutputRow(0, y) + x0 * n;
+
+    if (direction == FILTER_HORIZONTAL) {
+	float* row = src->GetRow(y);
+	for (int x=x0; x<x1; x++, out+=n) {
+	    // (the texels near the edges are clamped - the rest are read directly)
+	    bool inside = (x - r >= 0 && x + r < w);
+#ifdef __SSE__
+	    if (n == 4) {
+		__m128 sum = _mm_mul_ps(_mm_set1_ps(weights[0]), _mm_loadu_ps(row + x*4));
+		for (int i=1; i<=r; i++) {
+		    const float* left  = inside ? row + (x-i)*4 : src->GetTexel(x-i, y);
+		    const float* right = inside ? row + (x+i)*4 : src->GetTexel(x+i, y);
+		    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[i]), _mm_add_ps(_mm_loadu_ps(left), _mm_loadu_ps(right))));
+		}
+		_mm_storeu_ps(out, sum);
+		continue;
+	    }
+#endif
+	    for (int c=0; c<n; c++) out[c] = weights[0] * row[x*n + c];
+	    for (int i=1; i<=r; i++) {
+		const float* left  = inside ? row + (x-i)*n : src->GetTexel(x-i, y);
+		const float* right = inside ? row + (x+i)*n : src->GetTexel(x+i, y);
+		for (int c=0; c<n; c++) out[c] += weights[i] * (left[c] + right[c]);
+	    }
+	}
+    } else {
+	// vertical: whole rows are weighted and summed, which runs along contiguous floats
+	int count = (x1 - x0) * n;
+	float* center = src->GetRow(y) + x0 * n;
+	for (int j=0; j<count; j++) out[j] = weights[0] * center[j];
+	for (int i=1; i<=r; i++) {
+	    const float* below = src->GetRow(y-i) + x0 * n; // (GetRow clamps to the edge)
+	    const float* above = src->GetRow(y+i) + x0 * n;
+	    float weight = weights[i];
+	    int j = 0;
+#ifdef __SSE__
+	    __m128 w4 = _mm_set1_ps(weight);
+	    for (; j+4<=count; j+=4)
+		_mm_storeu_ps(out + j, _mm_add_ps(_mm_loadu_ps(out + j), _mm_mul_ps(w4, _mm_add_ps(_mm_loadu_ps(below + j), _mm_loadu_ps(above + j)))));
+#endif
+	    for (; j<count; j++) out[j] += weight * (below[j] + above[j]);
+	}
+    }
+}
+
+} // NS PostProcessing
+} // NS OpenEngine
@@ -0,0 +1,36 @@
+#ifndef __SEPARABLEFILTERKERNEL_H__
+#define __SEPARABLEFILTERKERNEL_H__
+
+#include <vector>
+
+#include <PostProcessing/SeparableKernel.h>
+#include <PostProcessing/Software/IPixelKernel.h>
+
+namespace OpenEngine {
+namespace PostProcessing {
+
+using namespace std;
+
+/** Kernel of the separable filter passes of SoftwareEffect - the software counterpart of separable.frag. Convolves the image
+ *  bound to "src" with a symmetric 1D kernel (see SeparableKernel) in one direction, clamping to the edge. Unlike
+ *  separable.frag it reads each texel of the kernel (no merged linear taps), so it is the exact convolution.
+ *  4-component images are filtered a texel at a time with SSE when available.
+ */
+class SeparableFilterKernel : public IPixelKernel {
+
+  private:
+
+    vector<float> weights;
+    FilterDirection direction;
+
+  public:
+
+    SeparableFilterKernel(vector<float> weights, FilterDirection direction);
+
+    void Run(SoftwarePass& pass, int y, int x0, int x1);
+};
+
+} // NS PostProcessing
+} // NS OpenEngine
+
+#endif
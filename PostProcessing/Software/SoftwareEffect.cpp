@@ -0,0 +1,222 @@
+#include "SoftwareEffect.h"
+#include "SeparableFilterKernel.h"
+
+namespace OpenEngine {
+namespace PostProcessing {
+
+map<string, IPixelKernelPtr> SoftwareEffect::kernels;
+
+SoftwareEffect::SoftwareEffect() {
+    enabled    = true;
+    satup      = false;
+    numThreads = 0;
+    width      = 0;
+    height     = 0;
+}
+
+SoftwareEffect::~SoftwareEffect() {
+    for (unsigned int i=0; i<passes.size(); i++) delete passes.at(i);
+}
+
+/** Register a kernel for AddPass(string) - usually under the name of the fragment program it mirrors, so the Setup of a
+ *  SoftwareEffect can be written like the Setup of the PostProcessingEffect it is checked against.
+ *  (a kernel registered under a name already used replaces the old one for passes added later)
+ */
+void SoftwareEffect::RegisterKernel(string name, IPixelKernelPtr kernel) {
+    if (kernel.get() == NULL) throw PostProcessingException("kernel was NULL");
+    kernels[name] = kernel;
+}
+
+void SoftwareEffect::CallSetup() {
+    satup = true;
+    Setup();
+}
+
+/* resize the buffers and the userbuffers of the passes */
+void SoftwareEffect::Resize(int width, int height) {
+    this->width  = width;
+    this->height = height;
+    if (colorTex1.get() == NULL) {
+	colorTex1 = SoftwareImagePtr(new SoftwareImage(width, height, 4));
+	colorTex2 = SoftwareImagePtr(new SoftwareImage(width, height, 4));
+	depthTex1 = SoftwareImagePtr(new SoftwareImage(width, height, 1));
+	depthTex2 = SoftwareImagePtr(new SoftwareImage(width, height, 1));
+    } else {
+	colorTex1->Resize(width, height);
+	colorTex2->Resize(width, height);
+	depthTex1->Resize(width, height);
+	depthTex2->Resize(width, height);
+    }
+    for (unsigned int i=0; i<passes.size(); i++) passes.at(i)->Resize(width, height);
+}
+
+/** Add a pass running the kernel registered under the given name (see RegisterKernel)
+ *  @param[in] kernelName the name of the kernel
+ *  @return the pass
+ *  @exception PostProcessingException thrown if called before setup, or if no kernel is registered under the name
+ */
+SoftwarePass* SoftwareEffect::AddPass(string kernelName) {
+    map<string, IPixelKernelPtr>::iterator it = kernels.find(kernelName);
+    if (it == kernels.end()) throw PostProcessingException("no kernel registered as " + kernelName);
+    return AddPass(it->second);
+}
+
+/** Add a pass running the given kernel
+ *  @param[in] kernel the kernel
+ *  @return the pass
+ *  @exception PostProcessingException thrown if called before setup
+ */
+SoftwarePass* SoftwareEffect::AddPass(IPixelKernelPtr kernel) {
+    if (!satup) throw PostProcessingException("method AddPass called before setup");
+    SoftwarePass* pass = new SoftwarePass(kernel, width > 0 ? width : 1, height > 0 ? height : 1, passes.size(), this);
+    passes.push_back(pass);
+    return pass;
+}
+
+/** Add a pass convolving the colorbuffer with a symmetric 1D kernel - the counterpart of
+ *  PostProcessingEffect::AddSeparableFilterPass (the weights are the same, see SeparableKernel)
+ *  @param[in] weights the weights of the center texel and the texels 1, 2, ... texels away on each side
+ *  @param[in] direction the direction of the filter
+ *  @return the pass
+ */
+SoftwarePass* SoftwareEffect::AddSeparableFilterPass(vector<float> weights, FilterDirection direction) {
+    SoftwarePass* pass = AddPass(IPixelKernelPtr(new SeparableFilterKernel(weights, direction)));
+    pass->BindColorBuffer("src");
+    pass->EnableColorBufferOutput();
+    return pass;
+}
+
+SoftwarePass* SoftwareEffect::AddGaussianBlurPass(float sigma, FilterDirection direction) {
+    return AddSeparableFilterPass(SeparableKernel::Gaussian(sigma), direction);
+}
+
+SoftwarePass* SoftwareEffect::AddBoxBlurPass(int radius, FilterDirection direction) {
+    return AddSeparableFilterPass(SeparableKernel::Box(radius), direction);
+}
+
+/** Execute this effect and the effects chained to it on a scene.
+ *  The scene isn't modified - the result is read with GetFinalColorBuffer and GetFinalDepthBuffer.
+ *  @param[in] sceneColor the color of the scene (4 components)
+ *  @param[in] sceneDepth the depth of the scene (1 component - if NULL the depthbuffer is cleared to 0)
+ *  @param[in] deltaTime the time since the last frame (passed to PerFrame)
+ *  @exception PostProcessingException thrown if the scene has the wrong number of components, or if a pass fails
+ */
+void SoftwareEffect::Execute(SoftwareImagePtr sceneColor, SoftwareImagePtr sceneDepth, const float deltaTime) {
+    if (sceneColor.get() == NULL) throw PostProcessingException("sceneColor was NULL");
+    if (sceneColor->GetNumComponents() != 4) throw PostProcessingException("sceneColor must have 4 components");
+    if (sceneDepth.get() != NULL && sceneDepth->GetNumComponents() != 1) throw PostProcessingException("sceneDepth must have 1 component");
+    if (sceneDepth.get() != NULL && (sceneDepth->GetWidth() != sceneColor->GetWidth() || sceneDepth->GetHeight() != sceneColor->GetHeight()))
+	throw PostProcessingException("sceneColor and sceneDepth must have the same size");
+
+    if (width != sceneColor->GetWidth() || height != sceneColor->GetHeight() || colorTex1.get() == NULL)
+	Resize(sceneColor->GetWidth(), sceneColor->GetHeight());
+    sceneColor->Clone(colorTex1);
+    if (sceneDepth.get() != NULL) sceneDepth->Clone(depthTex1);
+    else                          depthTex1->Clear();
+
+    SoftwareImagePtr colorTex = colorTex1;
+    SoftwareImagePtr depthTex = depthTex1;
+    Run(colorTex, depthTex, deltaTime);
+}
+
+/* Execute the passes of this effect on colorTex and depthTex, then the chained effects - as PostProcessingEffect::Schedule,
+   colorTex and depthTex are set to the final buffers (a chained effect ping-pongs between the buffer it gets and its own) */
+void SoftwareEffect::Run(SoftwareImagePtr& colorTex, SoftwareImagePtr& depthTex, const float deltaTime) {
+    if (!satup) CallSetup();
+    if (width != colorTex->GetWidth() || height != colorTex->GetHeight() || colorTex1.get() == NULL)
+	Resize(colorTex->GetWidth(), colorTex->GetHeight());
+
+    SoftwareImagePtr inputColorTex  = colorTex;
+    SoftwareImagePtr outputColorTex = colorTex2;
+    SoftwareImagePtr otherColorTex  = colorTex;
+    SoftwareImagePtr inputDepthTex  = depthTex;
+    SoftwareImagePtr outputDepthTex = depthTex2;
+    SoftwareImagePtr otherDepthTex  = depthTex;
+
+    if (enabled) for (unsigned int i=0; i<passes.size(); i++) {
+	SoftwarePass* pass = passes.at(i);
+	pass->Execute(inputColorTex, outputColorTex, inputDepthTex, outputDepthTex, numThreads);
+
+	// swap input/output AFTER executing the pass, and only the buffers it outputs to
+	if (pass->IsColorBufferOutput()) {
+	    inputColorTex  = outputColorTex;
+	    outputColorTex = (outputColorTex == colorTex2) ? otherColorTex : colorTex2;
+	}
+	if (pass->IsDepthBufferOutput()) {
+	    inputDepthTex  = outputDepthTex;
+	    outputDepthTex = (outputDepthTex == depthTex2) ? otherDepthTex : depthTex2;
+	}
+    }
+
+    for (unsigned int i=0; i<chainedEffects.size(); i++)
+	chainedEffects.at(i)->Run(inputColorTex, inputDepthTex, deltaTime);
+
+    finalColorTex = inputColorTex;
+    finalDepthTex = inputDepthTex;
+    colorTex = inputColorTex;
+    depthTex = inputDepthTex;
+
+    PerFrame(deltaTime);
+}
+
+/** returns the final colorbuffer of this effect of the last Execute (not a copy - as with PostProcessingEffect, it may be
+ *  overwritten by effects executed after this one)
+ */
+SoftwareImagePtr SoftwareEffect::GetFinalColorBuffer() {
+    return finalColorTex;
+}
+
+SoftwareImagePtr SoftwareEffect::GetFinalDepthBuffer() {
+    return finalDepthTex;
+}
+
+/** Add a SoftwareEffect to be executed after this SoftwareEffect (see PostProcessingEffect::Add)
+ *  @param[in] effect the effect to be added to this one
+ *  @exception PostProcessingException thrown if effect is this effect, or this effect is chained to effect (directly or indirectly)
+ */
+void SoftwareEffect::Add(SoftwareEffect* effect) {
+    if (effect->IsChained(this)) throw PostProcessingException("chain inf-loop: the effect is this effect, or this effect is chained to it");
+    chainedEffects.push_back(effect);
+}
+
+/** Remove all occurances of the given SoftwareEffect from this SoftwareEffect
+ */
+void SoftwareEffect::Remove(SoftwareEffect* effect) {
+    for (vector<SoftwareEffect*>::iterator it = chainedEffects.begin(); it != chainedEffects.end();) {
+	if (*it == effect) it = chainedEffects.erase(it);
+	else               it++;
+    }
+}
+
+void SoftwareEffect::RemoveAll() {
+    chainedEffects.clear();
+}
+
+/* whether effect is this effect or chained to it (directly or indirectly) */
+bool SoftwareEffect::IsChained(SoftwareEffect* effect) {
+    if (effect == this) return true;
+    for (unsigned int i=0; i<chainedEffects.size(); i++)
+	if (chainedEffects.at(i)->IsChained(effect)) return true;
+    return false;
+}
+
+/** Enable or disable this effect (if disabled it will just output its input unmodified)
+ */
+void SoftwareEffect::Enable(bool enable) {
+    enabled = enable;
+}
+
+bool SoftwareEffect::IsEnabled() {
+    return enabled;
+}
+
+/** Set the max number of threads the rows of the passes are split between (1 = run on the calling thread only)
+ *  @param[in] numThreads the number of threads (0 = one per core)
+ */
+void SoftwareEffect::SetNumThreads(int numThreads) {
+    if (numThreads < 0) throw PostProcessingException("the number of threads can't be negative");
+    this->numThreads = numThreads;
+}
+
+} // NS PostProcessing
+} // NS OpenEngine
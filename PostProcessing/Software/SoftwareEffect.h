@@ -0,0 +1,89 @@
+#ifndef __SOFTWAREEFFECT_H__
+#define __SOFTWAREEFFECT_H__
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include <PostProcessing/PostProcessingException.h>
+#include <PostProcessing/SeparableKernel.h>
+#include <PostProcessing/Software/IPixelKernel.h>
+#include <PostProcessing/Software/SoftwareImage.h>
+#include <PostProcessing/Software/SoftwarePass.h>
+
+namespace OpenEngine {
+namespace PostProcessing {
+
+using namespace std;
+
+/** A CPU reference executor for effect chains - the software counterpart of PostProcessingEffect, for checking the output of
+ *  the GPU effects (f.e. in automated image comparisons), and for running the effects where there is no graphics card.
+ *  It is used like PostProcessingEffect: subclass it, add passes in Setup (AddPass with the name of a registered kernel, see
+ *  RegisterKernel, where PostProcessingEffect takes the fragment program of the same name), chain effects with Add, and call
+ *  Execute each frame with the scene instead of rendering to a viewport. The passes ping-pong between the buffers and the
+ *  chained effects are executed in the same order as PostProcessingEffect. The rows of each pass are split between threads.
+ */
+class SoftwareEffect {
+
+  private:
+
+    static map<string, IPixelKernelPtr> kernels; // the registered kernels (see RegisterKernel)
+
+    vector<SoftwarePass*> passes;
+    vector<SoftwareEffect*> chainedEffects;
+
+    bool enabled;
+    bool satup;
+    int numThreads;
+
+    int width;  // the size of the buffers (the size of the scene of the last Execute)
+    int height;
+
+    // the buffers the passes ping-pong between
+    SoftwareImagePtr colorTex1, colorTex2;
+    SoftwareImagePtr depthTex1, depthTex2;
+    SoftwareImagePtr finalColorTex, finalDepthTex;
+
+    void CallSetup();
+    void Resize(int width, int height);
+    void Run(SoftwareImagePtr& colorTex, SoftwareImagePtr& depthTex, const float deltaTime);
+    bool IsChained(SoftwareEffect* effect);
+
+  protected:
+
+    SoftwarePass* AddPass(string kernelName);
+    SoftwarePass* AddPass(IPixelKernelPtr kernel);
+    SoftwarePass* AddSeparableFilterPass(vector<float> weights, FilterDirection direction);
+    SoftwarePass* AddGaussianBlurPass(float sigma, FilterDirection direction);
+    SoftwarePass* AddBoxBlurPass(int radius, FilterDirection direction);
+
+    virtual void Setup() = 0;
+    virtual void PerFrame(const float /*deltaTime*/) {}
+
+  public:
+
+    SoftwareEffect();
+    virtual ~SoftwareEffect();
+
+    /* the kernels used by AddPass(string) (usually named as the fragment program it mirrors) */
+    static void RegisterKernel(string name, IPixelKernelPtr kernel);
+
+    void Execute(SoftwareImagePtr sceneColor, SoftwareImagePtr sceneDepth = SoftwareImagePtr(), const float deltaTime = 0);
+
+    SoftwareImagePtr GetFinalColorBuffer();
+    SoftwareImagePtr GetFinalDepthBuffer();
+
+    void Add(SoftwareEffect* effect);
+    void Remove(SoftwareEffect* effect);
+    void RemoveAll();
+
+    void Enable(bool enable);
+    bool IsEnabled();
+
+    void SetNumThreads(int numThreads); // 0 = one per core
+};
+
+} // NS PostProcessing
+} // NS OpenEngine
+
+#endif
@@ -0,0 +1,98 @@
+#include "SoftwareImage.h"
+
+#include <math.h>
+#include <string.h>
+
+namespace OpenEngine {
+namespace PostProcessing {
+
+/** Create a (cleared) image
+ *  @param[in] width the width in texels
+ *  @param[in] height the height in texels
+ *  @param[in] numComponents the number of floats per texel (1-4)
+ */
+SoftwareImage::SoftwareImage(int width, int height, int numComponents) {
+    if (width < 1 || height < 1) throw PostProcessingException("illegal image size");
+    if (numComponents < 1 || numComponents > 4) throw PostProcessingException("an image must have 1 to 4 components");
+    this->width         = width;
+    this->height        = height;
+    this->numComponents = numComponents;
+    texels.assign(width * height * numComponents, 0.0f);
+}
+
+int SoftwareImage::GetWidth() {
+    return width;
+}
+
+int SoftwareImage::GetHeight() {
+    return height;
+}
+
+int SoftwareImage::GetNumComponents() {
+    return numComponents;
+}
+
+/** Resize the image (nothing is done if the size is unchanged - otherwise the content is cleared)
+ */
+void SoftwareImage::Resize(int width, int height) {
+    if (width < 1 || height < 1) throw PostProcessingException("illegal image size");
+    if (width == this->width && height == this->height) return;
+    this->width  = width;
+    this->height = height;
+    texels.assign(width * height * numComponents, 0.0f);
+}
+
+void SoftwareImage::Clear() {
+    texels.assign(texels.size(), 0.0f);
+}
+
+float* SoftwareImage::GetData() {
+    return &texels[0];
+}
+
+float* SoftwareImage::GetRow(int y) {
+    if (y < 0) y = 0;
+    if (y >= height) y = height - 1;
+    return &texels[y * width * numComponents];
+}
+
+float* SoftwareImage::GetTexel(int x, int y) {
+    if (x < 0) x = 0;
+    if (x >= width) x = width - 1;
+    return GetRow(y) + x * numComponents;
+}
+
+/** Get the bilinearly filtered value at the given texture coordinates, as texture2D with TEX_LINEAR and TEX_CLAMP_TO_EDGE
+ *  @param[in] s the texture coordinate (0 = the left edge, 1 = the right edge of the image)
+ *  @param[in] t the texture coordinate (0 = the bottom edge, 1 = the top edge)
+ *  @param[out] result numComponents floats
+ */
+void SoftwareImage::Sample(float s, float t, float* result) {
+    float x = s * width  - 0.5f;
+    float y = t * height - 0.5f;
+    int x0 = (int)floor(x);
+    int y0 = (int)floor(y);
+    float fx = x - x0;
+    float fy = y - y0;
+    float* t00 = GetTexel(x0,   y0);
+    float* t10 = GetTexel(x0+1, y0);
+    float* t01 = GetTexel(x0,   y0+1);
+    float* t11 = GetTexel(x0+1, y0+1);
+    for (int i=0; i<numComponents; i++) {
+	float bottom = t00[i] + (t10[i] - t00[i]) * fx;
+	float top    = t01[i] + (t11[i] - t01[i]) * fx;
+	result[i] = bottom + (top - bottom) * fy;
+    }
+}
+
+/** Copy this image to dest (which is resized to the size of this image)
+ *  @exception PostProcessingException thrown if dest has another number of components
+ */
+void SoftwareImage::Clone(SoftwareImagePtr dest) {
+    if (dest->numComponents != numComponents) throw PostProcessingException("can't clone an image to an image with another number of components");
+    dest->Resize(width, height);
+    memcpy(dest->GetData(), GetData(), texels.size() * sizeof(float));
+}
+
+} // NS PostProcessing
+} // NS OpenEngine
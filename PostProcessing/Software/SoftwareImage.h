@@ -0,0 +1,57 @@
+#ifndef __SOFTWAREIMAGE_H__
+#define __SOFTWAREIMAGE_H__
+
+#include <vector>
+
+#include <PostProcessing/PostProcessingException.h>
+#include <boost/shared_ptr.hpp>
+
+namespace OpenEngine {
+namespace PostProcessing {
+
+using namespace std;
+
+class SoftwareImage;
+
+/**
+ * SoftwareImage smart pointer.
+ */
+typedef boost::shared_ptr<SoftwareImage> SoftwareImagePtr;
+
+/** A float image in main memory - the software counterpart of the color-, depth- and userbuffer textures (see SoftwareEffect).
+ *  The texels are stored row by row, bottom row first, with numComponents floats per texel (the layout of
+ *  ITexture2D::GetFloatData, so images can be compared to the textures of PostProcessingEffect). Reads outside the image
+ *  are clamped to the edge, like TEX_CLAMP_TO_EDGE.
+ */
+class SoftwareImage {
+
+  private:
+
+    int width;
+    int height;
+    int numComponents;
+    vector<float> texels;
+
+  public:
+
+    SoftwareImage(int width, int height, int numComponents = 4);
+
+    int GetWidth();
+    int GetHeight();
+    int GetNumComponents();
+
+    void Resize(int width, int height); // <- the content is cleared (like Texture2D::Resize, which doesn't keep it)
+    void Clear();
+
+    float* GetData();                   // width*height*numComponents floats
+    float* GetRow(int y);               // the texels of a row (y is clamped)
+    float* GetTexel(int x, int y);      // the components of a texel (x and y are clamped)
+    void   Sample(float s, float t, float* result); // bilinear filtering (TEX_LINEAR) at texture coordinates s,t
+
+    void Clone(SoftwareImagePtr dest);  // copy the size and content to dest
+};
+
+} // NS PostProcessing
+} // NS OpenEngine
+
+#endif
@@ -0,0 +1,204 @@
+#include "SoftwarePass.h"
+#include "SoftwareEffect.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace OpenEngine {
+namespace PostProcessing {
+
+// the rows each thread is given at a time (small enough to balance the threads, large enough to keep each one in its own cache lines)
+static const int TILE_ROWS = 16;
+
+SoftwarePass::SoftwarePass(IPixelKernelPtr kernel, int width, int height, int passID, SoftwareEffect* effect) {
+    if (kernel.get() == NULL) throw PostProcessingException("kernel was NULL");
+    this->kernel = kernel;
+    this->width  = width;
+    this->height = height;
+    this->passID = passID;
+    this->effect = effect;
+    inputColorBufferParameterName = "";
+    inputDepthBufferParameterName = "";
+    outputsToColorBuffer = false;
+    outputsToDepthBuffer = false;
+    userBuffers.resize(MAX_ATTACHMENTS);
+}
+
+/* resize the userbuffers of this pass (must not be called by user) */
+void SoftwarePass::Resize(int width, int height) {
+    this->width  = width;
+    this->height = height;
+    for (unsigned int i=0; i<userBuffers.size(); i++)
+	if (userBuffers.at(i).get() != NULL) userBuffers.at(i)->Resize(width, height);
+}
+
+/* Execute the kernel on all pixels (must not be called by user). The rows are split into tiles, which are run in parallel
+   (with OpenMP - without it, or with numThreads = 1, the tiles are run one by one).
+   @param[in] numThreads the max number of threads (0 = as many as there are cores) */
+void SoftwarePass::Execute(SoftwareImagePtr colorInput, SoftwareImagePtr colorOutput, SoftwareImagePtr depthInput, SoftwareImagePtr depthOutput, int numThreads) {
+    // collect the inputs (the userbuffers are looked up now, as the userbuffer of another pass may be attached after binding it)
+    inputs = textures;
+    if (inputColorBufferParameterName != "") inputs[inputColorBufferParameterName] = colorInput;
+    if (inputDepthBufferParameterName != "") inputs[inputDepthBufferParameterName] = depthInput;
+    this->colorOutput = outputsToColorBuffer ? colorOutput : SoftwareImagePtr();
+    this->depthOutput = outputsToDepthBuffer ? depthOutput : SoftwareImagePtr();
+
+    // (exceptions can't leave a parallel region - the first is thrown again afterwards)
+    int numTiles = (height + TILE_ROWS - 1) / TILE_ROWS;
+    bool failed = false;
+    string message;
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic) num_threads(numThreads > 0 ? numThreads : omp_get_num_procs())
+#else
+    (void)numThreads; // <- (the tiles are run one by one)
+#endif
+    for (int tile=0; tile<numTiles; tile++) {
+	int y1 = (tile + 1) * TILE_ROWS;
+	if (y1 > height) y1 = height;
+	try {
+	    for (int y=tile*TILE_ROWS; y<y1; y++) kernel->Run(*this, y, 0, width);
+	} catch (std::exception& e) {
+#ifdef _OPENMP
+	    #pragma omp critical
+#endif
+	    if (!failed) {
+		failed  = true;
+		message = e.what();
+	    }
+	}
+    }
+
+    inputs.clear();
+    this->colorOutput.reset();
+    this->depthOutput.reset();
+    if (failed) throw PostProcessingException("pass " + message);
+}
+
+/** Bind a value to an int input-parameter of the kernel (see GetInt)
+ */
+void SoftwarePass::BindInt(string parameterName, vector<int> intvector) {
+    ints[parameterName] = intvector;
+}
+
+/** Bind a value to a float input-parameter of the kernel (see GetFloat)
+ */
+void SoftwarePass::BindFloat(string parameterName, vector<float> floatvector) {
+    floats[parameterName] = floatvector;
+}
+
+/** Bind an image to an input-parameter of the kernel (see GetInput)
+ */
+void SoftwarePass::BindTexture(string parameterName, SoftwareImagePtr image) {
+    if (image.get() == NULL) throw PostProcessingException("image was NULL");
+    textures[parameterName] = image;
+}
+
+/** Bind the colorbuffer (the output of the previous passes) to an input-parameter of the kernel
+ */
+void SoftwarePass::BindColorBuffer(string parameterName) {
+    inputColorBufferParameterName = parameterName;
+}
+
+/** Bind the depthbuffer (the output of the previous passes) to an input-parameter of the kernel
+ */
+void SoftwarePass::BindDepthBuffer(string parameterName) {
+    inputDepthBufferParameterName = parameterName;
+}
+
+/** Bind the userbuffer of an earlier pass of the same effect to an input-parameter of the kernel
+ *  @exception PostProcessingException thrown if the pass isn't an earlier pass of the same effect, or has no userbuffer there
+ */
+void SoftwarePass::BindUserBuffer(string parameterName, SoftwarePass* outputPass, int outputAttachmentPoint) {
+    if (this->effect != outputPass->effect) throw PostProcessingException("can only bind userbuffers from a pass belonging to the same SoftwareEffect as this pass");
+    if (this->passID <= outputPass->passID) throw PostProcessingException("can only bind userbuffers from passes executed earlier than this pass!");
+    if (!outputPass->IsUserBufferOutput(outputAttachmentPoint)) throw PostProcessingException("there were no userbuffer for the outputpass at the attachmentpoint");
+    BindTexture(parameterName, outputPass->GetUserBufferRef(outputAttachmentPoint));
+}
+
+void SoftwarePass::EnableColorBufferOutput() {
+    if (userBuffers.at(0).get() != NULL) throw PostProcessingException("can't attach both colorbuffer and userbuffer at attachment-point 0");
+    outputsToColorBuffer = true;
+}
+
+void SoftwarePass::EnableDepthBufferOutput() {
+    outputsToDepthBuffer = true;
+}
+
+/** Attach a userbuffer at the attachmentPoint - an image of the size of the buffers, which the kernel writes to with GetOutputRow
+ *  @param[in] attachmentPoint the attachment point (0 can only be used if the pass doesn't output to the colorbuffer)
+ *  @param[in] numComponents the number of floats per texel
+ */
+void SoftwarePass::AttachUserBuffer(int attachmentPoint, int numComponents) {
+    if (attachmentPoint < 0 || attachmentPoint >= MAX_ATTACHMENTS) throw PostProcessingException("attachmentpoint out of range");
+    if (attachmentPoint==0 && outputsToColorBuffer) throw PostProcessingException("can't attach both colorbuffer and userbuffer at attachment-point 0");
+    if (userBuffers.at(attachmentPoint).get() != NULL) throw PostProcessingException("there were already a output-userbuffer for this pass at this attachmentpoint");
+    userBuffers.at(attachmentPoint) = SoftwareImagePtr(new SoftwareImage(width, height, numComponents));
+}
+
+/** returns the userbuffer at the given attachment point (not a copy)
+ */
+SoftwareImagePtr SoftwarePass::GetUserBufferRef(int attachmentPoint) {
+    if (!IsUserBufferOutput(attachmentPoint)) throw PostProcessingException("there were no userbuffer for the pass at the attachmentpoint");
+    return userBuffers.at(attachmentPoint);
+}
+
+bool SoftwarePass::IsColorBufferOutput() {
+    return outputsToColorBuffer;
+}
+
+bool SoftwarePass::IsDepthBufferOutput() {
+    return outputsToDepthBuffer;
+}
+
+bool SoftwarePass::IsUserBufferOutput(int attachmentPoint) {
+    if (attachmentPoint < 0 || attachmentPoint >= MAX_ATTACHMENTS) return false;
+    return userBuffers.at(attachmentPoint).get() != NULL;
+}
+
+/** Get an image input of the kernel (only while the pass is executed)
+ *  @exception PostProcessingException thrown if nothing is bound to the parameter
+ */
+SoftwareImagePtr SoftwarePass::GetInput(string parameterName) {
+    map<string, SoftwareImagePtr>::iterator it = inputs.find(parameterName);
+    if (it == inputs.end()) throw PostProcessingException("no image bound to " + parameterName);
+    return it->second;
+}
+
+const vector<float>& SoftwarePass::GetFloat(string parameterName) {
+    map<string, vector<float> >::iterator it = floats.find(parameterName);
+    if (it == floats.end()) throw PostProcessingException("no float bound to " + parameterName);
+    return it->second;
+}
+
+const vector<int>& SoftwarePass::GetInt(string parameterName) {
+    map<string, vector<int> >::iterator it = ints.find(parameterName);
+    if (it == ints.end()) throw PostProcessingException("no int bound to " + parameterName);
+    return it->second;
+}
+
+/** Get a row of an output of the kernel (only while the pass is executed) - the colorbuffer at attachment point 0 if the
+ *  pass outputs to it, otherwise the userbuffers
+ *  @exception PostProcessingException thrown if there is no output at the attachment point
+ */
+float* SoftwarePass::GetOutputRow(int attachmentPoint, int y) {
+    if (attachmentPoint == 0 && colorOutput.get() != NULL) return colorOutput->GetRow(y);
+    if (!IsUserBufferOutput(attachmentPoint)) throw PostProcessingException("no output at the attachmentpoint");
+    return userBuffers.at(attachmentPoint)->GetRow(y);
+}
+
+float* SoftwarePass::GetDepthOutputRow(int y) {
+    if (depthOutput.get() == NULL) throw PostProcessingException("the pass doesn't output to the depthbuffer");
+    return depthOutput->GetRow(y);
+}
+
+int SoftwarePass::GetWidth() {
+    return width;
+}
+
+int SoftwarePass::GetHeight() {
+    return height;
+}
+
+} // NS PostProcessing
+} // NS OpenEngine
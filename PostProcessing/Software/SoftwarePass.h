@@ -0,0 +1,92 @@
+#ifndef __SOFTWAREPASS_H__
+#define __SOFTWAREPASS_H__
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include <PostProcessing/PostProcessingException.h>
+#include <PostProcessing/Software/IPixelKernel.h>
+#include <PostProcessing/Software/SoftwareImage.h>
+
+namespace OpenEngine {
+namespace PostProcessing {
+
+using namespace std;
+
+class SoftwareEffect;
+
+/** Objects of this class represents a pass of a SoftwareEffect - the software counterpart of PostProcessingPass, with
+ *  the same binding and output methods, and a per-pixel kernel (see IPixelKernel) instead of a fragment program.
+ */
+class SoftwarePass {
+
+  private:
+
+    IPixelKernelPtr kernel;
+    int passID;             // used for error-checking in BindUserBuffer()
+    SoftwareEffect* effect; // used for error-checking in BindUserBuffer()
+
+    int width;  // the size of the buffers
+    int height;
+
+    // the inputs bound to the kernel
+    map<string, vector<float> >  floats;
+    map<string, vector<int> >    ints;
+    map<string, SoftwareImagePtr> textures;
+    string inputColorBufferParameterName; // ("" if not bound)
+    string inputDepthBufferParameterName;
+
+    bool outputsToColorBuffer;
+    bool outputsToDepthBuffer;
+    vector<SoftwareImagePtr> userBuffers; // for each attachment point (NULL if none)
+
+    // the images of the current execution (see Execute)
+    map<string, SoftwareImagePtr> inputs;
+    SoftwareImagePtr colorOutput;
+    SoftwareImagePtr depthOutput;
+
+    friend class SoftwareEffect;
+    SoftwarePass(IPixelKernelPtr kernel, int width, int height, int passID, SoftwareEffect* effect);
+
+    void Resize(int width, int height);
+    void Execute(SoftwareImagePtr colorInput, SoftwareImagePtr colorOutput, SoftwareImagePtr depthInput, SoftwareImagePtr depthOutput, int numThreads);
+
+  public:
+
+    static const int MAX_ATTACHMENTS = 8; // (the number of draw buffers of most graphics cards)
+
+    /* assign kernel input parameters */
+    void BindInt        (string parameterName, vector<int> intvector);
+    void BindFloat      (string parameterName, vector<float> floatvector);
+    void BindTexture    (string parameterName, SoftwareImagePtr image);
+    void BindColorBuffer(string parameterName);
+    void BindDepthBuffer(string parameterName);
+    void BindUserBuffer (string parameterName, SoftwarePass* outputPass, int outputAttachmentPoint);
+
+    /* assign which buffers the kernel outputs to (must enable for all buffers it writes to) */
+    void EnableColorBufferOutput();
+    void EnableDepthBufferOutput();
+
+    /* attach userbuffer at the attachmentPoint */
+    void AttachUserBuffer(int attachmentPoint, int numComponents = 4);
+    SoftwareImagePtr GetUserBufferRef(int attachmentPoint);
+
+    bool IsColorBufferOutput();
+    bool IsDepthBufferOutput();
+    bool IsUserBufferOutput(int attachmentPoint);
+
+    /* for the kernel, while the pass is executed (see IPixelKernel) */
+    SoftwareImagePtr     GetInput(string parameterName); // a texture, the color- or depthbuffer, or a userbuffer
+    const vector<float>& GetFloat(string parameterName);
+    const vector<int>&   GetInt(string parameterName);
+    float* GetOutputRow(int attachmentPoint, int y);     // gl_FragData[attachmentPoint] (0 is the colorbuffer, if output to)
+    float* GetDepthOutputRow(int y);                     // gl_FragDepth
+    int GetWidth();
+    int GetHeight();
+};
+
+} // NS PostProcessing
+} // NS OpenEngine
+
+#endif
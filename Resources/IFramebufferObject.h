@@ -25,10 +25,12 @@ class IFramebufferObject {
     virtual void AttachColorRenderBuffer  (IRenderBufferPtr rb, int attachmentPoint) = 0;
     virtual void AttachDepthRenderBuffer  (IRenderBufferPtr rb) = 0;
     virtual void AttachStencilRenderBuffer(IRenderBufferPtr rb) = 0;
+    virtual void AttachDepthStencilRenderBuffer(IRenderBufferPtr rb) = 0; // <- packed depth-stencil (attached at both)
 
     virtual void AttachColorTexture(ITexture2DPtr tex, int attachmentPoint) = 0;
     virtual void AttachDepthTexture(ITexture2DPtr tex) = 0;
     virtual void AttachStencilTexture(ITexture2DPtr tex) = 0;
+    virtual void AttachDepthStencilTexture(ITexture2DPtr tex) = 0; // <- packed depth-stencil (attached at both)
 
     virtual void DetachColorAttachment  (int attachmentPoint) = 0; // ok bare at brug rb'er? Eller skal man detache for den resource type der er bundet?
     virtual void DetachDepthAttachment  () = 0;
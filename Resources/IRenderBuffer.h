@@ -8,7 +8,10 @@
 namespace OpenEngine {
 namespace Resources {
 
-enum PixelFormat {RB_DEPTH, RB_RGB, RB_RGBA, RB_STENCIL}; // se 4.4.4 for alle mulige renderbuffer internal formats.
+enum PixelFormat {RB_DEPTH, RB_RGB, RB_RGBA, RB_STENCIL,
+		  RB_RGBA16F, RB_RG16F, RB_R16F, RB_R11G11B10F, RB_RGB10A2, // <- half-float and packed HDR formats (see TexelFormat)
+		  RB_R8, RB_RG8, RB_R32F, RB_RG32F, RB_RGB16F,
+		  RB_DEPTH_STENCIL}; // se 4.4.4 for alle mulige renderbuffer internal formats.
 						          // weird bug: selvom der str GL_STENCIL_INDEX er supported for rb'er, brokker den sig
 
 /** Interface for RenderBuffer classes
@@ -27,6 +30,7 @@ class IRenderBuffer : public IImage {
 
     virtual unsigned int GetWidth() = 0;
     virtual unsigned int GetHeight() = 0;
+    virtual int GetSamples() = 0; // 0 = not multisampled
     virtual int GetZDepth() = 0; // <-. to make it work with ITextureResource, we can't call it getDepth :(
     virtual unsigned int GetDepth() = 0; // <- this is NOT the image-depth, but instead the bit-depth of each pixel. :( (to make OE happy)
 
@@ -13,7 +13,14 @@ namespace OpenEngine {
 namespace Resources {
 
 // bliver ndt til at lave prefix for at undg ambiguity (se: http://www.informit.com/guides/content.aspx?g=cplusplus&seqNum=289&rl=1 )
-enum TexelFormat   {TEX_DEPTH, TEX_DEPTH_STENCIL, TEX_LUMINANCE, TEX_RGB, TEX_RGBA, TEX_LUMINANCE_FLOAT, TEX_RGB_FLOAT, TEX_RGBA_FLOAT};
+enum TexelFormat   {TEX_DEPTH, TEX_DEPTH_STENCIL, TEX_LUMINANCE, TEX_RGB, TEX_RGBA, TEX_LUMINANCE_FLOAT, TEX_RGB_FLOAT, TEX_RGBA_FLOAT,
+		    TEX_RGBA16F = TEX_RGBA_FLOAT, // <- the *_FLOAT formats are half-floats (16 bit per component)
+		    TEX_RG16F, TEX_R16F,          // 16 bit float, two or one components
+		    TEX_R11G11B10F,               // packed float (no sign, no alpha) - HDR color in 32 bit per texel
+		    TEX_RGB10A2,                  // 10 bit fixed-point per color component, 2 bit alpha
+		    TEX_R8, TEX_RG8,              // 8 bit fixed-point, one or two components (color-renderable, unlike luminance)
+		    TEX_R32F, TEX_RG32F,          // 32 bit float, one or two components
+		    TEX_RGBA32F};                 // 32 bit float, four components (f.e. sums which would lose precision as half-floats)
 enum TextureWrap   {TEX_CLAMP, TEX_CLAMP_TO_EDGE, TEX_CLAMP_TO_BORDER, TEX_REPEAT, TEX_MIRRORED_REPEAT};
 enum TextureFilter {TEX_NEAREST, TEX_LINEAR};
 
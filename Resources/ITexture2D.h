@@ -60,6 +60,17 @@ class ITexture2D : public ITexture {
     virtual void SetData(unsigned char* data) = 0;
     virtual void SetFloatData(float* data) = 0;
 
+    /* update a part of the texture (without reallocating it) - rowStride is the number of texels per row in data (0 = width) */
+    virtual void SetSubData     (int x, int y, int width, int height, unsigned char* data, int rowStride = 0) = 0;
+    virtual void SetFloatSubData(int x, int y, int width, int height, float* data, int rowStride = 0) = 0;
+
+    /* content version - incremented each time the content changes (rendering to the texture must call IncrementVersion) */
+    virtual int  GetVersion() = 0;
+    virtual void IncrementVersion() = 0;
+
+    /* exchange the content with another texture of the same size and format (without copying - f.e. to rotate history buffers) */
+    virtual void SwapContent(ITexture2DPtr texture) = 0;
+
     virtual ImageType GetImageType() = 0;         // texture2D, renderbuffer, ...
     //FBOAttachmentBufferType getAttachmentBufferType();   // color, depth, stencil
 };
@@ -0,0 +1,52 @@
+#ifndef __IUNIFORMBLOCK_H__
+#define __IUNIFORMBLOCK_H__
+
+#include <boost/shared_ptr.hpp>
+
+#include <vector>
+#include <string>
+
+namespace OpenEngine {
+namespace Resources {
+
+using namespace std;
+
+/** Interface for UniformBlock classes (a set of uniform values shared by many fragment programs)
+ */
+class IUniformBlock {
+
+  public:
+
+    virtual ~IUniformBlock() {}
+
+    virtual string GetName() = 0; // the name of the uniform block in the fragment programs
+
+    /* declare the fields (in the same order as in the fragment programs) */
+    virtual void AddFloat(string fieldName, int n) = 0;  // float, vec2, vec3 or vec4
+    virtual void AddMatrix(string fieldName, int n) = 0; // mat2, mat3 or mat4
+
+    /* set values (they are uploaded once, no matter how many fragment programs use the block) */
+    virtual void SetFloat(string fieldName, vector<float> floatvector) = 0;
+    virtual void SetMatrix(string fieldName, vector<float> floatmatrix) = 0; // column-major
+
+    virtual vector<string> GetFieldNames() = 0;
+    virtual vector<float>  GetValue(string fieldName) = 0;
+    virtual int            GetFieldSize(string fieldName) = 0; // vector dimension (or matrix dimension n)
+    virtual bool           IsMatrix(string fieldName) = 0;
+    virtual int            GetFieldOffset(string fieldName) = 0; // the std140 offset in bytes
+
+    virtual int  GetID() = 0;           // the buffer handle (0 if uniform buffers are not supported)
+    virtual int  GetBindingPoint() = 0; // the uniform buffer binding point of this block
+    virtual int  GetVersion() = 0;      // incremented each time a value changes
+    virtual void Upload() = 0;          // upload the values if any have changed since last upload
+};
+
+/**
+ * IUniformBlock smart pointer.
+ */
+typedef boost::shared_ptr<IUniformBlock> IUniformBlockPtr;
+
+} // NS Resources
+} // NS OpenEngine
+
+#endif
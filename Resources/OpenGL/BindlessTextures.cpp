@@ -0,0 +1,81 @@
+#include "BindlessTextures.h"
+
+#include <string.h>
+
+namespace OpenEngine {
+namespace Resources {
+
+bool BindlessTextures::enabled = false;
+int  BindlessTextures::supported = -1;
+map<GLuint, GLuint64> BindlessTextures::handles;
+
+/** Enable/disable bindless textures (only has an effect if they are supported).
+ *  As the fragment programs are compiled differently (see PPE_BINDLESS_TEXTURES), it must be done before any
+ *  fragment programs are created.
+ *  @param[in] enable whether to use bindless textures
+ */
+void BindlessTextures::Enable(bool enable) {
+    enabled = enable;
+}
+
+/** whether bindless textures are enabled and supported by this gfx-card
+ */
+bool BindlessTextures::IsEnabled() {
+    return enabled && IsSupported();
+}
+
+/** whether bindless textures (GL_ARB_bindless_texture) are supported by this gfx-card
+ */
+bool BindlessTextures::IsSupported() {
+    if (supported == -1) {
+#ifdef GL_ARB_bindless_texture
+	const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+	supported = (extensions != NULL && strstr(extensions, "GL_ARB_bindless_texture") != NULL) ? 1 : 0;
+#else
+	supported = 0;
+#endif
+    }
+    return supported == 1;
+}
+
+/** get the resident handle of a texture (created and made resident the first time)
+ *  @param[in] texID the OpenGL handle of the texture
+ *  @return the bindless handle (0 if bindless textures aren't supported)
+ */
+GLuint64 BindlessTextures::GetHandle(GLuint texID) {
+    map<GLuint, GLuint64>::iterator it = handles.find(texID);
+    if (it != handles.end()) return it->second;
+
+    GLuint64 handle = 0;
+#ifdef GL_ARB_bindless_texture
+    if (IsSupported()) {
+	handle = glGetTextureHandleARB(texID);
+	glMakeTextureHandleResidentARB(handle);
+    }
+#endif
+    if (handle == 0) logger.error << "could not get a bindless handle for texture " << texID << logger.end;
+    handles[texID] = handle;
+    return handle;
+}
+
+/** whether a handle has been made for a texture (if so, the texture is immutable)
+ *  @param[in] texID the OpenGL handle of the texture
+ */
+bool BindlessTextures::HasHandle(GLuint texID) {
+    return handles.find(texID) != handles.end();
+}
+
+/** Make the handle of a texture non-resident and forget it. Must be called before the texture is deleted.
+ *  @param[in] texID the OpenGL handle of the texture
+ */
+void BindlessTextures::Release(GLuint texID) {
+    map<GLuint, GLuint64>::iterator it = handles.find(texID);
+    if (it == handles.end()) return;
+#ifdef GL_ARB_bindless_texture
+    if (it->second != 0) glMakeTextureHandleNonResidentARB(it->second);
+#endif
+    handles.erase(it);
+}
+
+} // NS Resources
+} // NS OpenEngine
@@ -0,0 +1,58 @@
+#ifndef __BINDLESSTEXTURES_H__
+#define __BINDLESSTEXTURES_H__
+
+#include <Logging/Logger.h>
+
+#include <Meta/OpenGL.h>
+#include <map>
+
+namespace OpenEngine {
+namespace Resources {
+
+using namespace std;
+
+/** Keeps track of the bindless handles (GL_ARB_bindless_texture) of textures.
+ *  When bindless textures are enabled, FragmentPrograms pass resident texture handles to their samplers
+ *  instead of binding the textures to texture units, so there is no limit on the number of textures a
+ *  fragment program can sample, and nothing has to be bound per pass. If the extension isn't supported,
+ *  textures are bound to texture units as usual.
+ *
+ *  The fragment programs must allow samplers to be set with handles. The define PPE_BINDLESS_TEXTURES
+ *  tells them when:
+ *
+ *    #ifdef PPE_BINDLESS_TEXTURES
+ *    #extension GL_ARB_bindless_texture : require
+ *    layout(bindless_sampler) uniform;
+ *    #endif
+ *
+ *  Only the textures owned by the effects (their buffers, userbuffers and history buffers) are given handles,
+ *  and only in fragment programs which enable the extension - textures bound with BindTexture belong to the
+ *  engine, and keep being bound to texture units.
+ *
+ *  @note OpenGL makes a texture immutable once it has a handle. Texture2D takes care of this by moving to
+ *        a new texture object (with a new ID) when a texture with a handle is modified, and the framebuffers
+ *        attach the new one (see FramebufferObject::RefreshAttachments).
+ */
+class BindlessTextures {
+
+  private:
+
+    static bool enabled;
+    static int  supported; // -1 = not checked yet
+    static map<GLuint, GLuint64> handles; // texture ID -> resident handle
+
+  public:
+
+    static void Enable(bool enable); // must be called before any fragment programs are created
+    static bool IsEnabled();         // enabled AND supported
+    static bool IsSupported();
+
+    static GLuint64 GetHandle(GLuint texID); // made resident the first time
+    static bool     HasHandle(GLuint texID);
+    static void     Release(GLuint texID);   // call before the texture is deleted
+};
+
+} // NS Resources
+} // NS OpenEngine
+
+#endif
@@ -1,7 +1,9 @@
 #include "FragmentProgram.h"
 #include <Resources/ResourceManager.h>
+#include <Resources/ITexture2D.h>
 
 #include <Resources/DirectoryManager.h>
+#include <string.h>
 
 
 // see http://www.opengl.org/sdk/docs/man/xhtml/glUniform.xml for how to set uniforms
@@ -11,14 +13,18 @@
 namespace OpenEngine {
 namespace Resources {
 
+vector<GLint> FragmentProgram::boundTextures;
+int FragmentProgram::multiBind = -1;
+
 /**
  * create a fragment program from a file (must contain a main() method)
  * @param[in] filename the filename of the file containing the GLSL fragmentprogram sourcecode
+ * @param[in] defines defines to inject into the source, e.g. to make loop counts constant (see ShaderPreprocessor)
  */
-FragmentProgram::FragmentProgram(string filename){
+FragmentProgram::FragmentProgram(string filename, ShaderDefines defines){
     vector<string> filenames;
     filenames.push_back(filename);
-    ConstructorSetup(filenames);
+    ConstructorSetup(filenames, defines);
 }
 
 /**
@@ -26,25 +32,31 @@ FragmentProgram::FragmentProgram(string filename){
  * This can be useful if you have functions common to several fragmentprograms which you have factored out
  * into seperate files.
  * @param[in] filenames the filenames of the files containing the GLSL fragmentprogram sourcecode
+ * @param[in] defines defines to inject into each of the files
  */
-FragmentProgram::FragmentProgram(vector<string> filenames) {
+FragmentProgram::FragmentProgram(vector<string> filenames, ShaderDefines defines) {
     if (filenames.size() == 0) throw PPEResourceException("list of filenames was empty");
-    ConstructorSetup(filenames);
+    ConstructorSetup(filenames, defines);
 }
 
-void FragmentProgram::ConstructorSetup(vector<string> filenames) {
-    this->programID = 0;
-    this->savedProgID = 0;
-    glGetIntegerv(GL_MAX_TEXTURE_UNITS, &(this->maxTextureUnits));
-    SetupFragmentProgram(filenames);
+void FragmentProgram::ConstructorSetup(vector<string> filenames, ShaderDefines defines) {
+    this->uniformsDirty = true;
+    this->inputVersion  = 0;
+    this->inputProgramGeneration = -1;
+    this->programGeneration = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &(this->maxTextureUnits)); // <- (GL_MAX_TEXTURE_UNITS is the fixed-function limit, which is much lower)
+    program = FragmentProgramRegistry::GetProgram(filenames, defines);
 }
 
 FragmentProgram::~FragmentProgram() {
-    for (unsigned int i=0; i<shaderIDs.size(); i++)
-        glDeleteShader(shaderIDs.at(i));
-    glDeleteProgram(programID);
+    // the program object itself is deleted by the registry when the last FragmentProgram using it is gone
+    if (program->GetStateOwner() == this) program->SetStateOwner(NULL);
     for (unsigned int i=0; i<textureBindings.size(); i++)
         delete textureBindings.at(i);
+    for (unsigned int i=0; i<uniformBindings.size(); i++)
+        delete uniformBindings.at(i);
+    for (unsigned int i=0; i<uniformBlockBindings.size(); i++)
+        delete uniformBlockBindings.at(i);
 }
 
 /** get max number of textures that can be bound to uniform sampler parameters in the fragment program on this graphics card
@@ -53,107 +65,25 @@ int FragmentProgram::GetMaxTextureBindings() {
     return maxTextureUnits;
 }
 
-// se : http://www.lighthouse3d.com/opengl/glsl/index.php?oglshader
-void FragmentProgram::SetupFragmentProgram(vector<string> filenames) {
-
-    // create the shaders
-    for (unsigned int i=0; i<filenames.size(); i++) {
-	string filename = filenames.at(i);
-	GLuint shaderID = glCreateShader(GL_FRAGMENT_SHADER);
-	shaderIDs.push_back(shaderID);
-	//const char* shaderString = LoadString(filename).c_str();
-	string shaderString = LoadString(filename);
-	const char* shaderChars = shaderString.c_str();
-	glShaderSource(shaderID, 1, (const GLchar**)&shaderChars, NULL); // <- null means that the strings are NULL terminated
-	glCompileShader(shaderID);
-
-	// print errors and warnings to logger
-	GLsizei bufSize;
-	glGetShaderiv(shaderID, GL_INFO_LOG_LENGTH, &bufSize);
-	GLsizei length;
-	char*   infoLog = new char[bufSize];
-	glGetShaderInfoLog(shaderID, bufSize, &length, infoLog);
-	if (length>0) logger.error << "\"" << filename << "\" compiler output:\n" << infoLog << logger.end;
-	delete infoLog;
-
-	/*
-	// abort if compile error
-	GLint shaderCompileOk;
-	glGetShaderiv (shaderID , GL_COMPILE_STATUS, &shaderCompileOk);
-	if (!shaderCompileOk)
-	     throw PPEResourceException("error compiling shader");
-	     //printf("error compiling shader-source %s\n",filename);
-	*/
-    }
-
-    // create a program (link all the shaders together to create the executable shader program)
-    programID = glCreateProgram();
-    for (unsigned int i=0; i<shaderIDs.size(); i++)
-        glAttachShader(programID, shaderIDs.at(i));
-    glLinkProgram(programID);
-
-    // print errors and warnings to logger (only if real errors, otherwise it will just repeat the shader errors)
-    GLint programLinkOk;
-    glGetProgramiv(programID, GL_LINK_STATUS, &programLinkOk);
-    if (!programLinkOk) {
-	GLsizei bufSize;
-	glGetProgramiv(programID, GL_INFO_LOG_LENGTH, &bufSize);
-	GLsizei length;
-	char*   infoLog = new char[bufSize];
-	glGetProgramInfoLog(programID, bufSize, &length, infoLog);
-	if (length>0) {
-	    for (unsigned int i=0; i<filenames.size(); i++) logger.error << "\"" << filenames.at(i) << "\" ";
-	    logger.error << "linker output:\n" << infoLog << logger.end;
-	}
-	delete infoLog;
-    }
-
-    /*
-    // abort if link error
-    GLint programLinkOk;
-    glGetProgramiv(programID, GL_LINK_STATUS   , &programLinkOk);
-    if (!programLinkOk)
-        throw PPEResourceException("shader linking error");
-    */
-}
-
-string FragmentProgram::LoadString(string filename) {
-
-    filename = OpenEngine::Resources::DirectoryManager::FindFileInPath(filename);
-
-    FILE *fp = fopen(filename.c_str(),"rb"); // for binary files ftell works correctly (not text files)
-
-    if (fp == NULL) {
-        logger.error << filename << logger.end;
-	throw PPEResourceException("error opening shader");
-    }
-
-    fseek(fp, 0, SEEK_END);
-    int length = ftell(fp);
-    fseek(fp, 0, SEEK_SET);
-
-    char* str = new char[length+1];
-    int reallen = fread(str, 1, length, fp);
-    str[reallen] = '\0';
-
-    if (ferror(fp))
-	throw PPEResourceException("error loading shader");
-
-    fclose(fp);
-
-    string s(str);
-    delete str;
 
-    return s;
+/** Wait for the program to be compiled and linked, and log any errors.
+ *  The compile is submitted when the fragment program is created, and this is done automatically the
+ *  first time it is bound, so calling it is only needed to control when the waiting happens.
+ *  @param[in] block if false, only resolve the program if the driver has already finished it in the background
+ *  @return whether the program has been resolved
+ */
+bool FragmentProgram::Resolve(const bool block) {
+    return program->Resolve(block);
 }
 
-
 /** Bind this fragment program
  * @note sideeffect: if any textures bound, texture units will be changed! (could be backed up by user)
  */
 void FragmentProgram::Bind() {
-    glUseProgram(programID);
+    glUseProgram(program->GetID());
     //TODO: remember texture-bindings/settings for all texture units
+    SetupUniformBlocks(); // <- before SetupUniforms, as it might set ordinary uniforms
+    SetupUniforms();
     SetupTextureUnits();
 }
 
@@ -183,32 +113,19 @@ void FragmentProgram::BindInt(string parameterName, vector<vector<int> > intvect
     int vectorsize = intvectors.at(0).size();
     if (vectorsize < 1 || vectorsize > 4) throw PPEResourceException("GLSL doesn't have a ivecX type, with the supplied X!");
 
-    // create a C array of all the intvector-values (to be supplied to OpenGL)
-      GLint* intarray = new GLint[vectorsize * intvectors.size()];
+    UniformBinding* binding = GetUniformBinding(parameterName, UNIFORM_INT);
+    binding->size  = vectorsize;
+    binding->count = intvectors.size();
+    vector<GLint> oldInts = binding->ints;
+    binding->ints.clear();
 
     for (unsigned int i=0; i<intvectors.size(); i++) {
         vector<int> intvector = intvectors.at(i);
 	if (intvector.size() != vectorsize) throw PPEResourceException("all vectors in an array must have the same size!");
 	for (unsigned int j=0; j<vectorsize; j++)
-	    intarray[i*vectorsize + j] = intvector.at(j);
+	    binding->ints.push_back(intvector.at(j));
     }
-
-
-    GuardedBind();
-
-    // get input parameter handle by name
-    GLint paramID = glGetUniformLocation(programID, parameterName.c_str());
-    if (paramID == -1) logger.error << "uniform \"" << parameterName << "\" does not exist" << logger.end;
-
-    // set value of variable (type: float, float2, float3, float4)
-    if (vectorsize==1) glUniform1iv(paramID, intvectors.size(), intarray); // see: http://www.thescripts.com/forum/thread394740.html
-    if (vectorsize==2) glUniform2iv(paramID, intvectors.size(), intarray); // see: http://developer.3dlabs.com/documents/glmanpages/glUniform.htm
-    if (vectorsize==3) glUniform3iv(paramID, intvectors.size(), intarray);
-    if (vectorsize==4) glUniform4iv(paramID, intvectors.size(), intarray);
-
-    GuardedUnbind();
-
-    delete intarray;
+    if (binding->ints != oldInts) inputVersion++;
 }
 
 
@@ -238,31 +155,19 @@ void FragmentProgram::BindFloat(string parameterName, vector<vector<float> > flo
     int vectorsize = floatvectors.at(0).size();
     if (vectorsize < 1 || vectorsize > 4) throw PPEResourceException("GLSL doesn't have a vecX type, with the supplied X!");
 
-    // create a C array of all the floatvector-values (to be supplied to OpenGL)
-    float* floatarray = new float[vectorsize * floatvectors.size()];
+    UniformBinding* binding = GetUniformBinding(parameterName, UNIFORM_FLOAT);
+    binding->size  = vectorsize;
+    binding->count = floatvectors.size();
+    vector<GLfloat> oldFloats = binding->floats;
+    binding->floats.clear();
 
     for (unsigned int i=0; i<floatvectors.size(); i++) {
         vector<float> floatvector = floatvectors.at(i);
 	if (floatvector.size() != vectorsize) throw PPEResourceException("all vectors in an array must have the same size!");
 	for (unsigned int j=0; j<vectorsize; j++)
-	    floatarray[i*vectorsize + j] = floatvector.at(j);
+	    binding->floats.push_back(floatvector.at(j));
     }
-
-    GuardedBind();
-
-    // get input parameter handle by name
-    GLint paramID = glGetUniformLocation(programID, parameterName.c_str());
-    if (paramID == -1) logger.error << "uniform \"" << parameterName << "\" does not exist" << logger.end;
-
-    // set value of variable (type: float, float2, float3, float4)
-    if (vectorsize==1) glUniform1fv(paramID, floatvectors.size(), floatarray); // see: http://www.thescripts.com/forum/thread394740.html
-    if (vectorsize==2) glUniform2fv(paramID, floatvectors.size(), floatarray); // see: http://developer.3dlabs.com/documents/glmanpages/glUniform.htm
-    if (vectorsize==3) glUniform3fv(paramID, floatvectors.size(), floatarray);
-    if (vectorsize==4) glUniform4fv(paramID, floatvectors.size(), floatarray);
-
-    GuardedUnbind();
-
-    delete floatarray;
+    if (binding->floats != oldFloats) inputVersion++;
 }
 
 
@@ -296,50 +201,32 @@ void FragmentProgram::BindMatrix(string parameterName, int n, int m, vector<vect
     if (n<2 || n>4 || m<2 || m>4) throw PPEResourceException("unsupported dimensions!");
     if (n != m) throw PPEResourceException("dimensions not equal!");
 
-    // create a C array of all the floatmatrix-entries (to be supplied to OpenGL)
-    float* floatarray = new float[matrixsize * floatmatrices.size()];
+    UniformBinding* binding = GetUniformBinding(parameterName, UNIFORM_MATRIX);
+    binding->size      = n;
+    binding->count     = floatmatrices.size();
+    if (binding->transpose != transpose) inputVersion++;
+    binding->transpose = transpose;
+    vector<GLfloat> oldFloats = binding->floats;
+    binding->floats.clear();
 
     for (unsigned int i=0; i<floatmatrices.size(); i++) {
         vector<float> floatmatrix = floatmatrices.at(i);
 	if (floatmatrix.size() != matrixsize) throw PPEResourceException("all matrices in an array must have the same size!");
 	for (unsigned int j=0; j<matrixsize; j++)
-	    floatarray[i*matrixsize + j] = floatmatrix.at(j);
+	    binding->floats.push_back(floatmatrix.at(j));
     }
-
-
-    GuardedBind();
-
-    // get input parameter handle by name
-    GLint paramID = glGetUniformLocation(programID, parameterName.c_str());
-    if (paramID == -1) logger.error << "uniform \"" << parameterName << "\" does not exist" << logger.end;
-
-    // set value of variable
-    if (n==2 && m==2) glUniformMatrix2fv  (paramID, floatmatrices.size(), (GLboolean)transpose, floatarray);
-      /* CPVC, gl 2.1
-    if (n==2 && m==3) glUniformMatrix2x3fv(paramID, floatmatrices.size(), (GLboolean)transpose, floatarray);
-    if (n==2 && m==4) glUniformMatrix2x4fv(paramID, floatmatrices.size(), (GLboolean)transpose, floatarray);
-    if (n==3 && m==2) glUniformMatrix3x2fv(paramID, floatmatrices.size(), (GLboolean)transpose, floatarray);
-      */
-    if (n==3 && m==3) glUniformMatrix3fv  (paramID, floatmatrices.size(), (GLboolean)transpose, floatarray);
-      /* CPVC, gl 2.1
-    if (n==3 && m==4) glUniformMatrix3x4fv(paramID, floatmatrices.size(), (GLboolean)transpose, floatarray);
-    if (n==4 && m==2) glUniformMatrix4x2fv(paramID, floatmatrices.size(), (GLboolean)transpose, floatarray);
-    if (n==4 && m==3) glUniformMatrix4x3fv(paramID, floatmatrices.size(), (GLboolean)transpose, floatarray);
-      */
-    if (n==4 && m==4) glUniformMatrix4fv  (paramID, floatmatrices.size(), (GLboolean)transpose, floatarray);
-
-    GuardedUnbind();
-
-    delete floatarray;
+    if (binding->floats != oldFloats) inputVersion++;
 }
 
 /** Bind a texture to a uniform sampler2D input-parameter of the fragmentprogram of this pass.
  *
  *  @param[in] parameterName the name of the input-parameter in the fragment program
  *  @param[in] texture the texture
+ *  @param[in] allowHandle whether the texture may be given a bindless handle (see BindlessTextures) - only for textures owned
+ *             by the caller, as a resident handle makes the texture immutable (any other texture is bound to a texture unit)
  *  @note must be called _before_ binding the fragment program to have any effect (not while it is bound)
  */
-void FragmentProgram::BindTexture(string parameterName, ITextureResourcePtr texture) {
+void FragmentProgram::BindTexture(string parameterName, ITextureResourcePtr texture, const bool allowHandle) {
     if (texture.get() == NULL) throw PPEResourceException("texture was NULL"); // or should it unbind?
 
     // TODO: check if parameter-name exists in the fragment program
@@ -350,53 +237,272 @@ void FragmentProgram::BindTexture(string parameterName, ITextureResourcePtr text
 	TextureBinding* texbind = textureBindings.at(i);
 
 	if (texbind->parameterName == parameterName) {
-	    texbind->texture = texture;
+	    if (texbind->texture != texture) inputVersion++;
+	    texbind->texture     = texture;
+	    texbind->allowHandle = allowHandle;
 	    found = true;
 	}
     }
 
     // if parameterName wasn't already bound, then add the binding (unless we have reached max number of bindings)
     if (!found) {
-	if (textureBindings.size() > maxTextureUnits) logger.error << "can't bind any more textures - ignored" << logger.end;
+	if ((GLint)textureBindings.size() >= maxTextureUnits && !(allowHandle && BindlessTextures::IsEnabled())) // <- no limit with bindless textures
+	    logger.error << "can't bind any more textures - ignored" << logger.end;
 	else {
-	    textureBindings.push_back(new TextureBinding(parameterName, texture));
-	    GLint paramID = glGetUniformLocation(programID, parameterName.c_str());
-	    if (paramID == -1) logger.error << "uniform \"" << parameterName << "\" does not exist" << logger.end;
+	    inputVersion++;
+	    textureBindings.push_back(new TextureBinding(parameterName, texture, allowHandle));
+	    // (an error is logged on first bind if the uniform doesn't exist - looking it up now would wait for the compile)
 	}
     }
 }
 
 
+/** Get the texture bound to an input-parameter (see BindTexture)
+ *  @param[in] parameterName the name of the sampler
+ *  @return the texture, or NULL if none is bound to the parameter
+ */
+ITextureResourcePtr FragmentProgram::GetTexture(string parameterName) {
+    for (unsigned int i=0; i<textureBindings.size(); i++)
+	if (textureBindings.at(i)->parameterName == parameterName) return textureBindings.at(i)->texture;
+    return ITextureResourcePtr();
+}
+
+
 /** setup texture units according to the recorded texture-bindings
+ *  The samplers get their texture units when the program is linked, or when first bound in a bindless program (see
+ *  LinkedProgram::GetSamplerUnit), so only the textures have to be bound - and only those which aren't bound to their unit already.
  *  @pre: textureBindings.size() <= maxTextureUnits
  *  @pre: the shader must be bound when this method is called
  */
 void FragmentProgram::SetupTextureUnits() {
+    // with bindless textures, the samplers of the textures owned by the effects are just given the (resident) handles - nothing is
+    // bound (other textures are bound to units, as a handle would make them immutable for their owner - see BindTexture)
+    bool bindless = BindlessTextures::IsEnabled() && program->UsesBindlessTextures();
+
+    int firstChanged = -1, lastChanged = -1;
 
     for (unsigned int i=0; i<textureBindings.size(); i++) {
 	TextureBinding* texbind = textureBindings.at(i);
+#ifdef GL_ARB_bindless_texture
+	if (bindless) {
+	    if (texbind->location == -2) texbind->location = program->GetUniformLocation(texbind->parameterName);
+	    if (texbind->location == -1) continue;
+	    if (texbind->allowHandle) {
+		GLuint64 handle = BindlessTextures::GetHandle(texbind->texture->GetID());
+		if (texbind->handle == handle) continue;
+		glUniformHandleui64ARB(texbind->location, handle);
+		texbind->handle = handle;
+		continue;
+	    }
+	}
+#endif
+	if (texbind->unit == -2) texbind->unit = program->GetSamplerUnit(texbind->parameterName);
+	if (texbind->unit == -1) continue;
+#ifdef GL_ARB_bindless_texture
+	// (the sampler may have been given a handle by another FragmentProgram using the program - give it its unit back)
+	if (bindless && texbind->handle != UNIT_HANDLE) {
+	    glUniform1i(texbind->location, texbind->unit);
+	    texbind->handle = UNIT_HANDLE;
+	}
+#endif
 
-	glActiveTexture(GL_TEXTURE0 + i);
-	glBindTexture(GL_TEXTURE_2D, texbind->texture->GetID());
-	GLint paramID = glGetUniformLocation(programID, texbind->parameterName.c_str()); // this must be done AFTER fp bind!
-	glUniform1i(paramID, i); // texunit i
+	GLint unit  = texbind->unit;
+	GLint texID = texbind->texture->GetID();
+	if (unit >= (GLint)boundTextures.size()) boundTextures.resize(unit+1, -1);
+	if (boundTextures[unit] == texID) continue;
+
+	if (HasMultiBind()) { // <- bound below, all at once
+	    if (firstChanged == -1 || unit < firstChanged) firstChanged = unit;
+	    if (unit > lastChanged) lastChanged = unit;
+	}
+	else {
+	    glActiveTexture(GL_TEXTURE0 + unit);
+	    glBindTexture(GL_TEXTURE_2D, texID);
+	    firstChanged = unit;
+	}
+	boundTextures[unit] = texID;
+    }
+
+    if (firstChanged == -1) return; // nothing changed
+
+#ifdef GL_ARB_multi_bind
+    if (HasMultiBind()) {
+	// (units in the range which this program doesn't use are given the texture they already have, or none)
+	vector<GLuint> textures;
+	for (int unit=firstChanged; unit<=lastChanged; unit++)
+	    textures.push_back(boundTextures[unit] == -1 ? 0 : boundTextures[unit]);
+	for (int unit=firstChanged; unit<=lastChanged; unit++)
+	    if (boundTextures[unit] == -1) boundTextures[unit] = 0;
+	glBindTextures(firstChanged, textures.size(), &textures[0]);
+	return;
     }
+#endif
 
     glActiveTexture(GL_TEXTURE0);//reset active texture
 }
 
+/** Forget which textures are bound to the texture units. Must be called if textures might have been bound to
+ *  units by others since the last fragment program was bound (e.g. when the scene has been rendered).
+ */
+void FragmentProgram::InvalidateTextureUnitCache() {
+    for (unsigned int i=0; i<boundTextures.size(); i++)
+	boundTextures[i] = -1;
+}
+
+/* check for GL_ARB_multi_bind (the first time) */
+bool FragmentProgram::HasMultiBind() {
+    if (multiBind == -1) {
+#ifdef GL_ARB_multi_bind
+	const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+	multiBind = (extensions != NULL && strstr(extensions, "GL_ARB_multi_bind") != NULL) ? 1 : 0;
+#else
+	multiBind = 0;
+#endif
+    }
+    return multiBind == 1;
+}
+
 
-void FragmentProgram::GuardedBind()  {
-    if (savedProgID != 0) throw PPEResourceException("guardedBind: internal error"); // to prevent recursive-ish routines messing up the guardedBind
-    glGetIntegerv(GL_CURRENT_PROGRAM, &savedProgID);
-    if (programID != (GLuint)savedProgID) // no need to bind if this program is already bound
-         glUseProgram(programID);
+/** Use a uniform block in this fragment program. The values are taken from the block each time the program
+ *  is bound, so they only have to be set once for all the fragment programs using it.
+ *  @param[in] block the uniform block (the fragment program must declare a uniform block with the same name and fields)
+ */
+void FragmentProgram::BindUniformBlock(IUniformBlockPtr block) {
+    for (unsigned int i=0; i<uniformBlockBindings.size(); i++)
+	if (uniformBlockBindings.at(i)->block == block) return;
+    uniformBlockBindings.push_back(new UniformBlockBinding(block));
+    inputVersion++;
 }
 
-void FragmentProgram::GuardedUnbind() {
-    if (programID != (GLuint)savedProgID)
-        glUseProgram(savedProgID);
-    savedProgID = 0;
+/** Get the version of the inputs of this fragment program: it is incremented each time a uniform value or texture binding
+ *  changes, and when the content of a bound 2D texture (see ITexture2D::GetVersion) or uniform block changes.
+ *  (Other textures - f.e. loaded from files - are assumed never to change). A hot-reload of the program counts as a change too.
+ *  So if it is unchanged, the output of the program is too (used to skip passes with unchanged inputs).
+ *  @return the version
+ */
+int FragmentProgram::GetInputVersion() {
+    if (program->GetGeneration() != inputProgramGeneration) {
+	inputProgramGeneration = program->GetGeneration();
+	inputVersion++;
+    }
+    for (unsigned int i=0; i<textureBindings.size(); i++) {
+	TextureBinding* texbind = textureBindings.at(i);
+	ITexture2DPtr tex = boost::dynamic_pointer_cast<ITexture2D>(texbind->texture);
+	if (tex.get() == NULL || tex->GetVersion() == texbind->version) continue;
+	texbind->version = tex->GetVersion();
+	inputVersion++;
+    }
+    for (unsigned int i=0; i<uniformBlockBindings.size(); i++) {
+	UniformBlockBinding* blockbind = uniformBlockBindings.at(i);
+	if (blockbind->block->GetVersion() == blockbind->inputVersion) continue;
+	blockbind->inputVersion = blockbind->block->GetVersion();
+	inputVersion++;
+    }
+    return inputVersion;
+}
+
+/** make the uniform blocks available to the program.
+ *  With uniform buffers, the block is uploaded (only if it has changed) and the program's block is bound to the
+ *  block's binding point (only the first time). Without, the values are set as ordinary uniforms when they change.
+ *  @pre: the shader must be bound when this method is called
+ */
+void FragmentProgram::SetupUniformBlocks() {
+    for (unsigned int i=0; i<uniformBlockBindings.size(); i++) {
+	UniformBlockBinding* b = uniformBlockBindings.at(i);
+
+	if (UniformBlock::IsSupported()) {
+	    b->block->Upload();
+	    program->BindUniformBlock(b->block);
+	    continue;
+	}
+
+	if (b->version == b->block->GetVersion()) continue;
+	vector<string> fieldNames = b->block->GetFieldNames();
+	for (unsigned int j=0; j<fieldNames.size(); j++) {
+	    int n = b->block->GetFieldSize(fieldNames.at(j));
+	    if (b->block->IsMatrix(fieldNames.at(j))) BindMatrix(fieldNames.at(j), n, n, b->block->GetValue(fieldNames.at(j)));
+	    else                                      BindFloat(fieldNames.at(j), b->block->GetValue(fieldNames.at(j)));
+	}
+	b->version = b->block->GetVersion();
+    }
+}
+
+/** find the recorded value of a uniform, or add a new (empty) one
+ *  @note marks the uniforms dirty, as the caller is about to change the value
+ */
+FragmentProgram::UniformBinding* FragmentProgram::GetUniformBinding(string parameterName, UniformType type) {
+    uniformsDirty = true;
+    for (unsigned int i=0; i<uniformBindings.size(); i++) {
+	UniformBinding* binding = uniformBindings.at(i);
+	if (binding->parameterName == parameterName) {
+	    binding->type = type;
+	    return binding;
+	}
+    }
+
+    UniformBinding* binding = new UniformBinding();
+    binding->parameterName = parameterName;
+    binding->location      = -2; // looked up on first bind, so setting values doesn't wait for the compile
+    binding->type          = type;
+    binding->transpose     = false;
+    uniformBindings.push_back(binding);
+    return binding;
+}
+
+/** upload the recorded uniform values to the (shared) program object
+ *  Skipped if this fragment program was the last to upload its values and none of them have changed since.
+ *  @pre: the shader must be bound when this method is called
+ */
+void FragmentProgram::SetupUniforms() {
+    if (program->GetStateOwner() == this && !uniformsDirty) return;
+
+    // if another fragment program has used the program object, the bindless texture handles must be set again as well
+    if (program->GetStateOwner() != this)
+	for (unsigned int i=0; i<textureBindings.size(); i++)
+	    textureBindings.at(i)->handle = 0;
+
+    // if the program has been reloaded, the locations must be looked up again (the values are kept)
+    if (program->GetGeneration() != programGeneration) {
+	for (unsigned int i=0; i<uniformBindings.size(); i++)
+	    uniformBindings.at(i)->location = -2;
+	for (unsigned int i=0; i<textureBindings.size(); i++) {
+	    textureBindings.at(i)->unit     = -2;
+	    textureBindings.at(i)->location = -2;
+	}
+	programGeneration = program->GetGeneration();
+    }
+
+    for (unsigned int i=0; i<uniformBindings.size(); i++) {
+	UniformBinding* b = uniformBindings.at(i);
+	if (b->location == -2) b->location = program->GetUniformLocation(b->parameterName);
+	if (b->location == -1) continue;
+
+	switch (b->type) {
+	case UNIFORM_INT:
+	    // set value of variable (type: int, ivec2, ivec3, ivec4)
+	    if (b->size==1) glUniform1iv(b->location, b->count, &b->ints[0]); // see: http://www.thescripts.com/forum/thread394740.html
+	    if (b->size==2) glUniform2iv(b->location, b->count, &b->ints[0]); // see: http://developer.3dlabs.com/documents/glmanpages/glUniform.htm
+	    if (b->size==3) glUniform3iv(b->location, b->count, &b->ints[0]);
+	    if (b->size==4) glUniform4iv(b->location, b->count, &b->ints[0]);
+	    break;
+	case UNIFORM_FLOAT:
+	    // set value of variable (type: float, vec2, vec3, vec4)
+	    if (b->size==1) glUniform1fv(b->location, b->count, &b->floats[0]);
+	    if (b->size==2) glUniform2fv(b->location, b->count, &b->floats[0]);
+	    if (b->size==3) glUniform3fv(b->location, b->count, &b->floats[0]);
+	    if (b->size==4) glUniform4fv(b->location, b->count, &b->floats[0]);
+	    break;
+	case UNIFORM_MATRIX:
+	    // (non-square matrices requires gl 2.1, see BindMatrix)
+	    if (b->size==2) glUniformMatrix2fv(b->location, b->count, (GLboolean)b->transpose, &b->floats[0]);
+	    if (b->size==3) glUniformMatrix3fv(b->location, b->count, (GLboolean)b->transpose, &b->floats[0]);
+	    if (b->size==4) glUniformMatrix4fv(b->location, b->count, (GLboolean)b->transpose, &b->floats[0]);
+	    break;
+	}
+    }
+
+    program->SetStateOwner(this);
+    uniformsDirty = false;
 }
 
 } // NS Resources
@@ -2,7 +2,11 @@
 #define __FRAGMENTPROGRAM_H__
 
 #include <Resources/ITextureResource.h>
+#include <Resources/IUniformBlock.h>
 #include <Resources/PPEResourceException.h>
+#include <Resources/OpenGL/LinkedProgram.h>
+#include <Resources/OpenGL/FragmentProgramRegistry.h>
+#include <Resources/OpenGL/BindlessTextures.h>
 #include <Logging/Logger.h>
 
 #include <Meta/OpenGL.h>
@@ -19,6 +23,10 @@ namespace Resources {
 using namespace std;
 
 /** An object of this class encapsulates a GLSL fragmentprogram
+ *  The compiled and linked program object is shared with all other FragmentPrograms made from the same files
+ *  and defines (see FragmentProgramRegistry). Uniform values and texture bindings belong to each FragmentProgram and are
+ *  applied when it is bound.
+ *  Files with the extension .vert are compiled as vertex shaders (the default vertex processing is used without one).
  *  @note: OpenGL 2.0 or above only
  *  @author Bjarke N. Laustsen
  */
@@ -26,8 +34,7 @@ class FragmentProgram {
 
   private:
 
-    vector<GLuint> shaderIDs;
-    GLuint programID;
+    LinkedProgramPtr program; // shared between all FragmentPrograms with the same sources
 
     // max texture units on this gfx-card (max number of samplers that can be used)
     GLint maxTextureUnits;
@@ -36,39 +43,84 @@ class FragmentProgram {
     struct TextureBinding {
 	string              parameterName;
 	ITextureResourcePtr texture;
-	TextureBinding(string nam, ITextureResourcePtr tex) {parameterName=nam; texture=tex;}
+	GLint               unit;     // the texture unit of the sampler (-2 until looked up)
+	GLint               location; // the location of the sampler (-2 until looked up) (bindless textures only)
+	GLuint64            handle;   // the bindless handle last given to the sampler (0 = none, UNIT_HANDLE = given its unit)
+	bool                allowHandle; // whether the texture may be given a bindless handle (see BindTexture)
+	int                 version;  // the content version of the texture last seen by GetInputVersion (2D textures only)
+	TextureBinding(string nam, ITextureResourcePtr tex, bool allow) {parameterName=nam; texture=tex; unit=-2; location=-2; handle=0; allowHandle=allow; version=-1;}
     };
     vector<TextureBinding*> textureBindings;
+    static const GLuint64 UNIT_HANDLE = ~(GLuint64)0;
+
+    // the texture bound to each texture unit (as far as we know, -1 = unknown), so only changed textures are rebound
+    static vector<GLint> boundTextures;
+    static int multiBind; // whether glBindTextures (GL_ARB_multi_bind) is supported (-1 = not checked yet)
+    static bool HasMultiBind();
+
+    // since the program object is shared, uniform values are remembered and uploaded when this fragment program is bound
+    enum UniformType {UNIFORM_INT, UNIFORM_FLOAT, UNIFORM_MATRIX};
+    struct UniformBinding {
+	string          parameterName;
+	GLint           location;  // -2 until looked up (the program might not be linked yet when the value is set)
+	UniformType     type;
+	int             size;      // vector dimension (or matrix dimension n for matrices)
+	int             count;     // number of array elements
+	bool            transpose; // matrices only
+	vector<GLint>   ints;
+	vector<GLfloat> floats;
+    };
+    vector<UniformBinding*> uniformBindings;
+    bool uniformsDirty; // whether any values changed since they were last uploaded
+    int  programGeneration; // generation of the program when the uniform locations were looked up (see LinkedProgram::Reload)
+
+    // uniform blocks shared with other fragment programs (see UniformBlock)
+    struct UniformBlockBinding {
+	IUniformBlockPtr block;
+	int              version;      // version of the values last set as ordinary uniforms (if uniform buffers aren't supported)
+	int              inputVersion; // version last seen by GetInputVersion
+	UniformBlockBinding(IUniformBlockPtr blk) {block=blk; version=-1; inputVersion=-1;}
+    };
+    vector<UniformBlockBinding*> uniformBlockBindings;
 
-    void SetupFragmentProgram(vector<string> filenames);
+    // incremented each time the inputs change (a uniform value, a texture binding, or the content of a bound texture or block)
+    int inputVersion;
+    int inputProgramGeneration; // generation of the program last seen by GetInputVersion (a reload changes the output too)
 
-    string LoadString(string filename);
+    UniformBinding* GetUniformBinding(string parameterName, UniformType type);
+    void SetupUniformBlocks();
+    void SetupUniforms();
     void SetupTextureUnits();
-    void ConstructorSetup(vector<string> filenames);
-
-    // for avoiding side effects of most of the methods
-    GLint savedProgID;
-    void GuardedBind();
-    void GuardedUnbind();
+    void ConstructorSetup(vector<string> filenames, ShaderDefines defines);
 
   public:
 
-    FragmentProgram(string filename);
-    FragmentProgram(vector<string> filenames);
+    FragmentProgram(string filename, ShaderDefines defines = ShaderDefines());
+    FragmentProgram(vector<string> filenames, ShaderDefines defines = ShaderDefines());
     ~FragmentProgram();
 
     void Bind();
     void Unbind(); // unbinds all
 
+    bool Resolve(const bool block = true); // check compile/link status (done automatically on first bind)
+
     void BindInt(string parameterName, vector<int> intvector);
     void BindInt(string parameterName, vector<vector<int> > intvectors) ;
     void BindFloat(string parameterName, vector<float> floatvector);
     void BindFloat(string parameterName, vector<vector<float> > floatvectors);
     void BindMatrix(string parameterName, int n, int m, vector<float> floatmatrix, const bool transpose = false);
     void BindMatrix(string parameterName, int n, int m, vector<vector<float> > floatmatrices, const bool transpose = false);
-    void BindTexture(string parameterName, ITextureResourcePtr texture); // will not be bound immediately - not until next bind! (GLSL binding is a bit weird)
+    void BindTexture(string parameterName, ITextureResourcePtr texture, const bool allowHandle = false); // will not be bound immediately - not until next bind! (GLSL binding is a bit weird)
+    void BindUniformBlock(IUniformBlockPtr block); // the block is bound by its name
+    // note: uniform values are not set immediately either - not until next bind (the program object may be shared)
+
+    ITextureResourcePtr GetTexture(string parameterName); // the texture bound to the parameter (NULL if none)
 
     int GetMaxTextureBindings();
+
+    int GetInputVersion(); // unchanged if the inputs are unchanged (so the output would be the same)
+
+    static void InvalidateTextureUnitCache(); // call if textures might have been bound by someone else
 };
 
 } // NS Resources
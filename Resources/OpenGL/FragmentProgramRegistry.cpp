@@ -0,0 +1,115 @@
+#include "FragmentProgramRegistry.h"
+
+#include <Resources/DirectoryManager.h>
+#include <algorithm>
+
+namespace OpenEngine {
+namespace Resources {
+
+map<string, boost::weak_ptr<LinkedProgram> > FragmentProgramRegistry::programs;
+bool FragmentProgramRegistry::hotReload = false;
+
+/** Get the linked program for the given set of source files and defines.
+ *  If a program made from the same files and defines is still alive it is returned, otherwise a new one is compiled and linked.
+ *  @param[in] filenames the filenames of the files containing the GLSL fragmentprogram sourcecode
+ *  @param[in] defines the defines to inject into the sources
+ *  @return the shared program
+ */
+LinkedProgramPtr FragmentProgramRegistry::GetProgram(vector<string> filenames, ShaderDefines defines) {
+    vector<string> canonical = Canonicalize(filenames);
+    string key = MakeKey(canonical, defines);
+
+    map<string, boost::weak_ptr<LinkedProgram> >::iterator it = programs.find(key);
+    if (it != programs.end()) {
+	LinkedProgramPtr program = it->second.lock();
+	if (program.get() != NULL) return program;
+	programs.erase(it); // the program has been deleted since it was registered
+    }
+
+    LinkedProgramPtr program = LinkedProgramPtr(new LinkedProgram(canonical, defines));
+    programs[key] = program;
+    if (hotReload) WatchSourceFiles(program);
+    return program;
+}
+
+/** Enable/disable hot-reload of fragment programs (meant for tuning effects while the program is running).
+ *  When enabled, the source files of all programs (including the files they include) are watched, and a
+ *  program is recompiled in the background when one of them changes. The new program is swapped in by
+ *  Update, when it has finished compiling - if it fails, the old program is kept.
+ *  @param[in] enable whether to enable hot-reload
+ */
+void FragmentProgramRegistry::EnableHotReload(bool enable) {
+    hotReload = enable;
+    if (!enable) return;
+    for (map<string, boost::weak_ptr<LinkedProgram> >::iterator it = programs.begin(); it != programs.end(); it++) {
+	LinkedProgramPtr program = it->second.lock();
+	if (program.get() != NULL) WatchSourceFiles(program);
+    }
+}
+
+/** whether hot-reload is enabled
+ */
+bool FragmentProgramRegistry::IsHotReloadEnabled() {
+    return hotReload;
+}
+
+/** Start recompiling the programs whose files have changed, and swap in the reloaded programs that have
+ *  finished compiling (without waiting for the rest). Does nothing unless hot-reload is enabled.
+ *  @note must not be called while a pass is being executed (it is called from PostProcessingEffect::PreRender)
+ */
+void FragmentProgramRegistry::Update() {
+    if (!hotReload) return;
+
+    vector<string> changed = ShaderFileWatcher::GetChangedFiles();
+    for (unsigned int i=0; i<changed.size(); i++)
+	ShaderSourceStore::Invalidate(changed.at(i));
+
+    map<string, boost::weak_ptr<LinkedProgram> >::iterator it = programs.begin();
+    while (it != programs.end()) {
+	LinkedProgramPtr program = it->second.lock();
+	if (program.get() == NULL) {
+	    programs.erase(it++);
+	    continue;
+	}
+
+	if (!changed.empty()) {
+	    vector<string> files = program->GetSourceFiles();
+	    for (unsigned int i=0; i<changed.size(); i++)
+		if (find(files.begin(), files.end(), changed.at(i)) != files.end()) {
+		    program->Reload();
+		    break;
+		}
+	}
+
+	// (a new version of the program might include other files than before)
+	if (program->SwapIfReady()) WatchSourceFiles(program);
+	it++;
+    }
+}
+
+void FragmentProgramRegistry::WatchSourceFiles(LinkedProgramPtr program) {
+    vector<string> files = program->GetSourceFiles();
+    for (unsigned int i=0; i<files.size(); i++)
+	ShaderFileWatcher::Watch(files.at(i));
+}
+
+/* resolve the filenames through the DirectoryManager and sort them, so that the same set of
+   files always gives the same key (the order of the shaders doesn't matter when linking) */
+vector<string> FragmentProgramRegistry::Canonicalize(vector<string> filenames) {
+    vector<string> canonical;
+    for (unsigned int i=0; i<filenames.size(); i++)
+	canonical.push_back(DirectoryManager::FindFileInPath(filenames.at(i)));
+    sort(canonical.begin(), canonical.end());
+    return canonical;
+}
+
+string FragmentProgramRegistry::MakeKey(vector<string> canonicalFilenames, ShaderDefines defines) {
+    string key;
+    for (unsigned int i=0; i<canonicalFilenames.size(); i++)
+	key += canonicalFilenames.at(i) + "\n";
+    return key + ShaderPreprocessor::MakeKey(defines); // <- the permutation key
+
+}
+
+} // NS Resources
+} // NS OpenEngine
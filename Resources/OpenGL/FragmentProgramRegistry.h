@@ -0,0 +1,48 @@
+#ifndef __FRAGMENTPROGRAMREGISTRY_H__
+#define __FRAGMENTPROGRAMREGISTRY_H__
+
+#include <Resources/OpenGL/LinkedProgram.h>
+#include <Resources/ShaderFileWatcher.h>
+#include <boost/weak_ptr.hpp>
+
+#include <vector>
+#include <string>
+#include <map>
+
+namespace OpenEngine {
+namespace Resources {
+
+using namespace std;
+
+/** Keeps one LinkedProgram per distinct set of fragment program sources and defines, so that passes and
+ *  effects using the same .frag files share one compiled and linked GL program object, and each variant
+ *  (set of defines) is only compiled once.
+ *  Programs are only held weakly: when the last FragmentProgram using a program is deleted,
+ *  the GL objects are deleted as well.
+ *  With hot-reload enabled, programs are recompiled when their files change (see Update).
+ */
+class FragmentProgramRegistry {
+
+  private:
+
+    static map<string, boost::weak_ptr<LinkedProgram> > programs;
+    static bool hotReload;
+
+    static void WatchSourceFiles(LinkedProgramPtr program);
+
+    static vector<string> Canonicalize(vector<string> filenames);
+    static string MakeKey(vector<string> canonicalFilenames, ShaderDefines defines);
+
+  public:
+
+    static LinkedProgramPtr GetProgram(vector<string> filenames, ShaderDefines defines = ShaderDefines());
+
+    static void EnableHotReload(bool enable);
+    static bool IsHotReloadEnabled();
+    static void Update(); // reload changed programs and swap in the finished ones (called once per frame)
+};
+
+} // NS Resources
+} // NS OpenEngine
+
+#endif
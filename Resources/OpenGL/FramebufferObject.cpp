@@ -32,6 +32,9 @@ FramebufferObject::FramebufferObject() {
     for (int i=0; i<16; i++) colorAttachments[i].reset();
     depthAttachment.reset();
     stencilAttachment.reset();
+    for (int i=0; i<16; i++) colorAttachmentIDs[i] = 0;
+    depthAttachmentID   = 0;
+    stencilAttachmentID = 0;
 
     GuardedUnbind();
 }
@@ -63,7 +66,7 @@ void FramebufferObject::Unbind() {
  */
 void FramebufferObject::AttachColorRenderBuffer(IRenderBufferPtr rb, int attachmentPoint) {
     if (attachmentPoint < 0 || attachmentPoint >= maxNumColorAttachments) throw PPEResourceException("illegal attachmentPoint");
-    if (rb->GetFormat()!=RB_RGB && rb->GetFormat()!=RB_RGBA) throw PPEResourceException("non-color renderbuffers can't be attached as color attachments");
+    if (rb->GetFormat()==RB_DEPTH || rb->GetFormat()==RB_STENCIL || rb->GetFormat()==RB_DEPTH_STENCIL) throw PPEResourceException("non-color renderbuffers can't be attached as color attachments");
 
     GuardedBind();
     glFramebufferRenderbufferEXT(GL_FRAMEBUFFER_EXT, colorAttachmentEnums[attachmentPoint], GL_RENDERBUFFER_EXT, rb->GetID());
@@ -71,8 +74,10 @@ void FramebufferObject::AttachColorRenderBuffer(IRenderBufferPtr rb, int attachm
     // check if it really got attached (i'm not quite sure that all FBO-errors means that it didn't get attached, so that's why i'm not simply checking for errors here)
     if (GetAttachmentType(colorAttachmentEnums[attachmentPoint]) != GL_RENDERBUFFER_EXT || GetAttachmentID(colorAttachmentEnums[attachmentPoint]) != rb->GetID())
 	{GuardedUnbind(); throw PPEResourceException("attaching failed");} // maybe it should not cast an exception..
-    else
-        colorAttachments[attachmentPoint] = rb;
+    else {
+        colorAttachments[attachmentPoint]   = rb;
+        colorAttachmentIDs[attachmentPoint] = rb->GetID();
+    }
 
     GuardedUnbind();
 }
@@ -82,7 +87,7 @@ void FramebufferObject::AttachColorRenderBuffer(IRenderBufferPtr rb, int attachm
  * @exception PPEResourceException thrown if the supplied renderbuffer doesn't doesn't have a depth internal format
  */
 void FramebufferObject::AttachDepthRenderBuffer(IRenderBufferPtr rb) {
-    if (rb->GetFormat()!=RB_DEPTH) throw PPEResourceException("non-depth renderbuffers can't be attached as depth attachments");
+    if (rb->GetFormat()!=RB_DEPTH && rb->GetFormat()!=RB_DEPTH_STENCIL) throw PPEResourceException("non-depth renderbuffers can't be attached as depth attachments");
 
     GuardedBind();
     glFramebufferRenderbufferEXT(GL_FRAMEBUFFER_EXT, GL_DEPTH_ATTACHMENT_EXT, GL_RENDERBUFFER_EXT, rb->GetID());
@@ -90,8 +95,10 @@ void FramebufferObject::AttachDepthRenderBuffer(IRenderBufferPtr rb) {
     // check if it really got attached (i'm not quite sure that all FBO-errors means that it didn't get attached, so that's why i'm not simply checking for errors here)
     if (GetAttachmentType(GL_DEPTH_ATTACHMENT_EXT) != GL_RENDERBUFFER_EXT || GetAttachmentID(GL_DEPTH_ATTACHMENT_EXT) != rb->GetID())
 	{GuardedUnbind(); throw PPEResourceException("attaching failed");}// maybe it should not cast an exception..
-    else
-        depthAttachment = rb;
+    else {
+        depthAttachment   = rb;
+        depthAttachmentID = rb->GetID();
+    }
 
     GuardedUnbind();
 }
@@ -101,7 +108,7 @@ void FramebufferObject::AttachDepthRenderBuffer(IRenderBufferPtr rb) {
  * @exception PPEResourceException thrown if the supplied renderbuffer doesn't doesn't have a stencil internal format
  */
 void FramebufferObject::AttachStencilRenderBuffer(IRenderBufferPtr rb) {
-    if (rb->GetFormat()!=RB_STENCIL) throw PPEResourceException("non-stencil renderbuffers can't be attached as stencil attachments");
+    if (rb->GetFormat()!=RB_STENCIL && rb->GetFormat()!=RB_DEPTH_STENCIL) throw PPEResourceException("non-stencil renderbuffers can't be attached as stencil attachments");
 
     GuardedBind();
     glFramebufferRenderbufferEXT(GL_FRAMEBUFFER_EXT, GL_STENCIL_ATTACHMENT_EXT, GL_RENDERBUFFER_EXT, rb->GetID());
@@ -109,8 +116,10 @@ void FramebufferObject::AttachStencilRenderBuffer(IRenderBufferPtr rb) {
     // check if it really got attached (i'm not quite sure that all FBO-errors means that it didn't get attached, so that's why i'm not simply checking for errors here)
     if (GetAttachmentType(GL_STENCIL_ATTACHMENT_EXT) != GL_RENDERBUFFER_EXT || GetAttachmentID(GL_STENCIL_ATTACHMENT_EXT) != rb->GetID())
 	{GuardedUnbind(); throw PPEResourceException("attaching failed");}// maybe it should not cast an exception..
-    else
-        stencilAttachment = rb;
+    else {
+        stencilAttachment   = rb;
+        stencilAttachmentID = rb->GetID();
+    }
 
     GuardedUnbind();
 }
@@ -123,7 +132,7 @@ void FramebufferObject::AttachStencilRenderBuffer(IRenderBufferPtr rb) {
  */
 void FramebufferObject::AttachColorTexture(ITexture2DPtr tex, int attachmentPoint) {
     if (attachmentPoint < 0 || attachmentPoint >= maxNumColorAttachments) throw PPEResourceException("illegal attachmentPoint");
-    if (tex->GetFormat()!=TEX_RGB && tex->GetFormat()!=TEX_RGBA && tex->GetFormat()!=TEX_RGB_FLOAT && tex->GetFormat()!=TEX_RGBA_FLOAT)
+    if (tex->GetFormat()==TEX_DEPTH || tex->GetFormat()==TEX_DEPTH_STENCIL || tex->GetFormat()==TEX_LUMINANCE || tex->GetFormat()==TEX_LUMINANCE_FLOAT) // <- (luminance isn't color-renderable)
         throw PPEResourceException("non-color textures can't be attached as color attachments");
 
     GuardedBind();
@@ -132,8 +141,10 @@ void FramebufferObject::AttachColorTexture(ITexture2DPtr tex, int attachmentPoin
     // check if it really got attached (i'm not quite sure that all FBO-errors means that it didn't get attached, so that's why i'm not simply checking for errors here)
     if (GetAttachmentType(colorAttachmentEnums[attachmentPoint]) != GL_TEXTURE || GetAttachmentID(colorAttachmentEnums[attachmentPoint]) != tex->GetID())
 	{GuardedUnbind(); throw PPEResourceException("attaching failed");}// maybe it should not cast an exception..
-    else
-        colorAttachments[attachmentPoint] = tex;
+    else {
+        colorAttachments[attachmentPoint]   = tex;
+        colorAttachmentIDs[attachmentPoint] = tex->GetID();
+    }
 
     GuardedUnbind();
 }
@@ -151,8 +162,10 @@ void FramebufferObject::AttachDepthTexture(ITexture2DPtr tex) {
     // check if it really got attached (i'm not quite sure that all FBO-errors means that it didn't get attached, so that's why i'm not simply checking for errors here)
     if (GetAttachmentType(GL_DEPTH_ATTACHMENT_EXT) != GL_TEXTURE || GetAttachmentID(GL_DEPTH_ATTACHMENT_EXT) != tex->GetID())
 	{GuardedUnbind(); throw PPEResourceException("attaching failed");}// maybe it should not cast an exception..
-    else
-        depthAttachment = tex;
+    else {
+        depthAttachment   = tex;
+        depthAttachmentID = tex->GetID();
+    }
 
     GuardedUnbind();
 }
@@ -170,12 +183,34 @@ void FramebufferObject::AttachStencilTexture(ITexture2DPtr tex) {
     // check if it really got attached (i'm not quite sure that all FBO-errors means that it didn't get attached, so that's why i'm not simply checking for errors here)
     if (GetAttachmentType(GL_STENCIL_ATTACHMENT_EXT) != GL_TEXTURE || GetAttachmentID(GL_STENCIL_ATTACHMENT_EXT) != tex->GetID())
 	{GuardedUnbind(); throw PPEResourceException("attaching failed");}// maybe it should not cast an exception..
-    else
-        stencilAttachment = tex;
+    else {
+        stencilAttachment   = tex;
+        stencilAttachmentID = tex->GetID();
+    }
 
     GuardedUnbind();
 }
 
+/** Attach renderbuffer with packed depth-stencil format as both the depth and the stencil attachment
+ * @param rb the renderbuffer to attach
+ * @exception PPEResourceException thrown if the supplied renderbuffer doesn't have the depth-stencil internal format
+ */
+void FramebufferObject::AttachDepthStencilRenderBuffer(IRenderBufferPtr rb) {
+    if (rb->GetFormat()!=RB_DEPTH_STENCIL) throw PPEResourceException("non-depth-stencil renderbuffers can't be attached as depth-stencil attachments");
+    AttachDepthRenderBuffer(rb);
+    AttachStencilRenderBuffer(rb);
+}
+
+/** Attach texture with packed depth-stencil format as both the depth and the stencil attachment
+ * @param tex the texture to attach
+ * @exception PPEResourceException thrown if the supplied texture doesn't have the depth-stencil internal format
+ */
+void FramebufferObject::AttachDepthStencilTexture(ITexture2DPtr tex) {
+    if (tex->GetFormat()!=TEX_DEPTH_STENCIL) throw PPEResourceException("non-depth-stencil textures can't be attached as depth-stencil attachments");
+    AttachDepthTexture(tex);
+    AttachStencilTexture(tex);
+}
+
 /** Detach color attachment at the supplied attachmentpoint
  * @exception PPEResourceException thrown if illegal attachmentPoint (less than 0 or grater than FramebufferObject::GetMaxNumColorAttachments)
  */
@@ -184,6 +219,7 @@ void FramebufferObject::DetachColorAttachment(int attachmentPoint) {
     GuardedBind();
     glFramebufferRenderbufferEXT(GL_FRAMEBUFFER_EXT, colorAttachmentEnums[attachmentPoint], GL_RENDERBUFFER_EXT, 0);
     colorAttachments[attachmentPoint].reset();
+    colorAttachmentIDs[attachmentPoint] = 0;
     GuardedUnbind();
 }
 
@@ -193,6 +229,7 @@ void FramebufferObject::DetachDepthAttachment() {
     GuardedBind();
     glFramebufferRenderbufferEXT(GL_FRAMEBUFFER_EXT, GL_DEPTH_ATTACHMENT_EXT, GL_RENDERBUFFER_EXT, 0);
     depthAttachment.reset();
+    depthAttachmentID = 0;
     GuardedUnbind();
 }
 
@@ -202,9 +239,30 @@ void FramebufferObject::DetachStencilAttachment() {
     GuardedBind();
     glFramebufferRenderbufferEXT(GL_FRAMEBUFFER_EXT, GL_STENCIL_ATTACHMENT_EXT, GL_RENDERBUFFER_EXT, 0);
     stencilAttachment.reset();
+    stencilAttachmentID = 0;
     GuardedUnbind();
 }
 
+/** Attach the attached textures again, if they have moved to a new texture-handle since they were attached (a texture with
+ *  immutable storage or a bindless handle does that when it is resized or its settings are changed - the FBO would still
+ *  refer to the deleted texture). Only compares the handles, so it is cheap to call before each use of the FBO.
+ */
+void FramebufferObject::RefreshAttachments() {
+    for (int i=0; i<maxNumColorAttachments; i++) {
+	if (colorAttachments[i].get() == NULL || (GLuint)colorAttachments[i]->GetID() == colorAttachmentIDs[i]) continue;
+	ITexture2DPtr tex = boost::dynamic_pointer_cast<ITexture2D>(colorAttachments[i]);
+	if (tex.get() != NULL) AttachColorTexture(tex, i);
+    }
+    if (depthAttachment.get() != NULL && (GLuint)depthAttachment->GetID() != depthAttachmentID) {
+	ITexture2DPtr tex = boost::dynamic_pointer_cast<ITexture2D>(depthAttachment);
+	if (tex.get() != NULL) AttachDepthTexture(tex);
+    }
+    if (stencilAttachment.get() != NULL && (GLuint)stencilAttachment->GetID() != stencilAttachmentID) {
+	ITexture2DPtr tex = boost::dynamic_pointer_cast<ITexture2D>(stencilAttachment);
+	if (tex.get() != NULL) AttachStencilTexture(tex);
+    }
+}
+
 /** Get maximum number of color-attachments allowed for FBOs on this gfx-card.
  *  (legal attachment-points are 0,1,...,FramebufferObject::GetMaxNumColorAttachments() - 1)
  *  @returns max number of color-attachments on this gfx-card
@@ -31,6 +31,11 @@ class FramebufferObject : public IFramebufferObject {
     IImagePtr depthAttachment;
     IImagePtr stencilAttachment;
 
+    // the handles they had when they were attached (see RefreshAttachments)
+    GLuint colorAttachmentIDs[16];
+    GLuint depthAttachmentID;
+    GLuint stencilAttachmentID;
+
     // helper array - contains all the enums for the color attachment points
     static const GLenum colorAttachmentEnums[];
 
@@ -57,15 +62,19 @@ class FramebufferObject : public IFramebufferObject {
     void AttachColorRenderBuffer  (IRenderBufferPtr rb, int attachmentPoint);
     void AttachDepthRenderBuffer  (IRenderBufferPtr rb);
     void AttachStencilRenderBuffer(IRenderBufferPtr rb);
+    void AttachDepthStencilRenderBuffer(IRenderBufferPtr rb);
 
     void AttachColorTexture(ITexture2DPtr tex, int attachmentPoint);
     void AttachDepthTexture(ITexture2DPtr tex);
     void AttachStencilTexture(ITexture2DPtr tex);
+    void AttachDepthStencilTexture(ITexture2DPtr tex);
 
     void DetachColorAttachment  (int attachmentPoint); // ok bare at brug rb'er? Eller skal man detache for den resource type der er bundet?
     void DetachDepthAttachment  ();
     void DetachStencilAttachment();
 
+    void RefreshAttachments(); // attach the textures again which have moved to a new texture-handle since they were attached
+
     /* must be called after all color attachments you want to render to are attached, and before drawing, to select which color bufs to render to */
     /* the selected buffers will be remembered through bind, undbind (etc) calls, and applies to this FBO only! */
     void SelectDrawBuffers(); // <- sets default (=all attached buffers are targets in order (incl. GL_NONE) (buf0=att0, buf1=att1, ...) - so COLOR0 in the shader corresponds to ATT0, etc)
@@ -0,0 +1,103 @@
+#include "GpuTimer.h"
+
+#include <string.h>
+
+namespace OpenEngine {
+namespace Resources {
+
+int GpuTimer::timerQuery = -1;
+GpuTimer* GpuTimer::active = NULL;
+
+/** Create a timer.
+ *  @param[in] numQueries the number of queries in the ring (the number of measurements which can be pending at once)
+ */
+GpuTimer::GpuTimer(int numQueries) {
+    if (numQueries < 1) throw PPEResourceException("at least one query is needed");
+    this->queryIDs.resize(numQueries, 0); // (generated on the first Begin, as OpenGL might not be initialized at this point)
+    this->current   = 0;
+    this->pending   = 0;
+    this->measuring = false;
+    this->lastTime  = -1;
+}
+
+GpuTimer::~GpuTimer() {
+    if (active == this) active = NULL;
+#ifdef GL_EXT_timer_query
+    if (queryIDs.at(0) != 0) glDeleteQueries(queryIDs.size(), &queryIDs[0]);
+#endif
+}
+
+/** Start measuring (the GL commands issued until End is called)
+ */
+void GpuTimer::Begin() {
+    if (measuring) throw PPEResourceException("already measuring");
+    if (!IsSupported()) return;
+    if (active != NULL) return; // <- another timer is measuring (it includes these commands - the queries can't be nested)
+#ifdef GL_EXT_timer_query
+    if (queryIDs.at(0) == 0) glGenQueries(queryIDs.size(), &queryIDs[0]);
+
+    ReadResults();
+    if (pending == (int)queryIDs.size()) return; // <- all queries are pending (skip this measurement rather than wait)
+    glBeginQuery(GL_TIME_ELAPSED_EXT, queryIDs.at(current));
+    measuring = true;
+    active    = this;
+#endif
+}
+
+/** Stop measuring
+ */
+void GpuTimer::End() {
+    if (!measuring) return;
+#ifdef GL_EXT_timer_query
+    glEndQuery(GL_TIME_ELAPSED_EXT);
+    measuring = false;
+    active    = NULL;
+    current = (current + 1) % queryIDs.size();
+    pending++;
+#endif
+}
+
+/** Get the latest measurement which is available (without waiting for the GPU)
+ *  @param[out] milliseconds the time the GPU took
+ *  @return false if no measurement is available yet
+ */
+bool GpuTimer::GetTime(float& milliseconds) {
+    ReadResults();
+    if (lastTime < 0) return false;
+    milliseconds = lastTime;
+    return true;
+}
+
+// read the pending queries which are available (oldest first - they finish in order)
+void GpuTimer::ReadResults() {
+#ifdef GL_EXT_timer_query
+    while (pending > 0) {
+	GLuint queryID = queryIDs.at((current - pending + queryIDs.size()) % queryIDs.size());
+	GLint available = 0;
+	glGetQueryObjectiv(queryID, GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available) break;
+
+	GLuint64EXT nanoseconds = 0;
+	glGetQueryObjectui64vEXT(queryID, GL_QUERY_RESULT, &nanoseconds);
+	lastTime = nanoseconds / 1000000.0f;
+	pending--;
+    }
+#endif
+}
+
+/** whether the GPU time can be measured (GL_EXT_timer_query)
+ */
+bool GpuTimer::IsSupported() {
+    if (timerQuery == -1) {
+#ifdef GL_EXT_timer_query
+	const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+	timerQuery = (extensions != NULL && strstr(extensions, "GL_EXT_timer_query") != NULL) ? 1 : 0;
+#else
+	timerQuery = 0;
+#endif
+    }
+    return timerQuery == 1;
+}
+
+} // NS Resources
+} // NS OpenEngine
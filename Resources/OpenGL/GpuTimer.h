@@ -0,0 +1,53 @@
+#ifndef __GPUTIMER_H__
+#define __GPUTIMER_H__
+
+#include <Resources/PPEResourceException.h>
+#include <Logging/Logger.h>
+
+#include <Meta/OpenGL.h>
+#include <vector>
+
+namespace OpenEngine {
+namespace Resources {
+
+using namespace std;
+
+/** Measures how long the GPU takes to execute the GL commands issued between Begin and End (f.e. a pass), without
+ *  stalling the pipeline: a ring of timer queries is used, and a measurement is only read when it is available
+ *  (usually a frame or two later). If all queries of the ring are still pending, Begin/End measures nothing.
+ *  Only one timer can measure at a time (timer queries can't be nested): Begin measures nothing while another timer is
+ *  measuring - f.e. the passes of an effect executed inside the timed scene of another effect (a MergeNode).
+ *  @note GL_EXT_timer_query only - without it no times are ever available (see IsSupported)
+ */
+class GpuTimer {
+
+  private:
+
+    vector<GLuint> queryIDs;
+    int  current;  // the query to begin next
+    int  pending;  // number of queries ended, but not read yet
+    bool measuring;
+    float lastTime; // the latest available measurement in milliseconds (-1 = none yet)
+
+    static int timerQuery; // -1 = not checked yet
+    static GpuTimer* active; // the timer measuring now (NULL = none)
+
+    void ReadResults();
+
+  public:
+
+    GpuTimer(int numQueries = 4);
+    ~GpuTimer();
+
+    void Begin();
+    void End();
+
+    bool GetTime(float& milliseconds); // the latest available measurement (false if there is none yet)
+
+    static bool IsSupported();
+};
+
+} // NS Resources
+} // NS OpenEngine
+
+#endif
@@ -0,0 +1,447 @@
+#include "LinkedProgram.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <algorithm>
+
+// from GL_KHR_parallel_shader_compile / GL_ARB_parallel_shader_compile (not in all headers yet)
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace OpenEngine {
+namespace Resources {
+
+int LinkedProgram::parallelCompile = -1;
+
+/**
+ * compile and link a program from the given files (only called by FragmentProgramRegistry)
+ * The compile and link commands are only submitted here. If the driver compiles in the background
+ * (GL_KHR_parallel_shader_compile), this returns immediately and the status is first checked in Resolve.
+ * @param[in] filenames the resolved filenames of the files containing the GLSL fragmentprogram sourcecode
+ * @param[in] defines the defines to inject into each of the files (see ShaderPreprocessor)
+ */
+// se : http://www.lighthouse3d.com/opengl/glsl/index.php?oglshader
+LinkedProgram::LinkedProgram(vector<string> filenames, ShaderDefines defines) {
+    this->filenames        = filenames;
+    this->defines          = defines;
+    this->programID        = 0;
+    this->pendingProgramID = 0;
+    this->generation       = 0;
+    this->stateOwner       = NULL;
+    this->resolved         = false;
+    this->samplerUnitsAssigned = false;
+    this->nextSamplerUnit  = 0;
+    this->usesBindless     = false;
+    this->pendingUsesBindless = false;
+
+    // let the driver use as many compiler threads as it likes (only needs to be done once)
+    HasParallelCompile();
+
+    Submit(shaderIDs, programID, sourceFiles, usesBindless);
+}
+
+/* whether the file is a vertex shader (by the extension .vert) - all other files are fragment shaders.
+   (a program only needs a vertex shader if it doesn't draw the screen quad, f.e. Histogram scattering points) */
+bool LinkedProgram::IsVertexShader(string filename) {
+    return filename.size() >= 5 && filename.compare(filename.size() - 5, 5, ".vert") == 0;
+}
+
+/* whether the source enables GL_ARB_bindless_texture - only then may its samplers be given handles (see FragmentProgram::BindTexture) */
+bool LinkedProgram::EnablesBindlessTextures(ShaderPreprocessor& source) {
+    static const char* name = "GL_ARB_bindless_texture";
+    for (int i=0; i<source.GetSegmentCount(); i++) {
+	const char* segment = source.GetSegments()[i];
+	const char* end     = segment + source.GetSegmentLengths()[i];
+	if (std::search(segment, end, name, name + strlen(name)) != end) return true; // <- the segments are not null-terminated
+    }
+    return false;
+}
+
+/* create the shaders and the program, and submit the compiles and the link */
+void LinkedProgram::Submit(vector<GLuint>& shaderIDs, GLuint& programID, vector<vector<string> >& sourceFiles, bool& usesBindless) {
+    // tell the fragment programs whether uniform blocks are real uniform blocks or ordinary uniforms (see UniformBlock)
+    ShaderDefines defines = this->defines;
+    if (UniformBlock::IsSupported()) defines["PPE_UNIFORM_BUFFERS"] = "1";
+    if (BindlessTextures::IsEnabled()) defines["PPE_BINDLESS_TEXTURES"] = "1"; // <- samplers are given handles (see BindlessTextures)
+
+    // create the shaders
+    for (unsigned int i=0; i<filenames.size(); i++) {
+	ShaderPreprocessor source(filenames.at(i), defines); // <- expands #includes and injects the defines (without copying the files)
+	sourceFiles.push_back(source.GetFiles());
+	if (EnablesBindlessTextures(source)) usesBindless = true;
+	GLuint shaderID = glCreateShader(IsVertexShader(filenames.at(i)) ? GL_VERTEX_SHADER : GL_FRAGMENT_SHADER);
+	shaderIDs.push_back(shaderID);
+	glShaderSource(shaderID, source.GetSegmentCount(), (const GLchar**)source.GetSegments(), (const GLint*)source.GetSegmentLengths()); // <- the segments are not null-terminated, so the lengths are given
+	glCompileShader(shaderID);
+    }
+
+    // create a program (link all the shaders together to create the executable shader program)
+    // (no need to wait for the compiles - a link of unfinished shaders is queued behind them)
+    programID = glCreateProgram();
+    for (unsigned int i=0; i<shaderIDs.size(); i++)
+        glAttachShader(programID, shaderIDs.at(i));
+    glLinkProgram(programID);
+}
+
+/* delete the shaders and the program */
+void LinkedProgram::Delete(vector<GLuint>& shaderIDs, GLuint& programID) {
+    for (unsigned int i=0; i<shaderIDs.size(); i++)
+        glDeleteShader(shaderIDs.at(i));
+    glDeleteProgram(programID);
+    shaderIDs.clear();
+    programID = 0;
+}
+
+/** Check the compile and link status of the program and log errors and warnings.
+ *  Waits for the driver to finish if block is true, otherwise it only resolves the program if compiling
+ *  and linking has already finished in the background.
+ *  @param[in] block whether to wait for the compile and link to finish
+ *  @return whether the program has been resolved
+ */
+bool LinkedProgram::Resolve(const bool block) {
+    if (resolved) return true;
+    if (!block && !IsCompletionReady(programID)) return false;
+    resolved = true;
+    CheckStatus(shaderIDs, programID, sourceFiles);
+    return true;
+}
+
+/* log the compiler and linker output, and return whether the program linked */
+bool LinkedProgram::CheckStatus(vector<GLuint>& shaderIDs, GLuint programID, vector<vector<string> >& sourceFiles) {
+    // print errors and warnings to logger
+    for (unsigned int i=0; i<shaderIDs.size(); i++) {
+	GLuint shaderID = shaderIDs.at(i);
+	GLsizei bufSize;
+	glGetShaderiv(shaderID, GL_INFO_LOG_LENGTH, &bufSize);
+	GLsizei length;
+	char*   infoLog = new char[bufSize];
+	glGetShaderInfoLog(shaderID, bufSize, &length, infoLog);
+	if (length>0) {
+	    // (the source string numbers are replaced with the names of the files, see ShaderPreprocessor)
+	    logger.error << "\"" << filenames.at(i) << "\" compiler output:\n"
+			 << ShaderPreprocessor::MapCompilerOutput(infoLog, sourceFiles.at(i)) << logger.end;
+	}
+	delete[] infoLog;
+    }
+
+    // print errors and warnings to logger (only if real errors, otherwise it will just repeat the shader errors)
+    GLint programLinkOk;
+    glGetProgramiv(programID, GL_LINK_STATUS, &programLinkOk);
+    if (!programLinkOk) {
+	GLsizei bufSize;
+	glGetProgramiv(programID, GL_INFO_LOG_LENGTH, &bufSize);
+	GLsizei length;
+	char*   infoLog = new char[bufSize];
+	glGetProgramInfoLog(programID, bufSize, &length, infoLog);
+	if (length>0) {
+	    for (unsigned int i=0; i<filenames.size(); i++) logger.error << "\"" << filenames.at(i) << "\" ";
+	    logger.error << "linker output:\n" << infoLog << logger.end;
+	}
+	delete[] infoLog;
+    }
+    return programLinkOk == GL_TRUE;
+}
+
+/* whether the driver is done compiling and linking (always true if it can't tell us without blocking) */
+bool LinkedProgram::IsCompletionReady(GLuint programID) {
+    if (!HasParallelCompile()) return true;
+    GLint done;
+    glGetProgramiv(programID, GL_COMPLETION_STATUS_KHR, &done);
+    return done == GL_TRUE;
+}
+
+/* check for GL_KHR_parallel_shader_compile or GL_ARB_parallel_shader_compile (the first time), and turn it on */
+bool LinkedProgram::HasParallelCompile() {
+    if (parallelCompile == -1) {
+	const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+	parallelCompile = (extensions != NULL &&
+			   (strstr(extensions, "GL_KHR_parallel_shader_compile") != NULL ||
+			    strstr(extensions, "GL_ARB_parallel_shader_compile") != NULL)) ? 1 : 0;
+#if defined(GL_KHR_parallel_shader_compile)
+	if (parallelCompile) glMaxShaderCompilerThreadsKHR(0xFFFFFFFF); // <- 0xFFFFFFFF = implementation-dependent maximum
+#elif defined(GL_ARB_parallel_shader_compile)
+	if (parallelCompile) glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+#endif
+    }
+    return parallelCompile == 1;
+}
+
+LinkedProgram::~LinkedProgram() {
+    Delete(shaderIDs, programID);
+    if (pendingProgramID != 0) Delete(pendingShaderIDs, pendingProgramID);
+}
+
+/** Compile and link the program again from its source files (which have changed on disk).
+ *  Like the first time, the compile is only submitted - the new program replaces the current one in
+ *  SwapIfReady, when it is done. Until then (and if it fails) the current program is used.
+ *  Never throws - if the sources can't be loaded, the error is logged and the current program is kept.
+ */
+void LinkedProgram::Reload() {
+    // a reload which hasn't finished yet is out of date
+    if (pendingProgramID != 0) Delete(pendingShaderIDs, pendingProgramID);
+    pendingSourceFiles.clear();
+    pendingUsesBindless = false;
+
+    // (the editor might be in the middle of saving the file - the next save will trigger a new reload)
+    for (unsigned int i=0; i<filenames.size(); i++) {
+	FILE* fp = fopen(filenames.at(i).c_str(), "rb");
+	if (fp == NULL) {
+	    logger.error << "\"" << filenames.at(i) << "\" could not be opened - keeping the old program" << logger.end;
+	    return;
+	}
+	fclose(fp);
+    }
+
+    // (hot-reload must never stop the frame - f.e. an #include of a file that doesn't exist (yet) just keeps the old program)
+    try {
+	Submit(pendingShaderIDs, pendingProgramID, pendingSourceFiles, pendingUsesBindless);
+    } catch (PPEResourceException& e) {
+	logger.error << "reload of \"" << filenames.at(0) << "\" failed: " << e.toString() << " - keeping the old program" << logger.end;
+	Delete(pendingShaderIDs, pendingProgramID); // <- the shaders submitted before the failing one
+	pendingSourceFiles.clear();
+    }
+}
+
+/** Replace the program with the reloaded one, if a reload has finished compiling.
+ *  If the reloaded program failed to compile or link, the errors are logged and the current program is kept.
+ *  The uniform locations are looked up again, so the FragmentPrograms using the program keep their uniform
+ *  values and texture bindings.
+ *  @param[in] block whether to wait for the reload to finish compiling
+ *  @return whether the program was replaced
+ */
+bool LinkedProgram::SwapIfReady(const bool block) {
+    if (pendingProgramID == 0) return false;
+    if (!block && !IsCompletionReady(pendingProgramID)) return false;
+
+    Resolve(); // <- the old program must be resolved (and its errors logged) before it is replaced
+    if (!CheckStatus(pendingShaderIDs, pendingProgramID, pendingSourceFiles)) {
+	logger.error << "reload of \"" << filenames.at(0) << "\" failed - keeping the old program" << logger.end;
+	Delete(pendingShaderIDs, pendingProgramID);
+	return false;
+    }
+
+    Delete(shaderIDs, programID);
+    shaderIDs   = pendingShaderIDs;
+    programID   = pendingProgramID;
+    sourceFiles = pendingSourceFiles;
+    usesBindless = pendingUsesBindless;
+    pendingShaderIDs.clear();
+    pendingProgramID = 0;
+
+    uniformLocations.clear();
+    uniformBlockBindings.clear();
+    samplerUnits.clear();
+    samplerUnitsAssigned = false;
+    stateOwner = NULL; // <- the new program object has no uniform values yet
+    generation++;
+    logger.info << "reloaded \"" << filenames.at(0) << "\"" << logger.end;
+    return true;
+}
+
+/** get the number of times the program has been replaced by a reload (uniform locations from before are invalid)
+ */
+int LinkedProgram::GetGeneration() {
+    return generation;
+}
+
+/** get all the files the program is made from (including the included files)
+ */
+vector<string> LinkedProgram::GetSourceFiles() {
+    vector<string> files;
+    for (unsigned int i=0; i<sourceFiles.size(); i++)
+	files.insert(files.end(), sourceFiles.at(i).begin(), sourceFiles.at(i).end());
+    return files;
+}
+
+/** get the OpenGL handle of the program object (waits for it to be compiled and linked)
+ */
+GLuint LinkedProgram::GetID() {
+    Resolve();
+    return programID;
+}
+
+/** get the location of a uniform (looked up once per program, not once per pass)
+ *  @param[in] parameterName the name of the uniform
+ *  @return the location, or -1 if the uniform does not exist (an error is logged the first time)
+ */
+GLint LinkedProgram::GetUniformLocation(string parameterName) {
+    map<string, GLint>::iterator it = uniformLocations.find(parameterName);
+    if (it != uniformLocations.end()) return it->second;
+
+    Resolve(); // locations are not known before the program is linked
+    GLint paramID = glGetUniformLocation(programID, parameterName.c_str());
+    if (paramID == -1) logger.error << "uniform \"" << parameterName << "\" does not exist" << logger.end;
+    uniformLocations[parameterName] = paramID;
+    return paramID;
+}
+
+/** whether the program enables GL_ARB_bindless_texture (if not, its samplers must be given texture units - see FragmentProgram)
+ */
+bool LinkedProgram::UsesBindlessTextures() {
+    return usesBindless;
+}
+
+/** get the texture unit of a sampler uniform
+ *  @param[in] parameterName the name of the sampler
+ *  @return the texture unit, or -1 if the sampler does not exist (an error is logged)
+ */
+int LinkedProgram::GetSamplerUnit(string parameterName) {
+    if (!samplerUnitsAssigned) AssignSamplerUnits();
+
+    map<string, int>::iterator it = samplerUnits.find(parameterName);
+    if (it != samplerUnits.end()) return it->second;
+
+    // a sampler of a type IsSamplerType doesn't know (f.e. from a newer GL version), or any sampler of a bindless program, is
+    // given the next unit by name
+    GLint location = GetUniformLocation(parameterName);
+    if (location == -1) return -1; // <- (logged by GetUniformLocation)
+    GLint maxUnits;
+    glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &maxUnits);
+    if (nextSamplerUnit >= maxUnits) {
+	logger.error << "too many samplers - \"" << parameterName << "\" gets no texture unit" << logger.end;
+	return -1;
+    }
+    GLint savedProgID;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &savedProgID);
+    glUseProgram(programID);
+    glUniform1i(location, nextSamplerUnit);
+    glUseProgram(savedProgID);
+    samplerUnits[parameterName] = nextSamplerUnit;
+    return nextSamplerUnit++;
+}
+
+/* whether a uniform type is a sampler (of any dimension, and with float, int or unsigned int texels) */
+bool LinkedProgram::IsSamplerType(GLenum type) {
+    switch (type) {
+	case GL_SAMPLER_1D: case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE:
+	case GL_SAMPLER_1D_SHADOW: case GL_SAMPLER_2D_SHADOW:
+	case GL_SAMPLER_2D_RECT_ARB: case GL_SAMPLER_2D_RECT_SHADOW_ARB:
+#ifdef GL_VERSION_3_0
+	case GL_SAMPLER_1D_ARRAY: case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_1D_ARRAY_SHADOW: case GL_SAMPLER_2D_ARRAY_SHADOW:
+	case GL_SAMPLER_CUBE_SHADOW:
+	case GL_INT_SAMPLER_1D: case GL_INT_SAMPLER_2D: case GL_INT_SAMPLER_3D: case GL_INT_SAMPLER_CUBE:
+	case GL_INT_SAMPLER_1D_ARRAY: case GL_INT_SAMPLER_2D_ARRAY:
+	case GL_UNSIGNED_INT_SAMPLER_1D: case GL_UNSIGNED_INT_SAMPLER_2D: case GL_UNSIGNED_INT_SAMPLER_3D: case GL_UNSIGNED_INT_SAMPLER_CUBE:
+	case GL_UNSIGNED_INT_SAMPLER_1D_ARRAY: case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
+#endif
+#ifdef GL_VERSION_3_1
+	case GL_SAMPLER_BUFFER: case GL_INT_SAMPLER_BUFFER: case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+	case GL_INT_SAMPLER_2D_RECT: case GL_UNSIGNED_INT_SAMPLER_2D_RECT: // <- (GL_SAMPLER_2D_RECT is the _ARB one above)
+#endif
+#ifdef GL_ARB_texture_multisample
+	case GL_SAMPLER_2D_MULTISAMPLE: case GL_INT_SAMPLER_2D_MULTISAMPLE: case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE:
+	case GL_SAMPLER_2D_MULTISAMPLE_ARRAY: case GL_INT_SAMPLER_2D_MULTISAMPLE_ARRAY: case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+#endif
+#ifdef GL_VERSION_4_0
+	case GL_SAMPLER_CUBE_MAP_ARRAY: case GL_SAMPLER_CUBE_MAP_ARRAY_SHADOW:
+	case GL_INT_SAMPLER_CUBE_MAP_ARRAY: case GL_UNSIGNED_INT_SAMPLER_CUBE_MAP_ARRAY:
+#endif
+	    return true;
+	default:
+	    return false;
+    }
+}
+
+/* give each active sampler of the program its own texture unit (in the order the driver lists them)
+ * With bindless textures, most samplers are given handles instead, so the few bound to units get them by name when they are
+ * first bound (see GetSamplerUnit) - and the program may have more samplers than there are units.
+ */
+void LinkedProgram::AssignSamplerUnits() {
+    samplerUnitsAssigned = true;
+    Resolve();
+    nextSamplerUnit = 0;
+    if (usesBindless && BindlessTextures::IsEnabled()) return;
+
+    GLint maxUnits;
+    glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &maxUnits);
+
+    // the sampler values are program state, so set them on this program and restore the current one
+    GLint savedProgID;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &savedProgID);
+    glUseProgram(programID);
+
+    GLint numUniforms, maxNameLength;
+    glGetProgramiv(programID, GL_ACTIVE_UNIFORMS, &numUniforms);
+    glGetProgramiv(programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+    char* nameBuf = new char[maxNameLength+1];
+
+    for (GLint i=0; i<numUniforms; i++) {
+	GLint  size;
+	GLenum type;
+	glGetActiveUniform(programID, i, maxNameLength+1, NULL, &size, &type, nameBuf);
+	if (!IsSamplerType(type)) continue;
+
+	string name = nameBuf;
+	if (name.length() > 3 && name.substr(name.length()-3) == "[0]") name = name.substr(0, name.length()-3); // <- sampler array
+
+	if (nextSamplerUnit + size > maxUnits) {
+	    logger.error << "too many samplers - \"" << name << "\" gets no texture unit" << logger.end;
+	    continue;
+	}
+
+	vector<GLint> units;
+	for (GLint j=0; j<size; j++) units.push_back(nextSamplerUnit+j);
+	glUniform1iv(GetUniformLocation(name), size, &units[0]);
+	samplerUnits[name] = nextSamplerUnit;
+	nextSamplerUnit += size;
+    }
+
+    delete[] nameBuf;
+    glUseProgram(savedProgID);
+}
+
+/** bind a uniform block of the program to the uniform buffer binding point of the block (only done the first time - it is
+ *  program state). The first time, the std140 offsets of the fields are checked against the offsets the compiler gave them, so a
+ *  block declared with other fields (or in another order) than the fragment program is logged instead of reading garbage.
+ *  @param[in] block the uniform block (bound by its name)
+ */
+void LinkedProgram::BindUniformBlock(IUniformBlockPtr block) {
+    string blockName = block->GetName();
+    int bindingPoint = block->GetBindingPoint();
+    map<string, int>::iterator it = uniformBlockBindings.find(blockName);
+    if (it != uniformBlockBindings.end() && it->second == bindingPoint) return;
+
+    Resolve();
+    GLuint blockIndex = glGetUniformBlockIndex(programID, blockName.c_str());
+    if (blockIndex == GL_INVALID_INDEX) logger.error << "uniform block \"" << blockName << "\" does not exist" << logger.end;
+    else {
+	glUniformBlockBinding(programID, blockIndex, bindingPoint);
+	CheckUniformBlockLayout(block);
+    }
+    uniformBlockBindings[blockName] = bindingPoint;
+}
+
+/* log the fields of the block whose offset in the program differs from the std140 offset the block writes them at
+   (the fields the program doesn't use are skipped) */
+void LinkedProgram::CheckUniformBlockLayout(IUniformBlockPtr block) {
+    vector<string> fieldNames = block->GetFieldNames();
+    for (unsigned int i=0; i<fieldNames.size(); i++) {
+	const GLchar* name = fieldNames.at(i).c_str();
+	GLuint index = GL_INVALID_INDEX;
+	glGetUniformIndices(programID, 1, &name, &index);
+	if (index == GL_INVALID_INDEX) continue;
+	GLint offset = -1;
+	glGetActiveUniformsiv(programID, 1, &index, GL_UNIFORM_OFFSET, &offset);
+	if (offset != block->GetFieldOffset(fieldNames.at(i)))
+	    logger.error << "field \"" << fieldNames.at(i) << "\" of uniform block \"" << block->GetName() << "\" is at byte " << offset
+			 << " in \"" << filenames.at(0) << "\", but at byte " << block->GetFieldOffset(fieldNames.at(i))
+			 << " in the block - the fields must be declared in the same order (std140)" << logger.end;
+    }
+}
+
+/** get the FragmentProgram whose uniform values are currently loaded into this program (NULL if none)
+ */
+const void* LinkedProgram::GetStateOwner() {
+    return stateOwner;
+}
+
+/** record which FragmentProgram last loaded its uniform values into this program
+ *  (so a FragmentProgram that is bound several times in a row only has to upload changed values)
+ */
+void LinkedProgram::SetStateOwner(const void* owner) {
+    stateOwner = owner;
+}
+
+} // NS Resources
+} // NS OpenEngine
@@ -0,0 +1,112 @@
+#ifndef __LINKEDPROGRAM_H__
+#define __LINKEDPROGRAM_H__
+
+#include <Resources/PPEResourceException.h>
+#include <Resources/ShaderPreprocessor.h>
+#include <Resources/OpenGL/UniformBlock.h>
+#include <Resources/OpenGL/BindlessTextures.h>
+#include <Logging/Logger.h>
+
+#include <Meta/OpenGL.h>
+#include <boost/shared_ptr.hpp>
+
+#include <vector>
+#include <string>
+#include <map>
+
+namespace OpenEngine {
+namespace Resources {
+
+using namespace std;
+
+class FragmentProgramRegistry;
+
+/** A compiled and linked GLSL program object.
+ *  Objects of this class are shared between all FragmentPrograms made from the same sources
+ *  (see FragmentProgramRegistry), so it only holds what is common to them: the GL handles and
+ *  the uniform locations. Uniform values and texture bindings are kept by each FragmentProgram.
+ *  @note: OpenGL 2.0 or above only
+ */
+class LinkedProgram {
+
+  private:
+
+    vector<GLuint> shaderIDs;
+    GLuint programID;
+
+    // compile and link are only submitted in the constructor; the status is checked (and logged) the first time the program is needed
+    bool resolved;
+
+    vector<string> filenames; // the (resolved) source files
+    ShaderDefines  defines;
+    vector<vector<string> > sourceFiles; // for each shader: the file and the files it includes (by source string number)
+    bool usesBindless; // whether the sources enable GL_ARB_bindless_texture (otherwise the samplers can only be given units)
+
+    // a reload (see Reload) that is being compiled - it replaces the above in SwapIfReady
+    vector<GLuint> pendingShaderIDs;
+    GLuint pendingProgramID; // 0 = no reload
+    vector<vector<string> > pendingSourceFiles;
+    bool pendingUsesBindless;
+    int generation; // number of reloads swapped in
+
+    // uniform locations looked up so far (glGetUniformLocation is slow, and the locations never change after linking)
+    map<string, GLint> uniformLocations;
+
+    // the texture unit of each sampler (all samplers get a unit when the program is linked, so glUniform1i is never called per bind)
+    map<string, int> samplerUnits;
+    bool samplerUnitsAssigned;
+    int  nextSamplerUnit; // the first unit not given to a sampler
+    void AssignSamplerUnits();
+    static bool IsSamplerType(GLenum type);
+
+    // the binding point each uniform block of the program has been bound to (program state, so it is only set once)
+    map<string, int> uniformBlockBindings;
+    void CheckUniformBlockLayout(IUniformBlockPtr block);
+
+    // the FragmentProgram whose uniform values are currently set in this program object (NULL if none)
+    const void* stateOwner;
+
+    friend class FragmentProgramRegistry;
+    LinkedProgram(vector<string> filenames, ShaderDefines defines);
+
+    void Submit(vector<GLuint>& shaderIDs, GLuint& programID, vector<vector<string> >& sourceFiles, bool& usesBindless);
+    void Delete(vector<GLuint>& shaderIDs, GLuint& programID);
+    bool CheckStatus(vector<GLuint>& shaderIDs, GLuint programID, vector<vector<string> >& sourceFiles);
+    bool IsCompletionReady(GLuint programID);
+    static bool IsVertexShader(string filename);
+    static bool EnablesBindlessTextures(ShaderPreprocessor& source);
+
+    static int parallelCompile; // -1 = not checked yet
+    static bool HasParallelCompile();
+
+  public:
+
+    ~LinkedProgram();
+
+    bool Resolve(const bool block = true);
+
+    // hot-reload (see FragmentProgramRegistry::EnableHotReload)
+    void Reload();
+    bool SwapIfReady(const bool block = false);
+    int  GetGeneration();
+    vector<string> GetSourceFiles();
+
+    GLuint GetID();
+    GLint  GetUniformLocation(string parameterName);
+    void   BindUniformBlock(IUniformBlockPtr block);
+    int    GetSamplerUnit(string parameterName);
+    bool   UsesBindlessTextures();
+
+    const void* GetStateOwner();
+    void SetStateOwner(const void* owner);
+};
+
+/**
+ * LinkedProgram smart pointer.
+ */
+typedef boost::shared_ptr<LinkedProgram> LinkedProgramPtr;
+
+} // NS Resources
+} // NS OpenEngine
+
+#endif
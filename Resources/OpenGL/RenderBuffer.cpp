@@ -1,5 +1,8 @@
 #include "RenderBuffer.h"
 
+#include <string.h>
+#include <algorithm>
+
 /* @author Bjarke N. Laustsen
  */
 namespace OpenEngine {
@@ -9,9 +12,12 @@ namespace Resources {
  * @param width the renderbuffer width
  * @param height the renderbuffer height
  * @param format the renderbuffer format
+ * @param samples the number of samples per pixel (0 for an ordinary renderbuffer). Clamped to GetMaxSamples().
  */
-RenderBuffer::RenderBuffer(int width, int height, PixelFormat format) {
+RenderBuffer::RenderBuffer(int width, int height, PixelFormat format, int samples) {
     this->rbID = 0; // must be done before calling createOrModifyRB!
+    this->savedRbID = 0;
+    this->samples = std::min(samples, GetMaxSamples());
 
     CreateOrModifyRB(width, height, format);
 }
@@ -65,6 +71,27 @@ unsigned int RenderBuffer::GetHeight() {
 }
 
 
+/** get the number of samples per pixel of this renderbuffer (0 if it isn't multisampled)
+ *  @returns the number of samples
+ */
+int RenderBuffer::GetSamples() {
+    return samples;
+}
+
+/** get the max number of samples per pixel of a renderbuffer on this gfx-card
+ *  @returns the max number of samples (0 if GL_EXT_framebuffer_multisample isn't supported)
+ */
+int RenderBuffer::GetMaxSamples() {
+    static GLint maxSamples = -1;
+    if (maxSamples == -1) {
+	const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+	maxSamples = 0;
+	if (extensions != NULL && strstr(extensions, "GL_EXT_framebuffer_multisample") != NULL)
+	    glGetIntegerv(GL_MAX_SAMPLES_EXT, &maxSamples);
+    }
+    return maxSamples;
+}
+
 /** get the depth of this renderbuffer (always 0)
  *  @returns the depth
  */
@@ -146,7 +173,10 @@ void RenderBuffer::SetFloatData(float* data) {
 void RenderBuffer::CreateOrModifyRB(int width, int height, PixelFormat format) {
     if (rbID == 0) glGenRenderbuffersEXT(1, &rbID);
     GuardedBind();
-    glRenderbufferStorageEXT(GL_RENDERBUFFER_EXT, GetGLInternalFormat(format), GetGLWidth(width), GetGLHeight(height));
+    if (samples > 0)
+	glRenderbufferStorageMultisampleEXT(GL_RENDERBUFFER_EXT, samples, GetGLInternalFormat(format), GetGLWidth(width), GetGLHeight(height));
+    else
+	glRenderbufferStorageEXT(GL_RENDERBUFFER_EXT, GetGLInternalFormat(format), GetGLWidth(width), GetGLHeight(height));
     CheckGLErrors("createOrModifyRB");
     GuardedUnbind();
 }
@@ -154,10 +184,21 @@ void RenderBuffer::CreateOrModifyRB(int width, int height, PixelFormat format) {
 /* these returns opengl stuff depending on the instance vars */
 GLint RenderBuffer::GetGLInternalFormat(PixelFormat format) {
     switch (format) {
-	case RB_DEPTH:   return GL_DEPTH_COMPONENT;
+	case RB_DEPTH:   return GL_DEPTH_COMPONENT24; // <- sized formats, so they match the textures they are blitted to
 	case RB_STENCIL: return GL_STENCIL_INDEX;
-	case RB_RGB:	 return GL_RGB;
-	case RB_RGBA:	 return GL_RGBA;
+	case RB_DEPTH_STENCIL: return GL_DEPTH24_STENCIL8_EXT;
+	case RB_RGB:	 return GL_RGB8;
+	case RB_RGBA:	 return GL_RGBA8;
+	case RB_RGB16F:     return GL_RGB16F_ARB;
+	case RB_RGBA16F:    return GL_RGBA16F_ARB;
+	case RB_RG16F:      return GL_RG16F;
+	case RB_R16F:       return GL_R16F;
+	case RB_R11G11B10F: return GL_R11F_G11F_B10F_EXT;
+	case RB_RGB10A2:    return GL_RGB10_A2;
+	case RB_R8:         return GL_R8;
+	case RB_RG8:        return GL_RG8;
+	case RB_R32F:       return GL_R32F;
+	case RB_RG32F:      return GL_RG32F;
 	default:         throw PPEResourceException("illegal format");
     }
 }
@@ -173,9 +214,23 @@ GLsizei RenderBuffer::GetGLHeight(int height) {
 PixelFormat RenderBuffer::GetOEInternalFormat(GLint glInternalFormat) {
     switch (glInternalFormat) {
 	case GL_DEPTH_COMPONENT: return RB_DEPTH;
+	case GL_DEPTH_COMPONENT24: return RB_DEPTH;
 	case GL_STENCIL_INDEX:   return RB_STENCIL;
+	case GL_DEPTH24_STENCIL8_EXT: return RB_DEPTH_STENCIL;
 	case GL_RGB:             return RB_RGB;
+	case GL_RGB8:            return RB_RGB;
 	case GL_RGBA:            return RB_RGBA;
+	case GL_RGBA8:           return RB_RGBA;
+	case GL_RGB16F_ARB:      return RB_RGB16F;
+	case GL_RGBA16F_ARB:     return RB_RGBA16F;
+	case GL_RG16F:           return RB_RG16F;
+	case GL_R16F:            return RB_R16F;
+	case GL_R11F_G11F_B10F_EXT: return RB_R11G11B10F;
+	case GL_RGB10_A2:        return RB_RGB10A2;
+	case GL_R8:              return RB_R8;
+	case GL_RG8:             return RB_RG8;
+	case GL_R32F:            return RB_R32F;
+	case GL_RG32F:           return RB_RG32F;
 	default:                 throw PPEResourceException("illegal format2");
     }
 }
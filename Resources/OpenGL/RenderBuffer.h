@@ -24,6 +24,7 @@ class RenderBuffer : public IRenderBuffer {
   private:
 
     GLuint rbID;
+    int samples;
 
     void CreateOrModifyRB(int width, int height, PixelFormat format);
     void CheckGLErrors (const char *label);
@@ -39,7 +40,7 @@ class RenderBuffer : public IRenderBuffer {
 
   public:
 
-    RenderBuffer(int width, int height, PixelFormat format);
+    RenderBuffer(int width, int height, PixelFormat format, int samples = 0); // samples > 0: multisampled (resolve with glBlitFramebufferEXT)
     ~RenderBuffer(); // <- note: relatively slow operation
 
     int  GetID();
@@ -51,6 +52,8 @@ class RenderBuffer : public IRenderBuffer {
 
     unsigned int GetWidth();
     unsigned int GetHeight();
+    int GetSamples();
+    static int GetMaxSamples(); // 0 if multisampled renderbuffers aren't supported
     int GetZDepth(); // <-. to make it work with ITextureResource, we can't call it getDepth :(
     unsigned int GetDepth(); // <- not z-depth, but bit-depth
 
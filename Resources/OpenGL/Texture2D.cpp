@@ -1,6 +1,9 @@
 #include "Texture2D.h"
+#include "FragmentProgram.h"
 
 #include <Utils/Convert.h>
+#include <string.h>
+#include <algorithm>
 
 using OpenEngine::Utils::Convert;
 
@@ -9,6 +12,8 @@ using OpenEngine::Utils::Convert;
 namespace OpenEngine {
 namespace Resources {
 
+int Texture2D::textureStorage = -1;
+
 /** Create a new 2D texture
  * @param width the textuer width
  * @param height the texture height
@@ -19,7 +24,9 @@ namespace Resources {
  * @param filterMin the min filter setting
  */
 Texture2D::Texture2D(int width, int height, TexelFormat format, TextureWrap wrapS, TextureWrap wrapT, TextureFilter filterMag, TextureFilter filterMin) {
-    this->texID = 0; // must be done before calling createOrModifyTexture!
+    this->texID   = 0; // must be done before calling createOrModifyTexture!
+    this->version = 0;
+    this->infoID  = 0;
 
     CreateOrModifyTexture(width, height, format, wrapS, wrapT, filterMag, filterMin);
 }
@@ -27,7 +34,9 @@ Texture2D::Texture2D(int width, int height, TexelFormat format, TextureWrap wrap
 /** delete this texture
  */
 Texture2D::~Texture2D() {
+    BindlessTextures::Release(texID);
     glDeleteTextures(1, &texID);
+    FragmentProgram::InvalidateTextureUnitCache(); // <- (the texID may be given to a new texture, which isn't bound)
 }
 
 /** clone this texture
@@ -77,6 +86,10 @@ void Texture2D::SetID(int texID) {
  *  @param wrap the wrap setting
  */
 void Texture2D::SetWrapS(TextureWrap wrap) {
+    if (BindlessTextures::HasHandle(texID)) { // <- immutable
+	if (GetWrapS() == wrap) return;
+	ReleaseBindlessHandle(true);
+    }
     glPushAttrib(GL_TEXTURE_BIT); // remember currently bound 2D-texture (so that this method doesn't give any side effects)
     Bind();
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GetGLWrap(wrap));
@@ -87,6 +100,10 @@ void Texture2D::SetWrapS(TextureWrap wrap) {
  *  @param wrap the wrap setting
  */
 void Texture2D::SetWrapT(TextureWrap wrap) {
+    if (BindlessTextures::HasHandle(texID)) { // <- immutable
+	if (GetWrapT() == wrap) return;
+	ReleaseBindlessHandle(true);
+    }
     glPushAttrib(GL_TEXTURE_BIT); // remember currently bound 2D-texture (so that this method doesn't give any side effects)
     Bind();
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GetGLWrap(wrap));
@@ -97,6 +114,10 @@ void Texture2D::SetWrapT(TextureWrap wrap) {
  *  @param filter the filter setting
  */
 void Texture2D::SetMagFilter(TextureFilter filter) {
+    if (BindlessTextures::HasHandle(texID)) { // <- immutable
+	if (GetMagFilter() == filter) return;
+	ReleaseBindlessHandle(true);
+    }
     glPushAttrib(GL_TEXTURE_BIT); // remember currently bound 2D-texture (so that this method doesn't give any side effects)
     Bind();
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GetGLFilter(filter));
@@ -107,6 +128,10 @@ void Texture2D::SetMagFilter(TextureFilter filter) {
  *  @param filter the filter setting
  */
 void Texture2D::SetMinFilter(TextureFilter filter) {
+    if (BindlessTextures::HasHandle(texID)) { // <- immutable
+	if (GetMinFilter() == filter) return;
+	ReleaseBindlessHandle(true);
+    }
     glPushAttrib(GL_TEXTURE_BIT); // remember currently bound 2D-texture (so that this method doesn't give any side effects)
     Bind();
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GetGLFilter(filter));
@@ -166,36 +191,41 @@ TextureFilter Texture2D::GetMinFilter() {
  *  @returns the internal format
  */
 TexelFormat Texture2D::GetFormat() {
-    glPushAttrib(GL_TEXTURE_BIT); // remember currently bound 2D-texture (so that this method doesn't give any side effects)
-    GLint internalFormat;
-    this->Bind();
-    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
-    glPopAttrib();
-    return GetOEInternalFormat(internalFormat);
+    ReadInfo();
+    return texFormat;
 }
 
 /** get the width of this texture
  *  @returns the width
  */
 unsigned int Texture2D::GetWidth() {
-    glPushAttrib(GL_TEXTURE_BIT); // remember currently bound 2D-texture (so that this method doesn't give any side effects)
-    GLsizei width;
-    this->Bind();
-    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
-    glPopAttrib();
-    return (int)width;
+    ReadInfo();
+    return texWidth;
 }
 
 /** get the height of this texture
  *  @returns the height
  */
 unsigned int Texture2D::GetHeight() {
+    ReadInfo();
+    return texHeight;
+}
+
+/* read the size and format of the texture from OpenGL - unless they are known already (they are set when the texture is
+   created, so they are only read if the texture was given by SetID) */
+void Texture2D::ReadInfo() {
+    if (infoID == texID) return;
     glPushAttrib(GL_TEXTURE_BIT); // remember currently bound 2D-texture (so that this method doesn't give any side effects)
-    GLsizei height;
+    GLint width, height, internalFormat;
     this->Bind();
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
     glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
     glPopAttrib();
-    return (int)height;
+    texFormat = GetOEInternalFormat(internalFormat);
+    texWidth  = (int)width;
+    texHeight = (int)height;
+    infoID    = texID;
 }
 
 /** get the depth of this texture (always 0)
@@ -218,17 +248,29 @@ unsigned int Texture2D::GetDepth() {
 	case TEX_LUMINANCE_FLOAT: return 16;
 	case TEX_RGB_FLOAT:	  return 16*3;
 	case TEX_RGBA_FLOAT:	  return 16*4;
+	case TEX_RG16F:	          return 16*2;
+	case TEX_R16F:	          return 16;
+	case TEX_R11G11B10F:	  return 32;
+	case TEX_RGB10A2:	  return 32;
+	case TEX_R8:	          return 8;
+	case TEX_RG8:	          return 8*2;
+	case TEX_R32F:	          return 32;
+	case TEX_RG32F:	          return 32*2;
+	case TEX_RGBA32F:	  return 32*4;
 	default:                  throw new PPEResourceException("GetDepth: illegal format");
     }
 }
 
 ColorFormat Texture2D::GetColorFormat() {
-    unsigned int depth = GetDepth();
-    if (depth==32)
+    // (by number of components, as the bit depth doesn't tell - e.g. RG16F and RGB10A2 are 32 bit as well)
+    if (GetFormat()==TEX_DEPTH || GetFormat()==TEX_DEPTH_STENCIL)
+        throw Exception("unknown color depth");
+    int numComponents = GetNumComponents();
+    if (numComponents==4)
         return RGBA;
-    else if (depth==24)
+    else if (numComponents==3)
         return RGB;
-    else if (depth==8)
+    else if (numComponents==1)
         return LUMINANCE;
     else
         throw Exception("unknown color depth");
@@ -242,7 +284,7 @@ ColorFormat Texture2D::GetColorFormat() {
  * @todo: keep the contents somehow. This will probably trash performance (when it's not needed), so make it optional.
  */
 void Texture2D::Resize(int width, int height) { // gldelete og lav igen, men genbrug texID. (is a slow operation)
-    CreateOrModifyTexture(width, height, GetFormat(), GetWrapS(), GetWrapT(), GetMagFilter(), GetMinFilter());
+    Resize(width, height, GetFormat());
 }
 
 /** Resize this texture and change internal format (destructive resize - content will not be preserved)
@@ -254,13 +296,15 @@ void Texture2D::Resize(int width, int height) { // gldelete og lav igen, men gen
  * @todo: keep the contents somehow. This will probably trash performance (when it's not needed), so make it optional.
  */
 void Texture2D::Resize(int width, int height, TexelFormat format) { // gldelete og lav igen, men genbrug texID. (is a slow operation)
+    // nothing to reallocate if the size and format are unchanged (the content is kept - f.e. the history buffers are resized every frame)
+    if (width == (int)GetWidth() && height == (int)GetHeight() && format == GetFormat()) return;
     CreateOrModifyTexture(width, height, format, GetWrapS(), GetWrapT(), GetMagFilter(), GetMinFilter());
 }
 
 /* these returns opengl stuff depending on the instance vars */
 GLint Texture2D::GetGLInternalFormat(TexelFormat format) {
     switch (format) {
-	case TEX_DEPTH:           return GL_DEPTH_COMPONENT;
+	case TEX_DEPTH:           return GL_DEPTH_COMPONENT24; // <- sized, so it matches the depth renderbuffers it is blitted from
 	case TEX_DEPTH_STENCIL:   return GL_DEPTH24_STENCIL8_EXT;
 	case TEX_LUMINANCE:       return GL_LUMINANCE8;
 	case TEX_RGB:	          return GL_RGB8;
@@ -268,6 +312,15 @@ GLint Texture2D::GetGLInternalFormat(TexelFormat format) {
 	case TEX_LUMINANCE_FLOAT: return GL_LUMINANCE16F_ARB;
 	case TEX_RGB_FLOAT:	  return GL_RGB16F_ARB;
 	case TEX_RGBA_FLOAT:	  return GL_RGBA16F_ARB;
+	case TEX_RG16F:	          return GL_RG16F;
+	case TEX_R16F:	          return GL_R16F;
+	case TEX_R11G11B10F:	  return GL_R11F_G11F_B10F_EXT;
+	case TEX_RGB10A2:	  return GL_RGB10_A2;
+	case TEX_R8:	          return GL_R8;
+	case TEX_RG8:	          return GL_RG8;
+	case TEX_R32F:	          return GL_R32F;
+	case TEX_RG32F:	          return GL_RG32F;
+	case TEX_RGBA32F:	  return GL_RGBA32F_ARB;
 	default:                  throw new PPEResourceException("getGLInternalFormat: illegal format");
     }
 }
@@ -282,6 +335,15 @@ GLenum Texture2D::GetGLFormat(TexelFormat format) {
 	case TEX_LUMINANCE_FLOAT: return GL_LUMINANCE;
 	case TEX_RGB_FLOAT:	  return GL_RGB;
 	case TEX_RGBA_FLOAT:	  return GL_RGBA;
+	case TEX_RG16F:	          return GL_RG;
+	case TEX_R16F:	          return GL_RED;
+	case TEX_R11G11B10F:	  return GL_RGB;
+	case TEX_RGB10A2:	  return GL_RGBA;
+	case TEX_R8:	          return GL_RED;
+	case TEX_RG8:	          return GL_RG;
+	case TEX_R32F:	          return GL_RED;
+	case TEX_RG32F:	          return GL_RG;
+	case TEX_RGBA32F:	  return GL_RGBA;
 	default:                  throw new PPEResourceException("getGLFormat: illegal format");
     }
 }
@@ -326,6 +388,15 @@ TexelFormat Texture2D::GetOEInternalFormat(GLint glInternalFormat) {
 	case GL_LUMINANCE16F_ARB:     return TEX_LUMINANCE_FLOAT;
 	case GL_RGB16F_ARB:           return TEX_RGB_FLOAT;
 	case GL_RGBA16F_ARB:          return TEX_RGBA_FLOAT;
+	case GL_RG16F:                return TEX_RG16F;
+	case GL_R16F:                 return TEX_R16F;
+	case GL_R11F_G11F_B10F_EXT:   return TEX_R11G11B10F;
+	case GL_RGB10_A2:             return TEX_RGB10A2;
+	case GL_R8:                   return TEX_R8;
+	case GL_RG8:                  return TEX_RG8;
+	case GL_R32F:                 return TEX_R32F;
+	case GL_RG32F:                return TEX_RG32F;
+	case GL_RGBA32F_ARB:          return TEX_RGBA32F;
 
         // added by: CPVC found on:
         // http://svn.clifford.at/qcake/trunk/qt4/include/GLee.h
@@ -358,15 +429,40 @@ TextureFilter Texture2D::GetOEFilter(GLint glFilter) {
 // either creates a new texture or modifies an existing 2D-texture (modify = reuse texID).
 // Generates a new texture if texID=0, otherwise it just changes the parameters of the existing texture corresponding to texID.
 // NOTE: when mofifying trashes everything that was previously in the texture.
+// With immutable storage (GL_ARB_texture_storage) the storage is allocated once, so modifying gives a new texID as well.
 void Texture2D::CreateOrModifyTexture(int width, int height, TexelFormat format, TextureWrap wrapS, TextureWrap wrapT, TextureFilter filterMag, TextureFilter filterMin) {
+    // a texture with a bindless handle (or immutable storage) can't be modified, so it gets a new texture-handle (the content is trashed anyway)
+    if (BindlessTextures::HasHandle(texID) || (texID != 0 && HasTextureStorage())) {
+	BindlessTextures::Release(texID);
+	glDeleteTextures(1, &texID);
+	texID = 0;
+	FragmentProgram::InvalidateTextureUnitCache(); // <- (the new texture may get the same texID, without being bound)
+    }
+
+    version++; // <- (the content is undefined now)
+
     glPushAttrib(GL_TEXTURE_BIT); // to avoid side effects
     if (texID == 0) glGenTextures(1, &texID); // if not already created, then create texture-handle for this texture
+    texWidth  = width;
+    texHeight = height;
+    texFormat = format;
+    infoID    = texID;
     Bind();
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GetGLWrap(wrapS)); // (important to remember to set the texture parameters for it to work!)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GetGLWrap(wrapT));
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GetGLFilter(filterMag));
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GetGLFilter(filterMin));
-    glTexImage2D(GL_TEXTURE_2D, 0, GetGLInternalFormat(format), GetGLWidth(width), GetGLHeight(height), 0, GetGLFormat(format), GL_FLOAT, NULL);
+#ifdef GL_ARB_texture_storage
+    if (HasTextureStorage()) {
+	// (immutable storage needs a sized format, so the driver never has to reallocate - all the internal formats are sized)
+	glTexStorage2D(GL_TEXTURE_2D, 1, GetGLInternalFormat(format), GetGLWidth(width), GetGLHeight(height));
+	glPopAttrib();
+	return;
+    }
+#endif
+    // (no data is given, but the type must still be legal for the format - packed depth-stencil only takes GL_UNSIGNED_INT_24_8)
+    GLenum type = (format == TEX_DEPTH_STENCIL) ? GL_UNSIGNED_INT_24_8_EXT : GL_FLOAT;
+    glTexImage2D(GL_TEXTURE_2D, 0, GetGLInternalFormat(format), GetGLWidth(width), GetGLHeight(height), 0, GetGLFormat(format), type, NULL);
     //unbind(); // unbind again
     glPopAttrib();
 }
@@ -378,7 +474,12 @@ void Texture2D::CreateOrModifyTexture(int width, int height, TexelFormat format,
 void Texture2D::CopyTexture(ITexture2DPtr destTex) {
 
     if (destTex.get() == NULL) throw PPEResourceException("destTex was NULL");
-    if (GetFormat() == TEX_DEPTH_STENCIL) throw PPEResourceException("depth_stencil texture copy not implemented");
+
+    // the content is copied into the storage of the destination (glCopyTexSubImage2D), so it must have the same size and format.
+    // (a destination with a bindless handle is immutable - resizing it gives it a new texture-handle, so its parameters can be set)
+    if (BindlessTextures::HasHandle((GLuint)destTex->GetID()) ||
+	destTex->GetWidth() != GetWidth() || destTex->GetHeight() != GetHeight() || destTex->GetFormat() != GetFormat())
+	destTex->Resize(GetWidth(), GetHeight(), GetFormat());
 
     glPushAttrib(GL_ALL_ATTRIB_BITS); // to avoid side effects
     GLint savedFboID;
@@ -401,7 +502,6 @@ void Texture2D::CopyTexture(ITexture2DPtr destTex) {
     GLint   filter_min;
     GLsizei width;
     GLsizei height;
-    GLint   internalFormat;
 
     this->Bind();
     glGetTexParameteriv     (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S            , &wrap_s);
@@ -410,7 +510,6 @@ void Texture2D::CopyTexture(ITexture2DPtr destTex) {
     glGetTexParameteriv     (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER        , &filter_min);
     glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH          , &width);
     glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT         , &height);
-    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
     this->Unbind();
 
     // throw exception if the supplied destination texture wasn't 2D (if outTexID != bound2DTexture)
@@ -420,20 +519,17 @@ void Texture2D::CopyTexture(ITexture2DPtr destTex) {
     glBindTexture(GL_TEXTURE_2D, 0);
     if ((GLuint)destTex->GetID() != (GLuint)bound2DTex) throw PPEResourceException("outTexID must be a 2D texture!");
 
-    // set which attachment (color or depth) we should attach the source-texture to, depending on its internal-format
-    GLenum attachment;
-    if (internalFormat == GL_DEPTH_COMPONENT) {
-	attachment = GL_DEPTH_ATTACHMENT_EXT;
-    } else {
-	attachment = GL_COLOR_ATTACHMENT0_EXT;
-    }
+    // set which attachment(s) we should attach the source-texture to, depending on its format
+    // (a packed depth-stencil texture is attached as both depth and stencil, and glCopyTexImage2D then copies both)
+    bool depth   = GetFormat() == TEX_DEPTH || GetFormat() == TEX_DEPTH_STENCIL;
+    bool stencil = GetFormat() == TEX_DEPTH_STENCIL;
 
     // bind copy-fbo
     glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, texCopyFboID);
 
 
     // select read and draw buffers
-    if (internalFormat == GL_DEPTH_COMPONENT) {
+    if (depth) {
         glReadBuffer(GL_NONE);
         glDrawBuffer(GL_NONE);
     } else {
@@ -441,8 +537,9 @@ void Texture2D::CopyTexture(ITexture2DPtr destTex) {
     }
 
     // attach source-texture as a buffer
-    if (internalFormat == GL_DEPTH_COMPONENT) {
+    if (depth) {
         glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT, GL_DEPTH_ATTACHMENT_EXT , GL_TEXTURE_2D, this->texID, 0);
+	if (stencil) glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT, GL_STENCIL_ATTACHMENT_EXT, GL_TEXTURE_2D, this->texID, 0);
     } else {
 	glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, this->texID, 0);
     }
@@ -454,16 +551,18 @@ void Texture2D::CopyTexture(ITexture2DPtr destTex) {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter_mag);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter_min);
 
-    // copy from the buffer (i.e. the source texture) to the textination texture (instead of the usual glTexImage2D)
-    glCopyTexImage2D(GL_TEXTURE_2D, 0, internalFormat, 0, 0, width, height, 0);
+    // copy from the buffer (i.e. the source texture) to the textination texture (into its storage - works with immutable storage too)
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
 
     // unbind output-texture, attachment and FBO again
-    if (internalFormat == GL_DEPTH_COMPONENT)
+    if (depth) {
         glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT, GL_DEPTH_ATTACHMENT_EXT , GL_TEXTURE_2D, 0, 0);
-    else
+	if (stencil) glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT, GL_STENCIL_ATTACHMENT_EXT, GL_TEXTURE_2D, 0, 0);
+    } else
         glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, 0, 0);
     glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, (GLuint)savedFboID);
     glPopAttrib();
+    destTex->IncrementVersion();
 
     // check if something messed up
     CheckGLErrors("copyTexture");
@@ -522,6 +621,15 @@ int Texture2D::GetNumComponents() {
 	case TEX_LUMINANCE_FLOAT: return 1;
 	case TEX_RGB_FLOAT:	  return 3;
 	case TEX_RGBA_FLOAT:	  return 4;
+	case TEX_RG16F:	          return 2;
+	case TEX_R16F:	          return 1;
+	case TEX_R11G11B10F:	  return 3;
+	case TEX_RGB10A2:	  return 4;
+	case TEX_R8:	          return 1;
+	case TEX_RG8:	          return 2;
+	case TEX_R32F:	          return 1;
+	case TEX_RG32F:	          return 2;
+	case TEX_RGBA32F:	  return 4;
 	default:                  throw PPEResourceException("GetNumComponents: illegal format");
     }
 }
@@ -553,22 +661,21 @@ unsigned char* Texture2D::GetData(GLenum type) {
 	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);		// <- unbind again
     }
 
-    GLint internalFormat = GetGLInternalFormat(GetFormat());
-    GLint format         = GetGLFormat(GetFormat());
+    GLint format = GetGLFormat(GetFormat());
 
     // bind copy-fbo
     glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, texReadFboID);
 
     // select which color-buffer to read from (for depth, we specify "none")
     glDrawBuffer(GL_NONE);
-    if (internalFormat == GL_DEPTH_COMPONENT) {
+    if (GetFormat() == TEX_DEPTH) {
         glReadBuffer(GL_NONE);
     } else {
 	glReadBuffer(GL_COLOR_ATTACHMENT0_EXT);
     }
 
     // attach input-texture as a buffer
-    if (internalFormat == GL_DEPTH_COMPONENT) {
+    if (GetFormat() == TEX_DEPTH) {
         glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT, GL_DEPTH_ATTACHMENT_EXT , GL_TEXTURE_2D, this->texID, 0);
     } else {
 	glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, this->texID, 0);
@@ -578,10 +685,13 @@ unsigned char* Texture2D::GetData(GLenum type) {
     unsigned char* data = new unsigned char[GetWidth() * GetHeight() * GetNumComponents() * arrayElemByteDepth];
 
     // read the data from the texture into the array
+    glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1); // <- the rows of the array are tightly packed (1- and 3-component rows aren't 4-byte aligned)
     glReadPixels(0, 0, GetWidth(), GetHeight(), format, type, data);
+    glPopClientAttrib();
 
     // remove attachments and unbind FBO again
-    if (internalFormat == GL_DEPTH_COMPONENT)
+    if (GetFormat() == TEX_DEPTH)
         glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT, GL_DEPTH_ATTACHMENT_EXT , GL_TEXTURE_2D, 0, 0);
     else
         glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, 0, 0);
@@ -611,24 +721,115 @@ float* Texture2D::GetFloatData() {
 }
 
 /** expected array of the same size as the texture multiplied by num components: GetWidth()*GetHeight()*numcomp
+ *  (the storage is kept - only the content is replaced)
  */
 void Texture2D::SetData(unsigned char* data) {
-    glPushAttrib(GL_TEXTURE_BIT); // to avoid side effects
-    Bind();
-    glTexImage2D(GL_TEXTURE_2D, 0, GetGLInternalFormat(GetFormat()), GetGLWidth(GetWidth()), GetGLHeight(GetHeight()), 0,
-                 GetGLFormat(GetFormat()), GL_UNSIGNED_BYTE, data);
-    glPopAttrib();
+    SetSubData(0, 0, GetWidth(), GetHeight(), GL_UNSIGNED_BYTE, data, 0);
 }
 
 /** expected array of the same size as the texture multiplied by num components: GetWidth()*GetHeight()*numcomp
+ *  (the storage is kept - only the content is replaced)
  */
 void Texture2D::SetFloatData(float* data) {
+    SetSubData(0, 0, GetWidth(), GetHeight(), GL_FLOAT, data, 0);
+}
+
+/** Replace the content of a rectangle of the texture, without reallocating its storage (glTexSubImage2D).
+ *  Expects an array of at least rowStride*(height-1)+width texels of num components each.
+ *  If a pixel unpack buffer is bound (see TextureStreamer), data is an offset into that buffer instead.
+ *  @param x the left edge of the rectangle
+ *  @param y the bottom edge of the rectangle
+ *  @param width the width of the rectangle
+ *  @param height the height of the rectangle
+ *  @param data the texels (row by row, bottom row first)
+ *  @param rowStride the number of texels from the start of one row in data to the next (0 = width - tightly packed)
+ */
+void Texture2D::SetSubData(int x, int y, int width, int height, unsigned char* data, int rowStride) {
+    SetSubData(x, y, width, height, GL_UNSIGNED_BYTE, data, rowStride);
+}
+
+/** as above, but with float texels
+ */
+void Texture2D::SetFloatSubData(int x, int y, int width, int height, float* data, int rowStride) {
+    SetSubData(x, y, width, height, GL_FLOAT, data, rowStride);
+}
+
+void Texture2D::SetSubData(int x, int y, int width, int height, GLenum type, const void* data, int rowStride) {
+    if (x < 0 || y < 0 || x+width > (int)GetWidth() || y+height > (int)GetHeight()) throw PPEResourceException("SetSubData: rectangle outside the texture");
+
+    // (the content of a texture with a bindless handle may be changed - only its storage and parameters are immutable)
     glPushAttrib(GL_TEXTURE_BIT); // to avoid side effects
+    glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // <- rows of 1- and 3-component textures aren't 4-byte aligned
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, rowStride);
     Bind();
-    //glTexImage2D(GL_TEXTURE_2D, 0, GetGLInternalFormat(format), GetGLWidth(width), GetGLHeight(height), 0, GetGLFormat(format), GL_FLOAT, data);
-    glTexImage2D(GL_TEXTURE_2D, 0, GetGLInternalFormat(GetFormat()), GetGLWidth(GetWidth()), GetGLHeight(GetHeight()), 0,
-                 GetGLFormat(GetFormat()), GL_FLOAT, data);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GetGLFormat(GetFormat()), type, data);
+    glPopClientAttrib();
     glPopAttrib();
+    version++;
+}
+
+/** Get the version of the content of this texture. It is incremented each time the content is changed through this class
+ *  (SetData, SetSubData, Resize, as the destination of Clone, ...) - and by IncrementVersion, which must be called after
+ *  rendering to the texture. So if the version is unchanged, so is the content (used to skip passes with unchanged inputs).
+ *  @return the version
+ */
+int Texture2D::GetVersion() {
+    return version;
+}
+
+/** Mark the content of this texture as changed (call after rendering to it - f.e. through an FBO)
+ */
+void Texture2D::IncrementVersion() {
+    version++;
+}
+
+/** Exchange the content of this texture with another texture, by swapping their texture-handles - so nothing is copied.
+ *  (The wrap and filter settings are part of the texture-handle, so they are exchanged too. Attach the textures to FBOs again.)
+ *  Both get a new version (higher than both the old), as the content of both has changed.
+ *  @param[in] texture the other texture (must have the same size and format)
+ *  @exception PPEResourceException thrown if the size or format differs
+ */
+void Texture2D::SwapContent(ITexture2DPtr texture) {
+    Texture2D* other = dynamic_cast<Texture2D*>(texture.get());
+    if (other == NULL) throw PPEResourceException("can only swap content with another Texture2D");
+    if (other->GetWidth() != GetWidth() || other->GetHeight() != GetHeight() || other->GetFormat() != GetFormat())
+	throw PPEResourceException("can only swap content with a texture of the same size and format");
+
+    GLuint otherTexID = other->texID;
+    other->texID = texID;
+    texID = otherTexID;
+    std::swap(infoID, other->infoID); // <- (the size and format are the same)
+
+    version = other->version = ((version > other->version) ? version : other->version) + 1;
+}
+
+/* If the texture has a bindless handle (which makes it immutable), move it to a new texture-handle with the same
+   size, format and settings, so it can be modified. (The texture-handle changes - users get it from GetID anyway.) */
+void Texture2D::ReleaseBindlessHandle(const bool keepContent) {
+    if (!BindlessTextures::HasHandle(texID)) return;
+
+    boost::shared_ptr<Texture2D> newTex(new Texture2D(GetWidth(), GetHeight(), GetFormat(), GetWrapS(), GetWrapT(), GetMagFilter(), GetMinFilter()));
+    if (keepContent) CopyTexture(newTex);
+
+    // swap texture-handles (the old one is released and deleted with newTex)
+    GLuint oldTexID = texID;
+    texID = newTex->texID;
+    newTex->texID = oldTexID;
+    std::swap(infoID, newTex->infoID);
+}
+
+/* whether textures can be given immutable storage (GL_ARB_texture_storage) */
+bool Texture2D::HasTextureStorage() {
+    if (textureStorage == -1) {
+#ifdef GL_ARB_texture_storage
+	const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+	textureStorage = (extensions != NULL && strstr(extensions, "GL_ARB_texture_storage") != NULL) ? 1 : 0;
+#else
+	textureStorage = 0;
+#endif
+    }
+    return textureStorage == 1;
 }
 
 /** this method does not make sense for this type of resource.
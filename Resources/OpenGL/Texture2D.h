@@ -3,6 +3,7 @@
 
 #include <Resources/ITexture2D.h>
 #include <Resources/PPEResourceException.h>
+#include <Resources/OpenGL/BindlessTextures.h>
 #include <Logging/Logger.h>
 
 #include <Meta/OpenGL.h>
@@ -15,6 +16,9 @@ namespace OpenEngine {
 namespace Resources {
 
 /** Represents a 2D texture which can be created dynamically
+ *  If GL_ARB_texture_storage is supported, the texture gets immutable storage (glTexStorage2D). Resizing then moves it to a new
+ *  texture object (the ID returned by GetID changes), so attach it to FBOs again after a resize (resizing to the same size and
+ *  format does nothing).
  *  @note assumes OpenGL2.0 as it doesn't check for power of 2 texture sizes. Also required the FBO extension for some operations.
  *  @author Bjarke N. Laustsen
  */
@@ -23,6 +27,13 @@ class Texture2D : public ITexture2D {
   private:
 
     GLuint texID;
+    int version; // see GetVersion
+
+    // the size and format of the texture (only read from OpenGL when texID has changed since - f.e. by SetID)
+    int texWidth, texHeight;
+    TexelFormat texFormat;
+    GLuint infoID; // the texID they belong to (0 = none)
+    void ReadInfo();
 
     GLint   GetGLInternalFormat(TexelFormat format);
     GLenum  GetGLFormat(TexelFormat format);
@@ -37,9 +48,14 @@ class Texture2D : public ITexture2D {
 
     void CreateOrModifyTexture(int width, int height, TexelFormat format, TextureWrap wrapS, TextureWrap wrapT, TextureFilter filterMag, TextureFilter filterMin);
     void CopyTexture(ITexture2DPtr destTexture);
+    void ReleaseBindlessHandle(const bool keepContent);
     unsigned char* GetData(GLenum type);
+    void SetSubData(int x, int y, int width, int height, GLenum type, const void* data, int rowStride);
     void CheckGLErrors (const char *label);
 
+    static int textureStorage; // -1 = not checked yet
+    static bool HasTextureStorage();
+
     Texture2D() {}
 
   public:
@@ -82,6 +98,13 @@ class Texture2D : public ITexture2D {
     float* GetFloatData();
     void SetData(unsigned char* data);
     void SetFloatData(float* data);
+    void SetSubData     (int x, int y, int width, int height, unsigned char* data, int rowStride = 0);
+    void SetFloatSubData(int x, int y, int width, int height, float* data, int rowStride = 0);
+
+    int  GetVersion();
+    void IncrementVersion();
+
+    void SwapContent(ITexture2DPtr texture);
 
     ImageType GetImageType();         // texture2D, renderbuffer, ...
 
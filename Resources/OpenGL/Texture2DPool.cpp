@@ -0,0 +1,49 @@
+#include "Texture2DPool.h"
+
+namespace OpenEngine {
+namespace Resources {
+
+vector<ITexture2DPtr> Texture2DPool::unused;
+unsigned int Texture2DPool::maxUnused = 16;
+
+/** Get a texture with the given size and format - an unused one from the pool if there is one, otherwise a new.
+ *  The content of the texture is undefined.
+ *  @return the texture
+ */
+ITexture2DPtr Texture2DPool::Acquire(int width, int height, TexelFormat format, TextureWrap wrapS, TextureWrap wrapT, TextureFilter filterMag, TextureFilter filterMin) {
+    for (unsigned int i=0; i<unused.size(); i++) {
+	ITexture2DPtr tex = unused.at(i);
+	if ((int)tex->GetWidth() != width || (int)tex->GetHeight() != height || tex->GetFormat() != format) continue;
+
+	unused.erase(unused.begin() + i);
+	tex->SetWrapS(wrapS);
+	tex->SetWrapT(wrapT);
+	tex->SetMagFilter(filterMag);
+	tex->SetMinFilter(filterMin);
+	return tex;
+    }
+    return ITexture2DPtr(new Texture2D(width, height, format, wrapS, wrapT, filterMag, filterMin));
+}
+
+/** Give a texture back to the pool. If the pool is full, the oldest unused texture is deleted.
+ *  @param[in] tex the texture (ignored if NULL)
+ */
+void Texture2DPool::Release(ITexture2DPtr tex) {
+    if (tex.get() == NULL) return;
+    unused.push_back(tex);
+    if (unused.size() > maxUnused) unused.erase(unused.begin());
+}
+
+/** Set the max number of unused textures kept in the pool (0 disables pooling)
+ */
+void Texture2DPool::SetMaxUnused(unsigned int maxUnused) {
+    Texture2DPool::maxUnused = maxUnused;
+    while (unused.size() > maxUnused) unused.erase(unused.begin());
+}
+
+void Texture2DPool::Clear() {
+    unused.clear();
+}
+
+} // NS Resources
+} // NS OpenEngine
@@ -0,0 +1,38 @@
+#ifndef __TEXTURE2DPOOL_H__
+#define __TEXTURE2DPOOL_H__
+
+#include <Resources/ITexture2D.h>
+#include <Resources/OpenGL/Texture2D.h>
+
+#include <vector>
+
+namespace OpenEngine {
+namespace Resources {
+
+using namespace std;
+
+/** A pool of unused textures, so that render-target textures (f.e. the userbuffers of passes) can be reused
+ *  instead of being deleted and created again, which is slow.
+ *  A texture is only reused for a request of the same width, height and texel format - so scalar
+ *  userbuffers (TEX_R8, TEX_R16F, ...) are never given a 4-component texture.
+ */
+class Texture2DPool {
+
+  private:
+
+    static vector<ITexture2DPtr> unused;
+    static unsigned int maxUnused;
+
+  public:
+
+    static ITexture2DPtr Acquire(int width, int height, TexelFormat format, TextureWrap wrapS, TextureWrap wrapT, TextureFilter filterMag, TextureFilter filterMin);
+    static void Release(ITexture2DPtr tex); // the texture must not be used by the caller afterwards
+
+    static void SetMaxUnused(unsigned int maxUnused);
+    static void Clear(); // delete all unused textures
+};
+
+} // NS Resources
+} // NS OpenEngine
+
+#endif
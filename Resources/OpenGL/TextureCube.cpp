@@ -224,12 +224,15 @@ int TextureCube::GetZDepth() {
 }
 
 ColorFormat TextureCube::GetColorFormat() {
-    unsigned int depth = GetDepth();
-    if (depth==32)
+    // (by number of components, as the bit depth doesn't tell - e.g. RG16F and RGB10A2 are 32 bit as well)
+    if (GetFormat()==TEX_DEPTH || GetFormat()==TEX_DEPTH_STENCIL)
+        throw Exception("unknown color depth");
+    int numComponents = GetNumComponents();
+    if (numComponents==4)
         return RGBA;
-    else if (depth==24)
+    else if (numComponents==3)
         return RGB;
-    else if (depth==8)
+    else if (numComponents==1)
         return LUMINANCE;
     else
         throw Exception("unknown color depth");
@@ -249,6 +252,15 @@ unsigned int TextureCube::GetDepth() {
 	case TEX_LUMINANCE_FLOAT: return 16;
 	case TEX_RGB_FLOAT:	  return 16*3;
 	case TEX_RGBA_FLOAT:	  return 16*4;
+	case TEX_RG16F:	          return 16*2;
+	case TEX_R16F:	          return 16;
+	case TEX_R11G11B10F:	  return 32;
+	case TEX_RGB10A2:	  return 32;
+	case TEX_R8:	          return 8;
+	case TEX_RG8:	          return 8*2;
+	case TEX_R32F:	          return 32;
+	case TEX_RG32F:	          return 32*2;
+	case TEX_RGBA32F:	  return 32*4;
 	default:                  throw PPEResourceException("GetDepth: illegal format");
     }
 }
@@ -279,7 +291,7 @@ void TextureCube::Resize(int width, int height, TexelFormat format) { // gldelet
 /* these returns opengl stuff depending on the instance vars */
 GLint TextureCube::GetGLInternalFormat(TexelFormat format) {
     switch (format) {
-	case TEX_DEPTH:           return GL_DEPTH_COMPONENT;
+	case TEX_DEPTH:           return GL_DEPTH_COMPONENT24; // <- sized, so it matches the depth renderbuffers it is blitted from
 	case TEX_DEPTH_STENCIL:   return GL_DEPTH24_STENCIL8_EXT;
 	case TEX_LUMINANCE:       return GL_LUMINANCE8;
 	case TEX_RGB:	          return GL_RGB8;
@@ -287,6 +299,15 @@ GLint TextureCube::GetGLInternalFormat(TexelFormat format) {
 	case TEX_LUMINANCE_FLOAT: return GL_LUMINANCE16F_ARB;
 	case TEX_RGB_FLOAT:	  return GL_RGB16F_ARB;
 	case TEX_RGBA_FLOAT:	  return GL_RGBA16F_ARB;
+	case TEX_RG16F:	          return GL_RG16F;
+	case TEX_R16F:	          return GL_R16F;
+	case TEX_R11G11B10F:	  return GL_R11F_G11F_B10F_EXT;
+	case TEX_RGB10A2:	  return GL_RGB10_A2;
+	case TEX_R8:	          return GL_R8;
+	case TEX_RG8:	          return GL_RG8;
+	case TEX_R32F:	          return GL_R32F;
+	case TEX_RG32F:	          return GL_RG32F;
+	case TEX_RGBA32F:	  return GL_RGBA32F_ARB;
 	default:                  throw PPEResourceException("getGLInternalFormat: illegal format");
     }
 }
@@ -301,6 +322,15 @@ GLenum TextureCube::GetGLFormat(TexelFormat format) {
 	case TEX_LUMINANCE_FLOAT: return GL_LUMINANCE;
 	case TEX_RGB_FLOAT:	  return GL_RGB;
 	case TEX_RGBA_FLOAT:	  return GL_RGBA;
+	case TEX_RG16F:	          return GL_RG;
+	case TEX_R16F:	          return GL_RED;
+	case TEX_R11G11B10F:	  return GL_RGB;
+	case TEX_RGB10A2:	  return GL_RGBA;
+	case TEX_R8:	          return GL_RED;
+	case TEX_RG8:	          return GL_RG;
+	case TEX_R32F:	          return GL_RED;
+	case TEX_RG32F:	          return GL_RG;
+	case TEX_RGBA32F:	  return GL_RGBA;
 	default:                  throw PPEResourceException("getGLFormat: illegal format");
     }
 }
@@ -337,6 +367,7 @@ GLsizei TextureCube::GetGLHeight(int height) {
 TexelFormat TextureCube::GetOEInternalFormat(GLint glInternalFormat) {
     switch (glInternalFormat) {
 	case GL_DEPTH_COMPONENT:      return TEX_DEPTH;
+	case GL_DEPTH_COMPONENT24:    return TEX_DEPTH;
 	case GL_DEPTH24_STENCIL8_EXT: return TEX_DEPTH_STENCIL;
 	case GL_LUMINANCE8:           return TEX_LUMINANCE;
 	case GL_RGB8:                 return TEX_RGB;
@@ -344,6 +375,15 @@ TexelFormat TextureCube::GetOEInternalFormat(GLint glInternalFormat) {
 	case GL_LUMINANCE16F_ARB:     return TEX_LUMINANCE_FLOAT;
 	case GL_RGB16F_ARB:           return TEX_RGB_FLOAT;
 	case GL_RGBA16F_ARB:          return TEX_RGBA_FLOAT;
+	case GL_RG16F:                return TEX_RG16F;
+	case GL_R16F:                 return TEX_R16F;
+	case GL_R11F_G11F_B10F_EXT:   return TEX_R11G11B10F;
+	case GL_RGB10_A2:             return TEX_RGB10A2;
+	case GL_R8:                   return TEX_R8;
+	case GL_RG8:                  return TEX_RG8;
+	case GL_R32F:                 return TEX_R32F;
+	case GL_RG32F:                return TEX_RG32F;
+	case GL_RGBA32F_ARB:          return TEX_RGBA32F;
 	default:                      throw PPEResourceException("getOEInternalFormat: illegal format");
     }
 }
@@ -455,6 +495,15 @@ int TextureCube::GetNumComponents() {
 	case TEX_LUMINANCE_FLOAT: return 1;
 	case TEX_RGB_FLOAT:	  return 3;
 	case TEX_RGBA_FLOAT:	  return 4;
+	case TEX_RG16F:	          return 2;
+	case TEX_R16F:	          return 1;
+	case TEX_R11G11B10F:	  return 3;
+	case TEX_RGB10A2:	  return 4;
+	case TEX_R8:	          return 1;
+	case TEX_RG8:	          return 2;
+	case TEX_R32F:	          return 1;
+	case TEX_RG32F:	          return 2;
+	case TEX_RGBA32F:	  return 4;
 	default:                  throw PPEResourceException("GetNumComponents: illegal format");
     }
 }
@@ -0,0 +1,112 @@
+#include "TextureReadback.h"
+
+#include <string.h>
+
+namespace OpenEngine {
+namespace Resources {
+
+/** Create a readback of the given texture.
+ *  @param[in] texture the texture to read (a color texture - it is read as floats)
+ *  @param[in] numBuffers the number of buffers in the ring (the number of reads which can be in flight at once)
+ */
+TextureReadback::TextureReadback(ITexture2DPtr texture, int numBuffers) {
+    if (texture.get() == NULL) throw PPEResourceException("texture was NULL");
+    if (numBuffers < 1) throw PPEResourceException("at least one buffer is needed");
+
+    this->texture = texture;
+    this->fbo     = new FramebufferObject();
+    this->hasData = false;
+    Allocate(numBuffers);
+}
+
+TextureReadback::~TextureReadback() {
+    Delete();
+    delete fbo;
+}
+
+/** Start reading the texture into the next buffer, and map the buffer read numBuffers-1 reads ago (see GetData).
+ *  If the texture has been resized since the last read, the buffers are reallocated (and the reads in flight are lost).
+ */
+void TextureReadback::Read() {
+    GLsizeiptr newSize = (GLsizeiptr)texture->GetWidth() * texture->GetHeight() * texture->GetNumComponents() * sizeof(float);
+    if (newSize != size) {
+	int numBuffers = pboIDs.size();
+	Delete();
+	Allocate(numBuffers);
+    }
+
+    // (the fbo binding can't be pushed - see FramebufferObject)
+    GLint savedFboID;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING_EXT, &savedFboID);
+    fbo->Bind();
+    glReadBuffer(GL_COLOR_ATTACHMENT0_EXT);
+
+    // with a pack buffer bound, the data argument of glReadPixels is an offset into it
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pboIDs.at(numRead % pboIDs.size()));
+    glReadPixels(0, 0, texture->GetWidth(), texture->GetHeight(), GetGLFormat(), GL_FLOAT, NULL);
+    numRead++;
+
+    // the oldest read (the next buffer of the ring)
+    if (numRead >= pboIDs.size()) {
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, pboIDs.at(numRead % pboIDs.size()));
+	float* ptr = (float*)glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+	if (ptr != NULL) {
+	    memcpy(&data[0], ptr, size);
+	    hasData = true;
+	    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, (GLuint)savedFboID);
+}
+
+/** Get the data of the latest read which has been mapped (the texture as it was numBuffers-1 reads ago).
+ *  @param[out] data width*height*numcomponents floats, row by row, bottom row first
+ *  @return false if no read has been mapped yet
+ */
+bool TextureReadback::GetData(float* data) {
+    if (!hasData) return false;
+    memcpy(data, &this->data[0], size);
+    return true;
+}
+
+/** get the texture read
+ */
+ITexture2DPtr TextureReadback::GetTexture() {
+    return texture;
+}
+
+// the format the texels are read in (all the components of the texture)
+GLenum TextureReadback::GetGLFormat() {
+    switch (texture->GetNumComponents()) {
+	case 1:  return GL_RED;
+	case 2:  return GL_RG;
+	case 3:  return GL_RGB;
+	default: return GL_RGBA;
+    }
+}
+
+void TextureReadback::Allocate(int numBuffers) {
+    size = (GLsizeiptr)texture->GetWidth() * texture->GetHeight() * texture->GetNumComponents() * sizeof(float);
+    data.assign(size / sizeof(float), 0.0f);
+    hasData = false;
+    numRead = 0;
+    fbo->AttachColorTexture(texture, 0); // <- (again, as a resized texture may have a new texture-handle)
+
+    pboIDs.resize(numBuffers);
+    glGenBuffers(numBuffers, &pboIDs[0]);
+    for (int i=0; i<numBuffers; i++) {
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, pboIDs.at(i));
+	glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void TextureReadback::Delete() {
+    if (pboIDs.empty()) return;
+    glDeleteBuffers(pboIDs.size(), &pboIDs[0]);
+    pboIDs.clear();
+}
+
+} // NS Resources
+} // NS OpenEngine
@@ -0,0 +1,61 @@
+#ifndef __TEXTUREREADBACK_H__
+#define __TEXTUREREADBACK_H__
+
+#include <Resources/ITexture2D.h>
+#include <Resources/PPEResourceException.h>
+#include <Resources/OpenGL/FramebufferObject.h>
+#include <Logging/Logger.h>
+
+#include <Meta/OpenGL.h>
+#include <vector>
+
+namespace OpenEngine {
+namespace Resources {
+
+using namespace std;
+
+/** Reads the content of a (small) float texture back to the CPU every frame (f.e. the results of Reduction or Histogram)
+ *  without stalling the pipeline - the counterpart of TextureStreamer.
+ *  The texels are read into one of a ring of pixel buffer objects, and the buffer read numBuffers-1 reads ago is mapped,
+ *  which the GPU has normally finished by then. So the data is numBuffers-1 reads late.
+ *
+ *  Usage (each frame, after the texture has been rendered):
+ *
+ *    readback.Read();
+ *    if (readback.GetData(values)) ...use width*height*numcomponents floats...
+ *
+ *  @note OpenGL 2.1 (pixel buffer objects) or above only
+ */
+class TextureReadback {
+
+  private:
+
+    ITexture2DPtr texture;
+    FramebufferObject* fbo; // the texture attached (read with glReadPixels)
+    GLsizeiptr size;        // bytes per read
+
+    vector<GLuint> pboIDs;
+    unsigned int numRead;   // the number of reads started
+
+    vector<float> data;     // the latest data mapped
+    bool hasData;
+
+    GLenum GetGLFormat();
+    void Allocate(int numBuffers);
+    void Delete();
+
+  public:
+
+    TextureReadback(ITexture2DPtr texture, int numBuffers = 3);
+    ~TextureReadback();
+
+    void Read();                // start reading the texture, and pick up the oldest read
+    bool GetData(float* data);  // the latest data read (width*height*numcomponents floats) - false if none yet
+
+    ITexture2DPtr GetTexture();
+};
+
+} // NS Resources
+} // NS OpenEngine
+
+#endif
@@ -0,0 +1,165 @@
+#include "TextureStreamer.h"
+
+#include <string.h>
+
+namespace OpenEngine {
+namespace Resources {
+
+int TextureStreamer::bufferStorage = -1;
+
+/** Create a streamer uploading to the given texture.
+ *  @param[in] texture the texture to upload to (the texels must match its format - width*height*numcomponents values)
+ *  @param[in] floatData whether the texels are floats (otherwise unsigned bytes)
+ *  @param[in] numBuffers the number of buffers in the ring (the number of uploads which can be in flight at once)
+ */
+TextureStreamer::TextureStreamer(ITexture2DPtr texture, const bool floatData, int numBuffers) {
+    if (texture.get() == NULL) throw PPEResourceException("texture was NULL");
+    if (numBuffers < 1) throw PPEResourceException("at least one buffer is needed");
+
+    this->texture    = texture;
+    this->type       = floatData ? GL_FLOAT : GL_UNSIGNED_BYTE;
+    this->current    = 0;
+    this->mapped     = false;
+    this->persistent = HasBufferStorage();
+    Allocate(numBuffers);
+}
+
+TextureStreamer::~TextureStreamer() {
+    Delete();
+}
+
+/** Get the memory to write the texels of the next upload to (width*height*numcomponents values, row by row, bottom row first).
+ *  If the texture has been resized since the last upload, the buffers are reallocated.
+ *  @return the memory (valid until Unmap is called)
+ */
+void* TextureStreamer::Map() {
+    if (mapped) throw PPEResourceException("already mapped");
+    if (GetUploadSize() != size) {
+	int numBuffers = pboIDs.size();
+	Delete();
+	Allocate(numBuffers);
+    }
+    mapped = true;
+
+    if (persistent) {
+	WaitForBuffer(current); // <- only waits if the GPU is still reading the buffer from numBuffers uploads ago
+	return pointers.at(current);
+    }
+
+    // orphan the buffer first, so mapping doesn't wait for the GPU to finish reading the old content
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pboIDs.at(current));
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+    void* ptr = glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (ptr == NULL) {
+	mapped = false;
+	throw PPEResourceException("glMapBuffer failed");
+    }
+    return ptr;
+}
+
+/** Upload the texels written since Map to the texture. The copy is done by the GPU, so this returns immediately.
+ */
+void TextureStreamer::Unmap() {
+    if (!mapped) throw PPEResourceException("not mapped");
+    mapped = false;
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pboIDs.at(current));
+    if (!persistent) glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    // with an unpack buffer bound, the data argument is an offset into it
+    if (type == GL_FLOAT) texture->SetFloatSubData(0, 0, texture->GetWidth(), texture->GetHeight(), (float*)NULL);
+    else                  texture->SetSubData     (0, 0, texture->GetWidth(), texture->GetHeight(), (unsigned char*)NULL);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+#ifdef GL_ARB_buffer_storage
+    if (persistent) fences.at(current) = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+#endif
+    current = (current + 1) % pboIDs.size();
+}
+
+/** Copy the texels to the next buffer and upload them (when the texels are already in memory).
+ *  @param[in] data the texels (width*height*numcomponents values)
+ */
+void TextureStreamer::Upload(const void* data) {
+    void* ptr = Map();
+    memcpy(ptr, data, size);
+    Unmap();
+}
+
+/** get the texture uploaded to
+ */
+ITexture2DPtr TextureStreamer::GetTexture() {
+    return texture;
+}
+
+GLsizeiptr TextureStreamer::GetUploadSize() {
+    GLsizeiptr elemSize = (type == GL_FLOAT) ? sizeof(float) : 1;
+    return (GLsizeiptr)texture->GetWidth() * texture->GetHeight() * texture->GetNumComponents() * elemSize;
+}
+
+void TextureStreamer::Allocate(int numBuffers) {
+    size = GetUploadSize();
+    pboIDs.resize(numBuffers);
+    pointers.assign(numBuffers, (void*)NULL);
+    fences.assign(numBuffers, (GLsync)0);
+    glGenBuffers(numBuffers, &pboIDs[0]);
+
+    for (int i=0; i<numBuffers; i++) {
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pboIDs.at(i));
+#ifdef GL_ARB_buffer_storage
+	if (persistent) {
+	    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	    glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, NULL, flags);
+	    pointers.at(i) = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags);
+	    continue;
+	}
+#endif
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    current = 0;
+}
+
+void TextureStreamer::Delete() {
+    if (pboIDs.empty()) return;
+    for (unsigned int i=0; i<pboIDs.size(); i++) {
+	WaitForBuffer(i);
+	if (persistent || (mapped && (int)i == current)) {
+	    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pboIDs.at(i));
+	    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	}
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glDeleteBuffers(pboIDs.size(), &pboIDs[0]);
+    pboIDs.clear();
+    mapped = false;
+}
+
+// wait until the GPU has finished reading buffer i (persistent mapping only - orphaning makes it unnecessary)
+void TextureStreamer::WaitForBuffer(int i) {
+#ifdef GL_ARB_buffer_storage
+    if (fences.at(i) == 0) return;
+    GLenum result = glClientWaitSync(fences.at(i), GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000); // (1 sec)
+    if (result == GL_TIMEOUT_EXPIRED || result == GL_WAIT_FAILED)
+	logger.warning << "TextureStreamer: waiting for an upload failed" << logger.end;
+    glDeleteSync(fences.at(i));
+    fences.at(i) = 0;
+#endif
+}
+
+/* whether buffers can be persistently mapped (GL_ARB_buffer_storage) */
+bool TextureStreamer::HasBufferStorage() {
+    if (bufferStorage == -1) {
+#ifdef GL_ARB_buffer_storage
+	const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+	bufferStorage = (extensions != NULL && strstr(extensions, "GL_ARB_buffer_storage") != NULL) ? 1 : 0;
+#else
+	bufferStorage = 0;
+#endif
+    }
+    return bufferStorage == 1;
+}
+
+} // NS Resources
+} // NS OpenEngine
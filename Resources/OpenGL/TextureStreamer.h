@@ -0,0 +1,72 @@
+#ifndef __TEXTURESTREAMER_H__
+#define __TEXTURESTREAMER_H__
+
+#include <Resources/ITexture2D.h>
+#include <Resources/PPEResourceException.h>
+#include <Logging/Logger.h>
+
+#include <Meta/OpenGL.h>
+#include <vector>
+
+namespace OpenEngine {
+namespace Resources {
+
+using namespace std;
+
+/** Uploads new content to a texture every frame (f.e. LUTs, noise or video frames bound to a pass with BindTexture)
+ *  without stalling the pipeline.
+ *  The texels are written to one of a ring of pixel buffer objects and copied to the texture from there, so the
+ *  copy runs asynchronously and the CPU never waits for the GPU to finish with the previous upload.
+ *  If GL_ARB_buffer_storage is supported, the buffers are persistently mapped (and guarded by fences), otherwise
+ *  each buffer is orphaned and mapped again per upload.
+ *
+ *  Usage (each frame):
+ *
+ *    unsigned char* texels = (unsigned char*)streamer.Map();
+ *    ...write width*height*numcomponents texels...
+ *    streamer.Unmap(); // <- starts the upload
+ *
+ *  @note OpenGL 2.1 (pixel buffer objects) or above only
+ */
+class TextureStreamer {
+
+  private:
+
+    ITexture2DPtr texture;
+    GLenum type;           // GL_UNSIGNED_BYTE or GL_FLOAT
+    GLsizeiptr size;       // bytes per upload
+
+    vector<GLuint> pboIDs;
+    int  current;          // the buffer being written to
+    bool mapped;
+
+    // persistent mapping (GL_ARB_buffer_storage)
+    bool persistent;
+    vector<void*>  pointers;
+    vector<GLsync> fences; // (0 = the buffer isn't being read by the GPU)
+
+    static int bufferStorage; // -1 = not checked yet
+    static bool HasBufferStorage();
+
+    GLsizeiptr GetUploadSize();
+    void Allocate(int numBuffers);
+    void Delete();
+    void WaitForBuffer(int i);
+
+  public:
+
+    TextureStreamer(ITexture2DPtr texture, const bool floatData = false, int numBuffers = 3);
+    ~TextureStreamer();
+
+    void* Map();   // where to write the texels of the next upload (valid until Unmap)
+    void  Unmap(); // upload the texels written since Map to the texture
+
+    void Upload(const void* data); // copy data to the next buffer and upload it (Map, memcpy, Unmap)
+
+    ITexture2DPtr GetTexture();
+};
+
+} // NS Resources
+} // NS OpenEngine
+
+#endif
@@ -0,0 +1,218 @@
+#include "UniformBlock.h"
+
+#include <string.h>
+
+namespace OpenEngine {
+namespace Resources {
+
+int UniformBlock::nextBindingPoint = 0;
+vector<int> UniformBlock::freeBindingPoints;
+int UniformBlock::supported = -1;
+
+/** create an (empty) uniform block. No GL calls are made before the first upload.
+ *  @param[in] name the name of the uniform block in the fragment programs
+ */
+UniformBlock::UniformBlock(string name) {
+    this->name            = name;
+    this->bufferID        = 0;
+    this->end             = 0;
+    this->version         = 0;
+    this->uploadedVersion = -1;
+
+    // each block has its own binding point, so it never has to be rebound
+    if (freeBindingPoints.empty()) bindingPoint = nextBindingPoint++;
+    else {
+	bindingPoint = freeBindingPoints.back();
+	freeBindingPoints.pop_back();
+    }
+}
+
+UniformBlock::~UniformBlock() {
+    if (bufferID != 0) glDeleteBuffers(1, &bufferID);
+    freeBindingPoints.push_back(bindingPoint);
+}
+
+/** get the name of the block
+ */
+string UniformBlock::GetName() {
+    return name;
+}
+
+/** add a float, vec2, vec3 or vec4 field
+ *  @param[in] fieldName the name of the field
+ *  @param[in] n the vector dimension (1,2,3 or 4)
+ *  @exception PPEResourceException thrown if n is not 1,2,3 or 4
+ */
+void UniformBlock::AddFloat(string fieldName, int n) {
+    if (n<1 || n>4) throw PPEResourceException("unsupported vector dimension");
+    AddField(fieldName, n, false);
+}
+
+/** add a mat2, mat3 or mat4 field
+ *  @param[in] fieldName the name of the field
+ *  @param[in] n the matrix dimension (2,3 or 4)
+ *  @exception PPEResourceException thrown if n is not 2,3 or 4
+ */
+void UniformBlock::AddMatrix(string fieldName, int n) {
+    if (n<2 || n>4) throw PPEResourceException("unsupported matrix dimension");
+    AddField(fieldName, n, true);
+}
+
+void UniformBlock::AddField(string fieldName, int n, bool matrix) {
+    if (GetField(fieldName) != NULL) throw PPEResourceException("field already added to uniform block");
+
+    // std140: scalars are aligned to 4 bytes, vec2 to 8, vec3 and vec4 to 16, and each matrix column is a vec4
+    // (so a float after a vec2 is at byte 8, and a float after a vec3 at byte 12)
+    int align = (matrix || n>=3) ? 4 : n;
+    int size  = matrix ? 4*n : n;
+    int offset = (end + align-1) / align * align;
+
+    Field field;
+    field.name   = fieldName;
+    field.size   = n;
+    field.matrix = matrix;
+    field.offset = offset;
+    field.value  = vector<float>(matrix ? n*n : n, 0.0f);
+    fields.push_back(field);
+
+    // (the size of the whole block is rounded up to a vec4 - the fields after this one are still packed after its end)
+    end = offset + size;
+    data.resize((end + 3) / 4 * 4, 0.0f);
+    version++;
+}
+
+/** set the value of a float, vec2, vec3 or vec4 field
+ *  @param[in] fieldName the name of the field
+ *  @param[in] floatvector the value (must have the dimension of the field)
+ *  @exception PPEResourceException thrown if the field doesn't exist or has another dimension
+ */
+void UniformBlock::SetFloat(string fieldName, vector<float> floatvector) {
+    Field* field = GetField(fieldName);
+    if (field == NULL || field->matrix) throw PPEResourceException("no such vector field in uniform block");
+    if ((int)floatvector.size() != field->size) throw PPEResourceException("wrong vector dimension");
+    if (field->value == floatvector) return;
+
+    field->value = floatvector;
+    for (int i=0; i<field->size; i++) data[field->offset + i] = floatvector[i];
+    version++;
+}
+
+/** set the value of a matrix field
+ *  @param[in] fieldName the name of the field
+ *  @param[in] floatmatrix the matrix in column-major order (n*n values)
+ *  @exception PPEResourceException thrown if the field doesn't exist or has another dimension
+ */
+void UniformBlock::SetMatrix(string fieldName, vector<float> floatmatrix) {
+    Field* field = GetField(fieldName);
+    if (field == NULL || !field->matrix) throw PPEResourceException("no such matrix field in uniform block");
+    int n = field->size;
+    if ((int)floatmatrix.size() != n*n) throw PPEResourceException("wrong matrix dimension");
+    if (field->value == floatmatrix) return;
+
+    field->value = floatmatrix;
+    for (int c=0; c<n; c++)
+	for (int r=0; r<n; r++)
+	    data[field->offset + c*4 + r] = floatmatrix[c*n + r]; // <- each column is padded to a vec4
+    version++;
+}
+
+/** get the names of the fields (in the order they were added)
+ */
+vector<string> UniformBlock::GetFieldNames() {
+    vector<string> names;
+    for (unsigned int i=0; i<fields.size(); i++) names.push_back(fields.at(i).name);
+    return names;
+}
+
+/** get the value of a field (matrices in column-major order)
+ */
+vector<float> UniformBlock::GetValue(string fieldName) {
+    Field* field = GetField(fieldName);
+    if (field == NULL) throw PPEResourceException("no such field in uniform block");
+    return field->value;
+}
+
+/** get the vector dimension (or matrix dimension n) of a field
+ */
+int UniformBlock::GetFieldSize(string fieldName) {
+    Field* field = GetField(fieldName);
+    if (field == NULL) throw PPEResourceException("no such field in uniform block");
+    return field->size;
+}
+
+/** whether a field is a matrix
+ */
+bool UniformBlock::IsMatrix(string fieldName) {
+    Field* field = GetField(fieldName);
+    if (field == NULL) throw PPEResourceException("no such field in uniform block");
+    return field->matrix;
+}
+
+/** get the std140 offset of a field in bytes (f.e. to check it against the offset the compiler gave it - see
+ *  LinkedProgram::BindUniformBlock)
+ */
+int UniformBlock::GetFieldOffset(string fieldName) {
+    Field* field = GetField(fieldName);
+    if (field == NULL) throw PPEResourceException("no such field in uniform block");
+    return field->offset * sizeof(GLfloat);
+}
+
+/** get the OpenGL handle of the buffer (0 if uniform buffers are not supported or nothing has been uploaded yet)
+ */
+int UniformBlock::GetID() {
+    return (int)bufferID;
+}
+
+/** get the uniform buffer binding point of this block
+ */
+int UniformBlock::GetBindingPoint() {
+    return bindingPoint;
+}
+
+/** get the version of the values (incremented each time a value changes)
+ */
+int UniformBlock::GetVersion() {
+    return version;
+}
+
+/** Upload the values, if any have changed since the last upload.
+ *  The old buffer storage is orphaned, so the upload never waits for passes still using the old values.
+ *  Does nothing if uniform buffers are not supported (then the values are set as ordinary uniforms).
+ */
+void UniformBlock::Upload() {
+    if (uploadedVersion == version || !IsSupported() || data.empty()) return;
+
+    if (bufferID == 0) {
+	GLint maxBindings;
+	glGetIntegerv(GL_MAX_UNIFORM_BUFFER_BINDINGS, &maxBindings);
+	if (bindingPoint >= maxBindings) logger.error << "too many uniform blocks - \"" << name << "\" will not work" << logger.end;
+	glGenBuffers(1, &bufferID);
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, bufferID);
+    glBufferData(GL_UNIFORM_BUFFER, data.size()*sizeof(GLfloat), NULL, GL_STREAM_DRAW); // <- orphan
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, data.size()*sizeof(GLfloat), &data[0]);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, bufferID);
+
+    uploadedVersion = version;
+}
+
+UniformBlock::Field* UniformBlock::GetField(string fieldName) {
+    for (unsigned int i=0; i<fields.size(); i++)
+	if (fields.at(i).name == fieldName) return &fields.at(i);
+    return NULL;
+}
+
+/** whether uniform buffers are supported by this gfx-card (GL_ARB_uniform_buffer_object)
+ */
+bool UniformBlock::IsSupported() {
+    if (supported == -1) {
+	const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+	supported = (extensions != NULL && strstr(extensions, "GL_ARB_uniform_buffer_object") != NULL) ? 1 : 0;
+    }
+    return supported == 1;
+}
+
+} // NS Resources
+} // NS OpenEngine
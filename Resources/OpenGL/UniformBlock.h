@@ -0,0 +1,93 @@
+#ifndef __UNIFORMBLOCK_H__
+#define __UNIFORMBLOCK_H__
+
+#include <Resources/IUniformBlock.h>
+#include <Resources/PPEResourceException.h>
+#include <Logging/Logger.h>
+
+#include <Meta/OpenGL.h>
+
+#include <vector>
+#include <string>
+
+namespace OpenEngine {
+namespace Resources {
+
+using namespace std;
+
+/** A uniform block backed by a Uniform Buffer Object, for values shared by many passes (screen size, time,
+ *  camera near/far, ...). The values are uploaded once per change (orphaning the buffer), and every fragment
+ *  program using the block only binds it by block index, so the cost doesn't grow with the number of passes.
+ *
+ *  The fields are laid out as std140, in the order they are added, so the fragment programs must declare
+ *  the block with the same fields in the same order. If uniform buffers are not supported, the fields are
+ *  set as ordinary uniforms instead - the define PPE_UNIFORM_BUFFERS tells the fragment program which:
+ *
+ *    #ifdef PPE_UNIFORM_BUFFERS
+ *    #extension GL_ARB_uniform_buffer_object : require
+ *    layout(std140) uniform PerFrame { vec2 screenSize; float time; };
+ *    #else
+ *    uniform vec2 screenSize; uniform float time;
+ *    #endif
+ *
+ *  @note: requires GL_ARB_uniform_buffer_object (OpenGL 3.1) for the buffer, otherwise it falls back to ordinary uniforms
+ */
+class UniformBlock : public IUniformBlock {
+
+  private:
+
+    struct Field {
+	string name;
+	int    size;   // vector dimension (or matrix dimension n)
+	bool   matrix;
+	int    offset; // std140 offset (in floats)
+	vector<float> value;
+    };
+    vector<Field> fields;
+
+    string         name;
+    vector<GLfloat> data; // the std140 buffer contents (padded to a vec4 after the last field)
+    int            end;  // the end of the last field (in floats) - the next field is aligned from here, not from the padding
+    GLuint bufferID;
+    int    bindingPoint;
+    int    version;
+    int    uploadedVersion;
+
+    Field* GetField(string fieldName);
+    void   AddField(string fieldName, int n, bool matrix);
+
+    static int nextBindingPoint;
+    static vector<int> freeBindingPoints; // binding points of deleted blocks (reused, so recreating effects doesn't run out)
+    static int supported; // -1 = not checked yet
+
+  public:
+
+    UniformBlock(string name);
+    ~UniformBlock();
+
+    string GetName();
+
+    void AddFloat(string fieldName, int n);
+    void AddMatrix(string fieldName, int n);
+
+    void SetFloat(string fieldName, vector<float> floatvector);
+    void SetMatrix(string fieldName, vector<float> floatmatrix);
+
+    vector<string> GetFieldNames();
+    vector<float>  GetValue(string fieldName);
+    int            GetFieldSize(string fieldName);
+    bool           IsMatrix(string fieldName);
+    int            GetFieldOffset(string fieldName);
+
+    int  GetID();
+    int  GetBindingPoint();
+    int  GetVersion();
+    void Upload();
+
+    static bool IsSupported();
+};
+
+} // NS Resources
+} // NS OpenEngine
+
+#endif
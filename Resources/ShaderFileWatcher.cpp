@@ -0,0 +1,98 @@
+#include "ShaderFileWatcher.h"
+
+#include <Logging/Logger.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <errno.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
+
+namespace OpenEngine {
+namespace Resources {
+
+set<string> ShaderFileWatcher::files;
+
+#ifdef __linux__
+int              ShaderFileWatcher::inotifyFD = -1;
+map<int, string> ShaderFileWatcher::directories;
+#else
+map<string, time_t> ShaderFileWatcher::modificationTimes;
+#endif
+
+/** start watching a file (watching the same file several times is harmless)
+ *  @param[in] resolvedFilename the filename (resolved through the DirectoryManager)
+ */
+void ShaderFileWatcher::Watch(string resolvedFilename) {
+    if (files.find(resolvedFilename) != files.end()) return;
+    files.insert(resolvedFilename);
+
+#ifdef __linux__
+    if (inotifyFD == -1) {
+	inotifyFD = inotify_init1(IN_NONBLOCK);
+	if (inotifyFD == -1) {
+	    logger.error << "could not initialize inotify - shader files will not be watched" << logger.end;
+	    return;
+	}
+    }
+
+    string::size_type slash = resolvedFilename.find_last_of('/');
+    string directory = (slash == string::npos) ? "./" : resolvedFilename.substr(0, slash+1);
+
+    // (adding the same directory again just returns the existing watch descriptor)
+    int wd = inotify_add_watch(inotifyFD, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if (wd == -1) logger.error << "could not watch \"" << directory << "\"" << logger.end;
+    else directories[wd] = (slash == string::npos) ? "" : directory;
+#else
+    modificationTimes[resolvedFilename] = GetModificationTime(resolvedFilename);
+#endif
+}
+
+/** get the watched files which have changed since the last call (each file is only listed once)
+ */
+vector<string> ShaderFileWatcher::GetChangedFiles() {
+    set<string> changed;
+
+#ifdef __linux__
+    if (inotifyFD != -1) {
+	char buffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	for (;;) {
+	    ssize_t length = read(inotifyFD, buffer, sizeof(buffer));
+	    if (length <= 0) break; // <- EAGAIN: no more events
+
+	    for (char* p = buffer; p < buffer + length; ) {
+		struct inotify_event* event = (struct inotify_event*)p;
+		if (event->len > 0) {
+		    string filename = directories[event->wd] + event->name;
+		    if (files.find(filename) != files.end()) changed.insert(filename);
+		}
+		p += sizeof(struct inotify_event) + event->len;
+	    }
+	}
+    }
+#else
+    for (map<string, time_t>::iterator it = modificationTimes.begin(); it != modificationTimes.end(); it++) {
+	time_t modified = GetModificationTime(it->first);
+	if (modified != it->second) {
+	    it->second = modified;
+	    changed.insert(it->first);
+	}
+    }
+#endif
+
+    return vector<string>(changed.begin(), changed.end());
+}
+
+#ifndef __linux__
+time_t ShaderFileWatcher::GetModificationTime(string filename) {
+    struct stat st;
+    if (stat(filename.c_str(), &st) != 0) return 0; // <- might be in the middle of being replaced
+    return st.st_mtime;
+}
+#endif
+
+} // NS Resources
+} // NS OpenEngine
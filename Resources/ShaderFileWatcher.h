@@ -0,0 +1,42 @@
+#ifndef __SHADERFILEWATCHER_H__
+#define __SHADERFILEWATCHER_H__
+
+#include <vector>
+#include <string>
+#include <map>
+#include <set>
+#include <time.h>
+
+namespace OpenEngine {
+namespace Resources {
+
+using namespace std;
+
+/** Watches shader source files for changes (used for hot-reloading shaders while tuning effects).
+ *  On Linux inotify is used (the directories are watched, as most editors save by replacing the file),
+ *  elsewhere the modification times are polled. GetChangedFiles never blocks.
+ */
+class ShaderFileWatcher {
+
+  private:
+
+    static set<string> files; // the watched files
+
+#ifdef __linux__
+    static int inotifyFD; // -1 = not initialized
+    static map<int, string> directories; // inotify watch descriptor -> directory (with trailing slash)
+#else
+    static map<string, time_t> modificationTimes;
+    static time_t GetModificationTime(string filename);
+#endif
+
+  public:
+
+    static void Watch(string resolvedFilename);
+    static vector<string> GetChangedFiles();
+};
+
+} // NS Resources
+} // NS OpenEngine
+
+#endif
@@ -0,0 +1,243 @@
+#include "ShaderPreprocessor.h"
+
+#include <Resources/DirectoryManager.h>
+#include <Logging/Logger.h>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+namespace OpenEngine {
+namespace Resources {
+
+/** preprocess a shader source file
+ *  @param[in] resolvedFilename the filename (resolved through the DirectoryManager)
+ *  @param[in] defines the defines to inject
+ *  @exception PPEResourceException thrown if the file (or an included file) can't be loaded, or an #include is malformed
+ */
+ShaderPreprocessor::ShaderPreprocessor(string resolvedFilename, ShaderDefines defines) {
+    this->defines = defines;
+    this->version = 110;
+    Process(NormalizePath(resolvedFilename), true);
+}
+
+/* append the (expanded) source of a file to the segments */
+void ShaderPreprocessor::Process(string filename, const bool injectDefines) {
+    ShaderSourcePtr source = ShaderSourceStore::GetSource(filename);
+    int sourceNumber = files.size();
+    sources.push_back(source);
+    files.push_back(filename);
+
+    const char* data = source->GetData();
+    const char* end  = data + source->GetLength();
+
+    // (an included file starts counting from its own first line)
+    if (sourceNumber > 0) AddLineDirective(1, sourceNumber);
+
+    // the defines must come after #version (which must be the first thing in the shader), so look for it first
+    bool hasVersion = false;
+    if (injectDefines) {
+	for (const char* line = data; line < end; ) {
+	    const char* lineEnd = (const char*)memchr(line, '\n', end-line);
+	    lineEnd = (lineEnd == NULL) ? end : lineEnd+1;
+	    const char* argument;
+	    if (IsDirective(line, lineEnd, "version", &argument)) {
+		hasVersion = true;
+		version = atoi(argument);
+		break;
+	    }
+	    line = lineEnd;
+	}
+	if (!hasVersion && !defines.empty()) {
+	    AddGenerated(MakeKey(defines));
+	    AddLineDirective(1, sourceNumber);
+	}
+    }
+
+    const char* segmentStart = data;
+    int lineNumber = 1;
+    for (const char* line = data; line < end; lineNumber++) {
+	const char* lineEnd = (const char*)memchr(line, '\n', end-line);
+	lineEnd = (lineEnd == NULL) ? end : lineEnd+1;
+
+	const char* argument;
+	if (hasVersion && IsDirective(line, lineEnd, "version", &argument)) {
+	    // keep the #version line, and put the defines right after it
+	    AddSegment(segmentStart, lineEnd-segmentStart);
+	    segmentStart = lineEnd;
+	    hasVersion = false;
+	    if (!defines.empty()) {
+		AddGenerated(MakeKey(defines));
+		AddLineDirective(lineNumber+1, sourceNumber);
+	    }
+	}
+	else if (IsDirective(line, lineEnd, "include", &argument)) {
+	    char close = (*argument == '<') ? '>' : '"';
+	    const char* nameEnd = (*argument == '"' || *argument == '<') ? (const char*)memchr(argument+1, close, lineEnd-argument-1) : NULL;
+	    if (nameEnd == NULL) {
+		logger.error << "\"" << filename << "\" line " << lineNumber << ": malformed #include" << logger.end;
+		throw PPEResourceException("malformed #include in shader");
+	    }
+	    string name(argument+1, nameEnd);
+
+	    // replace the #include line with the contents of the file
+	    AddSegment(segmentStart, line-segmentStart);
+	    segmentStart = lineEnd;
+
+	    string includeFilename = ResolveInclude(name, filename);
+	    bool alreadyIncluded = false;
+	    for (unsigned int i=0; i<files.size(); i++)
+		if (files.at(i) == includeFilename) alreadyIncluded = true;
+	    if (!alreadyIncluded) {
+		AddGenerated("\n"); // <- in case the previous segment doesn't end with a newline
+		Process(includeFilename, false);
+		AddGenerated("\n");
+	    }
+	    AddLineDirective(lineNumber+1, sourceNumber);
+	}
+	line = lineEnd;
+    }
+    AddSegment(segmentStart, end-segmentStart);
+}
+
+void ShaderPreprocessor::AddSegment(const char* data, int length) {
+    if (length <= 0) return;
+    segments.push_back(data);
+    lengths.push_back(length);
+}
+
+void ShaderPreprocessor::AddGenerated(string text) {
+    generated.push_back(text);
+    AddSegment(generated.back().data(), generated.back().length());
+}
+
+/* make the compiler count lines from the given line of the given source (so errors refer to the original files) */
+void ShaderPreprocessor::AddLineDirective(int line, int sourceNumber) {
+    // GLSL before 3.30 numbers the line following "#line n" as n+1, from 3.30 as n
+    ostringstream directive;
+    directive << "#line " << (version >= 330 ? line : line-1) << " " << sourceNumber << "\n";
+    AddGenerated(directive.str());
+}
+
+/* look for the included file relative to the including file first, and then in the DirectoryManager paths */
+string ShaderPreprocessor::ResolveInclude(string name, string includingFilename) {
+    string::size_type slash = includingFilename.find_last_of("/\\");
+    if (slash != string::npos) {
+	string relative = NormalizePath(includingFilename.substr(0, slash+1) + name);
+	FILE* fp = fopen(relative.c_str(), "rb");
+	if (fp != NULL) {
+	    fclose(fp);
+	    return relative;
+	}
+    }
+    return DirectoryManager::FindFileInPath(name);
+}
+
+/* remove "." and "dir/.." from a path, so the same file always gets the same name (needed to only include files once) */
+string ShaderPreprocessor::NormalizePath(string path) {
+    vector<string> parts;
+    string::size_type start = 0;
+    while (start <= path.length()) {
+	string::size_type slash = path.find_first_of("/\\", start);
+	if (slash == string::npos) slash = path.length();
+	string part = path.substr(start, slash-start);
+	if (part == ".") {}
+	else if (part == ".." && !parts.empty() && parts.back() != ".." && parts.back() != "") parts.pop_back();
+	else parts.push_back(part);
+	start = slash+1;
+    }
+    string normalized;
+    for (unsigned int i=0; i<parts.size(); i++)
+	normalized += (i == 0) ? parts.at(i) : "/" + parts.at(i);
+    return normalized;
+}
+
+/* whether the line is the given preprocessor directive - if so, argument is set to point to the (first non-blank) text after it */
+bool ShaderPreprocessor::IsDirective(const char* line, const char* lineEnd, const char* directive, const char** argument) {
+    const char* c = line;
+    while (c < lineEnd && (*c == ' ' || *c == '\t')) c++;
+    if (c == lineEnd || *c != '#') return false;
+    c++;
+    while (c < lineEnd && (*c == ' ' || *c == '\t')) c++;
+    int n = strlen(directive);
+    if (lineEnd-c < n || strncmp(c, directive, n) != 0) return false;
+    c += n;
+    if (c < lineEnd && *c != ' ' && *c != '\t' && *c != '"' && *c != '<' && *c != '\r' && *c != '\n') return false; // e.g. #includes
+    while (c < lineEnd && (*c == ' ' || *c == '\t')) c++;
+    *argument = c;
+    return true;
+}
+
+/** get the number of segments to pass to glShaderSource
+ */
+int ShaderPreprocessor::GetSegmentCount() {
+    return segments.size();
+}
+
+/** get the segments to pass to glShaderSource (not null-terminated - use with GetSegmentLengths)
+ */
+const char** ShaderPreprocessor::GetSegments() {
+    return segments.empty() ? NULL : &segments[0];
+}
+
+/** get the length of each segment
+ */
+const int* ShaderPreprocessor::GetSegmentLengths() {
+    return lengths.empty() ? NULL : &lengths[0];
+}
+
+/** get the files the source was made from: the main file, followed by the included files in the order they were included
+ *  (index i is the source string number the compiler uses for the file in its output)
+ */
+vector<string> ShaderPreprocessor::GetFiles() {
+    return files;
+}
+
+/** get the #define lines for a set of defines. As the defines are sorted by name, the same set always gives
+ *  the same text, so it can be used to identify the variant.
+ *  @param[in] defines the defines
+ *  @return the #define lines
+ */
+string ShaderPreprocessor::MakeKey(ShaderDefines defines) {
+    string key;
+    for (ShaderDefines::iterator it = defines.begin(); it != defines.end(); it++)
+	key += "#define " + it->first + " " + it->second + "\n";
+    return key;
+}
+
+/** Replace the source string numbers in compiler output with the names of the files, f.e. "0(12) : error" (NVIDIA) or
+ *  "ERROR: 1:12: ..." (AMD, Mesa) becomes "\"blur.frag\"(12) : error" or "ERROR: \"common.glsl\":12: ...".
+ *  Lines in other formats are left as they are.
+ *  @param[in] output the compiler output
+ *  @param[in] files the files of the shader (see GetFiles)
+ *  @return the output with file names
+ */
+string ShaderPreprocessor::MapCompilerOutput(string output, vector<string> files) {
+    string mapped;
+    string::size_type start = 0;
+    while (start < output.length()) {
+	string::size_type end = output.find('\n', start);
+	end = (end == string::npos) ? output.length() : end+1;
+	string line = output.substr(start, end-start);
+	start = end;
+
+	// skip a "ERROR: " / "WARNING: " prefix, then look for <number>( or <number>:
+	string::size_type number = 0;
+	while (number < line.length() && isalpha((unsigned char)line[number])) number++;
+	if (number > 0 && line.compare(number, 2, ": ") == 0) number += 2;
+	else number = 0;
+	string::size_type digits = number;
+	while (digits < line.length() && isdigit((unsigned char)line[digits])) digits++;
+	if (digits > number && digits < line.length() && (line[digits] == '(' || line[digits] == ':')) {
+	    unsigned int sourceNumber = atoi(line.substr(number, digits-number).c_str());
+	    if (sourceNumber < files.size())
+		line = line.substr(0, number) + "\"" + files.at(sourceNumber) + "\"" + line.substr(digits);
+	}
+	mapped += line;
+    }
+    return mapped;
+}
+
+} // NS Resources
+} // NS OpenEngine
@@ -0,0 +1,77 @@
+#ifndef __SHADERPREPROCESSOR_H__
+#define __SHADERPREPROCESSOR_H__
+
+#include <Resources/ShaderSourceStore.h>
+#include <Resources/PPEResourceException.h>
+
+#include <vector>
+#include <string>
+#include <list>
+#include <map>
+
+namespace OpenEngine {
+namespace Resources {
+
+using namespace std;
+
+/**
+ * Defines injected into a shader (name -> value), e.g. TAPS -> 9.
+ * Every distinct set of defines gives a separately compiled variant of the shader.
+ */
+typedef map<string, string> ShaderDefines;
+
+/** GLSL front-end which expands #include directives and injects defines into a shader source.
+ *  The result is a list of segments for glShaderSource. Unchanged text is not copied - the segments point
+ *  directly into the (loaded) sources from the ShaderSourceStore - so only the generated lines
+ *  (defines and #line directives) take up extra memory.
+ *
+ *  #include "file" (or <file>) looks for the file relative to the including file first, and then in the
+ *  DirectoryManager paths. A file is only included once per shader (so include cycles are harmless).
+ *  The defines are inserted after the #version line (or at the top if there is none).
+ *  #line directives are inserted when entering and leaving an included file, so the compiler reports the original lines -
+ *  in compiler output, source string number i refers to GetFiles().at(i) (see MapCompilerOutput).
+ */
+class ShaderPreprocessor {
+
+  private:
+
+    vector<const char*>     segments;
+    vector<int>             lengths;
+    list<string>            generated; // generated text (a list, as the segments point into the strings)
+    vector<ShaderSourcePtr> sources;   // keeps the sources the segments point into alive
+    vector<string>          files;
+
+    ShaderDefines defines;
+    int version; // the #version of the main file (the meaning of #line changed in 3.30)
+
+    // not copyable (the segments point into the generated strings of this object)
+    ShaderPreprocessor(const ShaderPreprocessor&);
+    ShaderPreprocessor& operator=(const ShaderPreprocessor&);
+
+    void Process(string filename, const bool injectDefines);
+    void AddSegment(const char* data, int length);
+    void AddGenerated(string text);
+    void AddLineDirective(int line, int sourceNumber);
+    string ResolveInclude(string name, string includingFilename);
+
+    static string NormalizePath(string path);
+    static bool IsDirective(const char* line, const char* lineEnd, const char* directive, const char** argument);
+
+  public:
+
+    ShaderPreprocessor(string resolvedFilename, ShaderDefines defines = ShaderDefines());
+
+    int          GetSegmentCount();
+    const char** GetSegments();
+    const int*   GetSegmentLengths();
+
+    vector<string> GetFiles(); // the main file, followed by all included files
+
+    static string MakeKey(ShaderDefines defines);
+    static string MapCompilerOutput(string output, vector<string> files);
+};
+
+} // NS Resources
+} // NS OpenEngine
+
+#endif
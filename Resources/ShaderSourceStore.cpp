@@ -0,0 +1,206 @@
+#include "ShaderSourceStore.h"
+
+#include <Resources/DirectoryManager.h>
+#include <stdio.h>
+
+namespace OpenEngine {
+namespace Resources {
+
+map<string, ShaderSourcePtr> ShaderSourceStore::sources;
+deque<string> ShaderSourceStore::queued;
+set<string> ShaderSourceStore::loading;
+set<string> ShaderSourceStore::stale;
+
+#ifdef __linux__
+pthread_mutex_t ShaderSourceStore::mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t ShaderSourceStore::queuedCond = PTHREAD_COND_INITIALIZER;
+pthread_cond_t ShaderSourceStore::loadedCond = PTHREAD_COND_INITIALIZER;
+bool ShaderSourceStore::workerStarted = false;
+#endif
+
+/** create an unloaded shader source (see Load)
+ *  @param[in] filename the resolved filename
+ */
+ShaderSource::ShaderSource(string filename) {
+    this->filename = filename;
+}
+
+/* read the file into the text. Doesn't log or throw, as it may run on the worker thread
+ * @return false if the file can't be opened or read
+ */
+bool ShaderSource::Load() {
+    FILE *fp = fopen(filename.c_str(),"rb"); // for binary files ftell works correctly (not text files)
+    if (fp == NULL) return false;
+
+    fseek(fp, 0, SEEK_END);
+    long length = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    if (length > 0) {
+	text.resize(length);
+	text.resize(fread(&text[0], 1, length, fp)); // <- (the file may have been truncated since ftell)
+    }
+
+    bool ok = !ferror(fp);
+    fclose(fp);
+    return ok;
+}
+
+/** get the source text (not null-terminated, see GetLength)
+ */
+const char* ShaderSource::GetData() {
+    return text.data();
+}
+
+/** get the length of the source text in bytes
+ */
+int ShaderSource::GetLength() {
+    return (int)text.size();
+}
+
+/** get the resolved filename of the source
+ */
+string ShaderSource::GetFilename() {
+    return filename;
+}
+
+
+/* lock the store (a no-op without the worker thread)
+ */
+void ShaderSourceStore::Lock() {
+#ifdef __linux__
+    pthread_mutex_lock(&mutex);
+#endif
+}
+
+/* unlock the store (a no-op without the worker thread)
+ */
+void ShaderSourceStore::Unlock() {
+#ifdef __linux__
+    pthread_mutex_unlock(&mutex);
+#endif
+}
+
+/** Get the source of a shader file. The file is only loaded the first time.
+ *  If the worker is reading the file, waits for it. If the file is still queued, it is read
+ *  here instead of waiting for the files queued before it.
+ *  @param[in] resolvedFilename the filename, already resolved through the DirectoryManager
+ *  @return the source
+ *  @exception PPEResourceException thrown if the file can't be opened or read
+ */
+ShaderSourcePtr ShaderSourceStore::GetSource(string resolvedFilename) {
+    Lock();
+    for (;;) {
+	map<string, ShaderSourcePtr>::iterator it = sources.find(resolvedFilename);
+	if (it != sources.end()) {
+	    ShaderSourcePtr source = it->second;
+	    Unlock();
+	    return source;
+	}
+	if (loading.find(resolvedFilename) == loading.end()) break;
+#ifdef __linux__
+	pthread_cond_wait(&loadedCond, &mutex); // <- (if the worker failed, the file is read again below, to report the error)
+#endif
+    }
+    for (deque<string>::iterator it = queued.begin(); it != queued.end(); it++)
+	if (*it == resolvedFilename) {
+	    queued.erase(it);
+	    break;
+	}
+    loading.insert(resolvedFilename);
+    Unlock();
+
+    ShaderSourcePtr source = ShaderSourcePtr(new ShaderSource(resolvedFilename));
+    bool ok = source->Load();
+
+    Lock();
+    if (ok && stale.erase(resolvedFilename) == 0) sources[resolvedFilename] = source;
+    loading.erase(resolvedFilename);
+#ifdef __linux__
+    pthread_cond_broadcast(&loadedCond);
+#endif
+    Unlock();
+
+    if (!ok) {
+	logger.error << resolvedFilename << logger.end;
+	throw PPEResourceException("error loading shader");
+    }
+    return source;
+}
+
+#ifdef __linux__
+/* reads the queued files, for as long as the program runs
+ */
+void* ShaderSourceStore::Worker(void* /*arg*/) {
+    pthread_mutex_lock(&mutex);
+    for (;;) {
+	while (queued.empty())
+	    pthread_cond_wait(&queuedCond, &mutex);
+
+	string filename = queued.front();
+	queued.pop_front();
+	if (sources.find(filename) != sources.end() || loading.find(filename) != loading.end())
+	    continue;
+	loading.insert(filename);
+	pthread_mutex_unlock(&mutex);
+
+	ShaderSourcePtr source = ShaderSourcePtr(new ShaderSource(filename));
+	bool ok = source->Load(); // <- (a failed file is left for GetSource, which reports the error)
+
+	pthread_mutex_lock(&mutex);
+	if (ok && stale.erase(filename) == 0) sources[filename] = source;
+	loading.erase(filename);
+	pthread_cond_broadcast(&loadedCond);
+    }
+    return NULL;
+}
+#endif
+
+/** Start loading the given shader files, so they are ready when the passes using them are added.
+ *  On linux the files are read by a worker thread, and Preload returns at once; elsewhere they are
+ *  read before Preload returns. Doesn't use OpenGL, so it can be called before the GL context exists
+ *  (e.g. in the effect constructor, after adding the shader directory to the DirectoryManager).
+ *  Files that can't be found or read are reported when a pass uses them.
+ *  @param[in] filenames the filenames (resolved through the DirectoryManager)
+ */
+void ShaderSourceStore::Preload(vector<string> filenames) {
+#ifdef __linux__
+    pthread_mutex_lock(&mutex);
+    for (unsigned int i=0; i<filenames.size(); i++) {
+	string resolved = DirectoryManager::FindFileInPath(filenames.at(i));
+	if (resolved != "") queued.push_back(resolved);
+    }
+    if (!workerStarted) {
+	pthread_t worker;
+	if (pthread_create(&worker, NULL, Worker, NULL) == 0) {
+	    pthread_detach(worker);
+	    workerStarted = true;
+	}
+    }
+    pthread_cond_signal(&queuedCond);
+    pthread_mutex_unlock(&mutex);
+    // <- (if the thread couldn't be created, the queued files are read by GetSource when they are needed)
+#else
+    for (unsigned int i=0; i<filenames.size(); i++) {
+	string resolved = DirectoryManager::FindFileInPath(filenames.at(i));
+	if (resolved == "") continue;
+	ShaderSourcePtr source = ShaderSourcePtr(new ShaderSource(resolved));
+	if (source->Load()) sources[resolved] = source;
+    }
+#endif
+}
+
+/** Forget the loaded source of a file, so it is loaded again the next time it is needed.
+ *  Sources that are still in use are kept alive until they are released.
+ *  @param[in] resolvedFilename the filename, already resolved through the DirectoryManager
+ */
+void ShaderSourceStore::Invalidate(string resolvedFilename) {
+    Lock();
+    sources.erase(resolvedFilename);
+    if (loading.find(resolvedFilename) != loading.end())
+	stale.insert(resolvedFilename); // <- (it may have been read before the change)
+    Unlock();
+}
+
+} // NS Resources
+} // NS OpenEngine
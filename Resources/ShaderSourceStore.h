@@ -0,0 +1,87 @@
+#ifndef __SHADERSOURCESTORE_H__
+#define __SHADERSOURCESTORE_H__
+
+#include <Resources/PPEResourceException.h>
+#include <Logging/Logger.h>
+#include <boost/shared_ptr.hpp>
+
+#include <vector>
+#include <string>
+#include <map>
+#include <set>
+#include <deque>
+
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+namespace OpenEngine {
+namespace Resources {
+
+using namespace std;
+
+/** The contents of a shader source file.
+ *  The file is read once into memory, and the text is handed directly to glShaderSource as pointer and length.
+ *  (it isn't memory-mapped: editors rewrite the files in place while they are loaded, and reading a truncated mapping crashes)
+ *  @note the text is NOT null-terminated - always use GetLength()
+ */
+class ShaderSource {
+
+  private:
+
+    string filename;
+    string text;
+
+    friend class ShaderSourceStore;
+    ShaderSource(string filename);
+    bool Load();
+
+  public:
+
+    const char* GetData();
+    int         GetLength();
+    string      GetFilename();
+};
+
+/**
+ * ShaderSource smart pointer.
+ */
+typedef boost::shared_ptr<ShaderSource> ShaderSourcePtr;
+
+/** Loads shader source files once, no matter how many passes use them.
+ *  Doesn't need OpenGL, so the files of an effect can be preloaded before the GL context exists.
+ *  On linux the preloaded files are read by a worker thread, and GetSource only waits for the
+ *  files it needs (elsewhere Preload reads the files on the calling thread).
+ */
+class ShaderSourceStore {
+
+  private:
+
+    static map<string, ShaderSourcePtr> sources; // by resolved filename
+    static deque<string> queued;                // preloaded, but not read yet
+    static set<string> loading;                 // being read (by the worker or by GetSource)
+    static set<string> stale;                   // invalidated while being read (the text read isn't kept)
+
+#ifdef __linux__
+    static pthread_mutex_t mutex;
+    static pthread_cond_t  queuedCond; // signalled when a file is queued
+    static pthread_cond_t  loadedCond; // signalled when a file has been read (or failed)
+    static bool workerStarted;
+
+    static void* Worker(void* arg);
+#endif
+
+    static void Lock();
+    static void Unlock();
+
+  public:
+
+    static ShaderSourcePtr GetSource(string resolvedFilename);
+    static void Preload(vector<string> filenames);
+    static void Invalidate(string resolvedFilename); // the file has changed on disk (it is loaded again the next time it is needed)
+};
+
+} // NS Resources
+} // NS OpenEngine
+
+#endif